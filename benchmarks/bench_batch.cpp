@@ -0,0 +1,91 @@
+#include "bench_common.hpp"
+#include "qstate_vec_batch.hpp"
+#include <bit>
+#include <numbers>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+constexpr int NUM_LAYERS = 10;
+
+/**
+ * @brief Arguments (qubits, batch, threads) of a parameter sweep: batch circuits of layers of
+ *  Y rotations with per circuit angles and CNOT chains.
+ */
+void sweep_args(benchmark::internal::Benchmark* bench) {
+    bench->ArgsProduct({{10, 14, 18}, {8, 64, 512}, bench::thread_counts()})
+        ->ArgNames({"qubits", "batch", "threads"})
+        ->Unit(benchmark::kMillisecond);
+}
+
+vector<vector<double>> sweep_angles(const int num_qubits, const int batch_size) {
+    mt19937_64 rng(num_qubits);
+    uniform_real_distribution<double> angle(0.0, 2 * numbers::pi);
+    vector<vector<double>> angles(NUM_LAYERS * num_qubits, vector<double>(batch_size));
+    for (auto& layer : angles) {
+        for (double& value : layer) {
+            value = angle(rng);
+        }
+    }
+    return angles;
+}
+
+void report(benchmark::State& state, const int num_qubits, const int batch_size) {
+    const double passes = static_cast<double>(NUM_LAYERS * (2 * num_qubits - 1)) * batch_size;
+    bench::set_counters<double>(state, num_qubits, passes, 2);
+}
+
+// Every circuit of the sweep in one QStateVecBatch
+void sweep_batched(benchmark::State& state) {
+    const auto num_qubits = static_cast<int>(state.range(0));
+    const auto batch_size = static_cast<int>(state.range(1));
+    const int batch_bits = bit_width(static_cast<uint64_t>(batch_size));
+    if (!bench::fits_in_memory<double>(num_qubits + batch_bits)) {
+        state.SkipWithError("batch does not fit in memory");
+        return;
+    }
+
+    const auto angles = sweep_angles(num_qubits, batch_size);
+    for (auto _ : state) {
+        QStateVecBatch<double> batch(num_qubits, batch_size, static_cast<int>(state.range(2)));
+        for (int layer = 0; layer < NUM_LAYERS; layer++) {
+            for (int qubit = 1; qubit <= num_qubits; qubit++) {
+                (void)batch.rotation_y(qubit, angles[layer * num_qubits + qubit - 1]);
+            }
+            for (int qubit = 1; qubit < num_qubits; qubit++) {
+                (void)batch.controlled_x(qubit, qubit + 1);
+            }
+        }
+        benchmark::DoNotOptimize(batch);
+    }
+    report(state, num_qubits, batch_size);
+}
+
+// The same sweep with one QStateVec per circuit, as before batching
+void sweep_separate(benchmark::State& state) {
+    const auto num_qubits = static_cast<int>(state.range(0));
+    const auto batch_size = static_cast<int>(state.range(1));
+    const auto angles = sweep_angles(num_qubits, batch_size);
+    for (auto _ : state) {
+        for (int b = 0; b < batch_size; b++) {
+            QStateVec<double> state_vec(num_qubits, static_cast<int>(state.range(2)));
+            for (int layer = 0; layer < NUM_LAYERS; layer++) {
+                for (int qubit = 1; qubit <= num_qubits; qubit++) {
+                    (void)state_vec.rotation_y(qubit, angles[layer * num_qubits + qubit - 1][b]);
+                }
+                for (int qubit = 1; qubit < num_qubits; qubit++) {
+                    (void)state_vec.controlled_x(qubit, qubit + 1);
+                }
+            }
+            benchmark::DoNotOptimize(state_vec);
+        }
+    }
+    report(state, num_qubits, batch_size);
+}
+
+} // namespace
+
+BENCHMARK(sweep_batched)->Apply(sweep_args);
+BENCHMARK(sweep_separate)->Apply(sweep_args);
@@ -0,0 +1,140 @@
+#include "async_qstate_vec.hpp"
+#include "bench_common.hpp"
+#include "circuit.hpp"
+#include "gates.hpp"
+#include <cmath>
+#include <numbers>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+Circuit ghz(const int num_qubits) {
+    Circuit circuit(num_qubits);
+    (void)circuit.hadamard(1);
+    for (int qubit = 1; qubit < num_qubits; qubit++) {
+        (void)circuit.controlled_x(qubit, qubit + 1);
+    }
+    return circuit;
+}
+
+Circuit qft(const int num_qubits) {
+    Circuit circuit(num_qubits);
+    for (int target = num_qubits; target >= 1; target--) {
+        (void)circuit.hadamard(target);
+        for (int control = target - 1; control >= 1; control--) {
+            (void)circuit.controlled_phase(control, target, ldexp(numbers::pi, control - target));
+        }
+    }
+    for (int qubit = 1; qubit <= num_qubits / 2; qubit++) {
+        (void)circuit.add_gate({qubit, num_qubits + 1 - qubit},
+                               {1, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 1});
+    }
+    return circuit;
+}
+
+/**
+ * @brief Layers of random single qubit rotations on every qubit followed by CNOTs between
+ *  neighbours, alternating between even and odd pairs.
+ */
+Circuit random_layers(const int num_qubits, const int num_layers = 10) {
+    Circuit circuit(num_qubits);
+    mt19937_64 rng(num_qubits);
+    uniform_real_distribution<double> angle(0.0, 2 * numbers::pi);
+    for (int layer = 0; layer < num_layers; layer++) {
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            (void)circuit.u3(qubit, angle(rng), angle(rng), angle(rng));
+        }
+        for (int qubit = 1 + layer % 2; qubit < num_qubits; qubit += 2) {
+            (void)circuit.controlled_x(qubit, qubit + 1);
+        }
+    }
+    return circuit;
+}
+
+using Builder = Circuit (*)(int);
+
+/**
+ * @brief Runs the compiled circuit once per iteration, with Circuit::run or, when blocked,
+ *  Circuit::run_blocked. Throughput counts one pass per compiled operation, so blocked runs
+ *  that make fewer passes show a higher effective rate.
+ */
+void circuit_benchmark(benchmark::State& state, const Builder build, const bool blocked) {
+    const auto num_qubits = static_cast<int>(state.range(0));
+    if (!bench::fits_in_memory<double>(num_qubits)) {
+        state.SkipWithError("state vector does not fit in memory");
+        return;
+    }
+
+    const Circuit circuit = build(num_qubits).compile();
+    QStateVec<double> state_vec(num_qubits, static_cast<int>(state.range(1)));
+    for (auto _ : state) {
+        if (blocked) {
+            (void)circuit.run_blocked(state_vec);
+        } else {
+            (void)circuit.run(state_vec);
+        }
+        benchmark::ClobberMemory();
+    }
+    const auto num_passes = static_cast<double>(circuit.get_operations().size());
+    bench::set_counters<double>(state, num_qubits, num_passes, 2);
+    state.counters["operations"] = num_passes;
+}
+
+void circuit_args(benchmark::internal::Benchmark* bench) {
+    bench->ArgsProduct({bench::qubit_counts(), bench::thread_counts()})
+        ->ArgNames({"qubits", "threads"})
+        ->Unit(benchmark::kMillisecond);
+}
+
+/**
+ * @brief Issues the gates of random_layers one call at a time, as an interactive caller would,
+ *  either straight to a QStateVec or through AsyncQStateVec, whose executor fuses the gates it
+ *  finds queued. Throughput counts one pass per issued gate. The executor competes with the
+ *  caller for a core, so the asynchronous runs need at least two.
+ */
+template <typename Target> void issue_random_layers(benchmark::State& state) {
+    const auto num_qubits = static_cast<int>(state.range(0));
+    if (!bench::fits_in_memory<double>(num_qubits)) {
+        state.SkipWithError("state vector does not fit in memory");
+        return;
+    }
+
+    constexpr int NUM_LAYERS = 10;
+    Target target(num_qubits, static_cast<int>(state.range(1)));
+    mt19937_64 rng(num_qubits);
+    uniform_real_distribution<double> angle(0.0, 2 * numbers::pi);
+    for (auto _ : state) {
+        for (int layer = 0; layer < NUM_LAYERS; layer++) {
+            for (int qubit = 1; qubit <= num_qubits; qubit++) {
+                (void)target.u3(qubit, angle(rng), angle(rng), angle(rng));
+            }
+            for (int qubit = 1 + layer % 2; qubit < num_qubits; qubit += 2) {
+                (void)target.controlled_x(qubit, qubit + 1);
+            }
+        }
+        if constexpr (requires { target.synchronize(); }) {
+            target.synchronize();
+        }
+        benchmark::ClobberMemory();
+    }
+    const double num_passes = NUM_LAYERS * (num_qubits + (num_qubits - 1) / 2.0);
+    bench::set_counters<double>(state, num_qubits, num_passes, 2);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(circuit_benchmark, ghz, ghz, false)->Apply(circuit_args);
+BENCHMARK_CAPTURE(circuit_benchmark, ghz_blocked, ghz, true)->Apply(circuit_args);
+BENCHMARK_CAPTURE(circuit_benchmark, qft, qft, false)->Apply(circuit_args);
+BENCHMARK_CAPTURE(circuit_benchmark, qft_blocked, qft, true)->Apply(circuit_args);
+BENCHMARK_CAPTURE(circuit_benchmark, random_layers, [](const int n) { return random_layers(n); },
+                  false)
+    ->Apply(circuit_args);
+BENCHMARK_CAPTURE(circuit_benchmark, random_layers_blocked,
+                  [](const int n) { return random_layers(n); }, true)
+    ->Apply(circuit_args);
+// Wall time, since the executor thread does the work of the asynchronous runs
+BENCHMARK(issue_random_layers<QStateVec<double>>)->Apply(circuit_args)->UseRealTime();
+BENCHMARK(issue_random_layers<AsyncQStateVec<double>>)->Apply(circuit_args)->UseRealTime();
@@ -0,0 +1,61 @@
+#ifndef BENCH_COMMON_HPP
+#define BENCH_COMMON_HPP
+
+#include <benchmark/benchmark.h>
+#include <complex>
+#include <cstdint>
+#include <omp.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Sweeps shared by the benchmarks. Run a subset with --benchmark_filter, e.g.
+ * --benchmark_filter='pauli_x/qubits:2[26]', and export with --benchmark_out=results.json.
+ */
+namespace bench {
+
+/**
+ * @brief Qubit counts swept, 10 to 30. Sizes that do not fit in memory are skipped.
+ */
+inline std::vector<int64_t> qubit_counts() {
+    return {10, 14, 18, 22, 26, 30};
+}
+
+/**
+ * @brief 1 and every power of two up to the OpenMP thread limit, and the limit itself.
+ */
+inline std::vector<int64_t> thread_counts() {
+    const int max_threads = omp_get_max_threads();
+    std::vector<int64_t> counts;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(max_threads);
+    return counts;
+}
+
+/**
+ * @brief Whether a state vector of num_qubits fits in physical memory, with some headroom.
+ */
+template <typename T> bool fits_in_memory(const int num_qubits) {
+    const auto memory = static_cast<uint64_t>(sysconf(_SC_PHYS_PAGES)) *
+                        static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    return (sizeof(std::complex<T>) << num_qubits) <= memory / 4 * 3;
+}
+
+/**
+ * @brief Reports effective GB/s and amplitudes/s. Each iteration makes num_passes passes over
+ *  the state vector, each reading and writing traffic times its size in bytes.
+ */
+template <typename T>
+void set_counters(benchmark::State& state, const int num_qubits, const double num_passes,
+                  const double traffic) {
+    const double amplitudes = static_cast<double>(state.iterations()) * num_passes *
+                              static_cast<double>(0x1ull << num_qubits);
+    state.SetBytesProcessed(static_cast<int64_t>(amplitudes * traffic * sizeof(std::complex<T>)));
+    state.counters["amplitudes"] = benchmark::Counter(amplitudes, benchmark::Counter::kIsRate);
+}
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,132 @@
+#include "bench_common.hpp"
+#include "qstate_vec.hpp"
+#include <random>
+
+namespace {
+
+template <typename T> using Gate = void (*)(QStateVec<T>&, int);
+
+/**
+ * @brief Arguments (qubits, high, threads): high targets the top qubit, the largest stride,
+ *  instead of qubit 1.
+ */
+void gate_args(benchmark::internal::Benchmark* bench) {
+    bench->ArgsProduct({bench::qubit_counts(), {0, 1}, bench::thread_counts()})
+        ->ArgNames({"qubits", "high", "threads"});
+}
+
+/**
+ * @brief Applies the gate once per iteration; traffic is the fraction of the state vector it
+ *  reads and writes.
+ */
+template <typename T>
+void gate_benchmark(benchmark::State& state, const Gate<T> gate, const double traffic) {
+    const auto num_qubits = static_cast<int>(state.range(0));
+    const int target = state.range(1) != 0 ? num_qubits : 1;
+    if (!bench::fits_in_memory<T>(num_qubits)) {
+        state.SkipWithError("state vector does not fit in memory");
+        return;
+    }
+
+    QStateVec<T> state_vec(num_qubits, static_cast<int>(state.range(2)));
+    for (auto _ : state) {
+        gate(state_vec, target);
+        benchmark::ClobberMemory();
+    }
+    bench::set_counters<T>(state, num_qubits, 1, traffic);
+}
+
+void full_pass(benchmark::State& state, const Gate<double> gate) {
+    gate_benchmark<double>(state, gate, 2);
+}
+
+void full_pass_float(benchmark::State& state, const Gate<float> gate) {
+    gate_benchmark<float>(state, gate, 2);
+}
+
+// Controlled on the qubit at the other end from the target, so half the pairs are updated
+void controlled_pass(benchmark::State& state, const Gate<double> gate) {
+    gate_benchmark<double>(state, gate, 1);
+}
+
+void measured_qubits(benchmark::State& state) {
+    const auto num_qubits = static_cast<int>(state.range(0));
+    if (!bench::fits_in_memory<double>(num_qubits)) {
+        state.SkipWithError("state vector does not fit in memory");
+        return;
+    }
+
+    QStateVec<double> state_vec(num_qubits, static_cast<int>(state.range(1)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(state_vec.get_measured_qubits());
+    }
+    bench::set_counters<double>(state, num_qubits, 1, 1);
+}
+
+/**
+ * @brief Evaluates a Hamiltonian of 64 random Pauli strings over 4 distinct X/Y patterns, so
+ *  each iteration reads the state vector 4 times.
+ */
+void pauli_expectation(benchmark::State& state) {
+    const auto num_qubits = static_cast<int>(state.range(0));
+    if (!bench::fits_in_memory<double>(num_qubits)) {
+        state.SkipWithError("state vector does not fit in memory");
+        return;
+    }
+
+    const int num_groups = 4;
+    std::mt19937_64 rng(num_qubits);
+    const uint64_t qubits_mask = (0x1ull << num_qubits) - 1;
+    std::vector<PauliTerm> terms;
+    for (int t = 0; t < 64; t++) {
+        terms.push_back({(0x9e3779b97f4a7c15ull * (t % num_groups)) & qubits_mask,
+                         rng() & qubits_mask, 1.0});
+    }
+
+    QStateVec<double> state_vec(num_qubits, static_cast<int>(state.range(1)));
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        (void)state_vec.hadamard(qubit);
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(state_vec.expectation(terms));
+    }
+    bench::set_counters<double>(state, num_qubits, num_groups, 1);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(full_pass, pauli_x,
+                  [](QStateVec<double>& state_vec, const int target) {
+                      (void)state_vec.pauli_x(target);
+                  })
+    ->Apply(gate_args);
+BENCHMARK_CAPTURE(full_pass, pauli_y,
+                  [](QStateVec<double>& state_vec, const int target) {
+                      (void)state_vec.pauli_y(target);
+                  })
+    ->Apply(gate_args);
+BENCHMARK_CAPTURE(full_pass, hadamard,
+                  [](QStateVec<double>& state_vec, const int target) {
+                      (void)state_vec.hadamard(target);
+                  })
+    ->Apply(gate_args);
+BENCHMARK_CAPTURE(full_pass_float, hadamard,
+                  [](QStateVec<float>& state_vec, const int target) {
+                      (void)state_vec.hadamard(target);
+                  })
+    ->Apply(gate_args);
+BENCHMARK_CAPTURE(full_pass, rotation_z,
+                  [](QStateVec<double>& state_vec, const int target) {
+                      (void)state_vec.rotation_z(target, 0.3);
+                  })
+    ->Apply(gate_args);
+BENCHMARK_CAPTURE(controlled_pass, controlled_x,
+                  [](QStateVec<double>& state_vec, const int target) {
+                      const int control = target == 1 ? state_vec.get_num_qubits() : 1;
+                      (void)state_vec.controlled_x(control, target);
+                  })
+    ->Apply(gate_args);
+BENCHMARK(measured_qubits)->ArgsProduct({bench::qubit_counts(), bench::thread_counts()})
+    ->ArgNames({"qubits", "threads"});
+BENCHMARK(pauli_expectation)->ArgsProduct({bench::qubit_counts(), bench::thread_counts()})
+    ->ArgNames({"qubits", "threads"});
@@ -0,0 +1,52 @@
+#include "bench_common.hpp"
+#include "noise.hpp"
+#include <numbers>
+#include <random>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t NUM_TRAJECTORIES = 256;
+
+/**
+ * @brief Layers of random rotations and CNOT chains with gate noise and readout error.
+ */
+Circuit noisy_layers(const int num_qubits, const int num_layers = 4) {
+    Circuit circuit(num_qubits);
+    mt19937_64 rng(num_qubits);
+    uniform_real_distribution<double> angle(0.0, 2 * numbers::pi);
+    for (int layer = 0; layer < num_layers; layer++) {
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            (void)circuit.u3(qubit, angle(rng), angle(rng), angle(rng));
+        }
+        for (int qubit = 1; qubit < num_qubits; qubit++) {
+            (void)circuit.controlled_x(qubit, qubit + 1);
+        }
+    }
+    return circuit;
+}
+
+// NUM_TRAJECTORIES trajectories per iteration, on the simulator's pooled states
+void trajectories(benchmark::State& state) {
+    const auto num_qubits = static_cast<int>(state.range(0));
+    const auto num_threads = static_cast<int>(state.range(1));
+    const Circuit circuit = noisy_layers(num_qubits);
+    TrajectorySimulator<double> simulator(num_qubits, {0.001, 0.01, 0.001, 0.02}, num_threads);
+    uint64_t seed = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(simulator.run(circuit, NUM_TRAJECTORIES, seed++));
+    }
+    state.counters["trajectories"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * NUM_TRAJECTORIES),
+                           benchmark::Counter::kIsRate);
+}
+
+} // namespace
+
+// Wall time, since the trajectories run on the OpenMP threads
+BENCHMARK(trajectories)
+    ->ArgsProduct({{10, 14}, bench::thread_counts()})
+    ->ArgNames({"qubits", "threads"})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -1,20 +1,27 @@
+#include "qasm_parser.hpp"
 #include "qstate_vec.hpp"
+#include <chrono>
 #include <cmath>
 #include <iostream>
+#include <string_view>
 
 #define MASK(N) (0x1ull << (N))
 
 using namespace std;
 
-void print_results(vector<PRECISION_TYPE> results) {
+template <typename T> void print_results(vector<T> results) {
     const int centi_to_percentile = 100;
     for (size_t i = 0; i < results.size(); ++i) {
         cout << "Qubit " << i + 1 << ": " << results[i] * centi_to_percentile << "%\n";
     }
 }
 
-int main() {
-    QStateVec test_state_vector(2);
+double elapsed_ms(const chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+template <typename T> void run() {
+    QStateVec<T> test_state_vector(2);
     test_state_vector.pretty_print();
     // test_state_vector.pauli_x(0);
     test_state_vector.pauli_y(1);
@@ -24,6 +31,57 @@ int main() {
     auto results = test_state_vector.get_measured_qubits();
 
     print_results(results);
+}
+
+template <typename T> int run_qasm(const string& path) {
+    auto start = chrono::steady_clock::now();
+    const auto program = parse_qasm_file(path);
+    if (!program) {
+        cerr << path << ": " << program.error() << "\n";
+        return 1;
+    }
+    const Circuit& circuit = program->circuit;
+    cout << "Parsed " << circuit.get_operations().size() << " gates on "
+         << circuit.get_num_qubits() << " qubits in " << elapsed_ms(start) << " ms\n";
+
+    start = chrono::steady_clock::now();
+    const Circuit compiled = circuit.compile();
+    cout << "Compiled to " << compiled.get_operations().size() << " operations in "
+         << elapsed_ms(start) << " ms\n";
+
+    start = chrono::steady_clock::now();
+    QStateVec<T> state(circuit.get_num_qubits());
+    cout << "Allocated the state vector in " << elapsed_ms(start) << " ms\n";
+
+    start = chrono::steady_clock::now();
+    if (!compiled.run_blocked(state)) {
+        cerr << path << ": the circuit could not run\n";
+        return 1;
+    }
+    cout << "Ran in " << elapsed_ms(start) << " ms\n";
 
+    print_results(state.get_measured_qubits());
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+    // main [circuit.qasm] [float|double]: without a circuit, runs the built in demo.
+    // Precision is chosen per run.
+    int arg = 1;
+    string path;
+    if (argc > arg && string_view(argv[arg]) != "float" && string_view(argv[arg]) != "double") {
+        path = argv[arg++];
+    }
+    const bool single = argc > arg && string_view(argv[arg]) == "float";
+
+    if (!path.empty()) {
+        return single ? run_qasm<float>(path) : run_qasm<double>(path);
+    }
+    if (single) {
+        run<float>();
+    } else {
+        run<double>();
+    }
+
+    return 0;
+}
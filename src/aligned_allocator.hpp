@@ -0,0 +1,40 @@
+#ifndef ALIGNED_ALLOCATOR_HPP
+#define ALIGNED_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/**
+ * Allocator returning storage aligned to Alignment bytes (a cache line / AVX-512 register by
+ * default), so SIMD kernels can use aligned loads and stores.
+ */
+template <typename T, std::size_t Alignment = 64> class AlignedAllocator {
+  public:
+    using value_type = T;
+
+    template <typename U> struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>& /*other*/) noexcept {}
+
+    T* allocate(const std::size_t count) {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T* ptr, const std::size_t /*count*/) noexcept {
+        ::operator delete(ptr, std::align_val_t{Alignment});
+    }
+
+    friend bool operator==(const AlignedAllocator& /*lhs*/, const AlignedAllocator& /*rhs*/) {
+        return true;
+    }
+};
+
+template <typename T> using AlignedBuffer = std::vector<T, AlignedAllocator<T>>;
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef AMPLITUDE_MAP_HPP
+#define AMPLITUDE_MAP_HPP
+
+#include <bit>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Open addressing hash map from basis state index to amplitude, used by the sparse storage of
+ * QStateVec. Slots live in one flat array probed linearly, so a lookup is a multiply, a shift
+ * and, at the load factor kept here, about one cache line.
+ * Indices must be below 2^63: the all-ones index marks empty slots.
+ */
+template <typename T> class AmplitudeMap {
+  public:
+    struct Entry {
+        uint64_t index;
+        std::complex<T> amplitude;
+    };
+
+    static constexpr uint64_t EMPTY = ~0ull;
+
+  private:
+    std::vector<Entry> slots;
+    uint64_t count = 0;
+    int shift = 64;
+
+    [[nodiscard]] uint64_t slot_of(const uint64_t index) const {
+        // Fibonacci hashing spreads the low, often consecutive, indices over the whole table
+        return (index * 0x9E3779B97F4A7C15ull) >> this->shift;
+    }
+
+    void grow() {
+        auto old_slots = std::move(this->slots);
+        this->slots.assign(old_slots.empty() ? 16 : 2 * old_slots.size(), {EMPTY, {}});
+        this->shift = 64 - std::countr_zero(this->slots.size());
+        this->count = 0;
+        for (const auto& entry : old_slots) {
+            if (entry.index != EMPTY) {
+                (*this)[entry.index] = entry.amplitude;
+            }
+        }
+    }
+
+  public:
+    AmplitudeMap() = default;
+
+    /**
+     * @brief Construct an empty map that holds expected_size entries without growing.
+     */
+    explicit AmplitudeMap(const uint64_t expected_size) {
+        this->slots.assign(std::bit_ceil(2 * expected_size + 16), {EMPTY, {}});
+        this->shift = 64 - std::countr_zero(this->slots.size());
+    }
+
+    /**
+     * @brief Returns the amplitude stored for index, 0 when absent.
+     */
+    [[nodiscard]] std::complex<T> get(const uint64_t index) const {
+        if (this->slots.empty()) {
+            return {};
+        }
+        const uint64_t mask = this->slots.size() - 1;
+        for (uint64_t slot = this->slot_of(index);; slot = (slot + 1) & mask) {
+            if (this->slots[slot].index == index) {
+                return this->slots[slot].amplitude;
+            }
+            if (this->slots[slot].index == EMPTY) {
+                return {};
+            }
+        }
+    }
+
+    [[nodiscard]] bool contains(const uint64_t index) const {
+        if (this->slots.empty()) {
+            return false;
+        }
+        const uint64_t mask = this->slots.size() - 1;
+        for (uint64_t slot = this->slot_of(index);; slot = (slot + 1) & mask) {
+            if (this->slots[slot].index == index) {
+                return true;
+            }
+            if (this->slots[slot].index == EMPTY) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the amplitude stored for index, inserting 0 when absent.
+     */
+    std::complex<T>& operator[](const uint64_t index) {
+        // Keep the load factor at most 1/2 so probe sequences stay short
+        if (2 * (this->count + 1) > this->slots.size()) {
+            this->grow();
+        }
+        const uint64_t mask = this->slots.size() - 1;
+        for (uint64_t slot = this->slot_of(index);; slot = (slot + 1) & mask) {
+            if (this->slots[slot].index == index) {
+                return this->slots[slot].amplitude;
+            }
+            if (this->slots[slot].index == EMPTY) {
+                this->slots[slot].index = index;
+                this->count++;
+                return this->slots[slot].amplitude;
+            }
+        }
+    }
+
+    /**
+     * @brief Calls func(index, amplitude) for every stored entry, in slot order.
+     *  func may modify the amplitude but not insert.
+     */
+    template <typename Func> void for_each(Func&& func) {
+        for (auto& entry : this->slots) {
+            if (entry.index != EMPTY) {
+                func(entry.index, entry.amplitude);
+            }
+        }
+    }
+
+    template <typename Func> void for_each(Func&& func) const {
+        for (const auto& entry : this->slots) {
+            if (entry.index != EMPTY) {
+                func(entry.index, entry.amplitude);
+            }
+        }
+    }
+
+    [[nodiscard]] uint64_t size() const {
+        return this->count;
+    }
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "async_qstate_vec.hpp"
+
+using namespace std;
+
+template <typename T>
+AsyncQStateVec<T>::AsyncQStateVec(const int num_qubits, const int num_threads,
+                                  const StorageMode storage_mode, const uint64_t seed,
+                                  const int max_fused_qubits, const size_t queue_capacity)
+    : num_qubits(num_qubits), max_fused_qubits(max_fused_qubits), queue(queue_capacity),
+      state(num_qubits, num_threads, storage_mode), rng(seed) {
+    this->executor = thread([this] { this->run(); });
+}
+
+template <typename T> AsyncQStateVec<T>::~AsyncQStateVec() {
+    this->push({nullopt, {}, true});
+    this->executor.join();
+}
+
+template <typename T> void AsyncQStateVec<T>::push(Command command) {
+    while (!this->queue.try_push(command)) {
+        this->queue.wait_not_full();
+    }
+}
+
+template <typename T> void AsyncQStateVec<T>::run() {
+    Circuit batch(this->num_qubits);
+    size_t num_batched = 0;
+    // Gates were validated when queued, so running them cannot fail
+    const auto flush = [&] {
+        if (num_batched == 0) {
+            return;
+        }
+        if (num_batched == 1) {
+            (void)batch.run(this->state);
+        } else {
+            (void)batch.compile(this->max_fused_qubits).run(this->state);
+        }
+        batch = Circuit(this->num_qubits);
+        num_batched = 0;
+    };
+
+    Command command;
+    while (true) {
+        if (!this->queue.try_pop(command)) {
+            // Nothing more to look ahead at: run what has been gathered before sleeping
+            flush();
+            this->queue.wait_not_empty();
+            continue;
+        }
+
+        if (command.gates) {
+            (void)batch.append(*command.gates);
+            num_batched += command.gates->get_operations().size();
+            command.gates.reset();
+            if (num_batched >= MAX_LOOKAHEAD) {
+                flush();
+            }
+            continue;
+        }
+
+        flush();
+        if (command.stop) {
+            return;
+        }
+        command.task(this->state);
+        command.task = nullptr;
+    }
+}
+
+template <typename T> int AsyncQStateVec<T>::get_num_qubits() const {
+    return this->num_qubits;
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::append(const Circuit& circuit) -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.append(circuit); });
+}
+
+template <typename T> void AsyncQStateVec<T>::synchronize() {
+    this->submit([](QStateVec<T>&) {}).wait();
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::apply_1q(const int target_qubit, const Matrix2& matrix)
+    -> expected<void, Error> {
+    return this->record([&](Circuit& gates) {
+        return gates.add_gate({target_qubit}, MatrixN(matrix.begin(), matrix.end()));
+    });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::apply_nq(const vector<int>& target_qubits, const MatrixN& matrix)
+    -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.add_gate(target_qubits, matrix); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::controlled(const uint64_t controls_mask, const int target_qubit,
+                                   const Matrix2& matrix) -> expected<void, Error> {
+    return this->record(
+        [&](Circuit& gates) { return gates.controlled(controls_mask, target_qubit, matrix); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::pauli_x(const int target_qubit) -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.pauli_x(target_qubit); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::pauli_y(const int target_qubit) -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.pauli_y(target_qubit); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::pauli_z(const int target_qubit) -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.pauli_z(target_qubit); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::hadamard(const int target_qubit) -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.hadamard(target_qubit); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::s_gate(const int target_qubit) -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.s_gate(target_qubit); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::t_gate(const int target_qubit) -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.t_gate(target_qubit); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::rotation_x(const int target_qubit, const double angle)
+    -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.rotation_x(target_qubit, angle); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::rotation_y(const int target_qubit, const double angle)
+    -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.rotation_y(target_qubit, angle); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::rotation_z(const int target_qubit, const double angle)
+    -> expected<void, Error> {
+    return this->record([&](Circuit& gates) { return gates.rotation_z(target_qubit, angle); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::u3(const int target_qubit, const double theta, const double phi,
+                           const double lambda) -> expected<void, Error> {
+    return this->record(
+        [&](Circuit& gates) { return gates.u3(target_qubit, theta, phi, lambda); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::controlled_x(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    return this->record(
+        [&](Circuit& gates) { return gates.controlled_x(control_qubit, target_qubit); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::controlled_z(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    return this->record(
+        [&](Circuit& gates) { return gates.controlled_z(control_qubit, target_qubit); });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::controlled_phase(const int control_qubit, const int target_qubit,
+                                         const double angle) -> expected<void, Error> {
+    return this->record([&](Circuit& gates) {
+        return gates.controlled_phase(control_qubit, target_qubit, angle);
+    });
+}
+
+template <typename T>
+auto AsyncQStateVec<T>::toffoli(const int control_qubit1, const int control_qubit2,
+                                const int target_qubit) -> expected<void, Error> {
+    return this->record([&](Circuit& gates) {
+        return gates.toffoli(control_qubit1, control_qubit2, target_qubit);
+    });
+}
+
+template <typename T> future<vector<T>> AsyncQStateVec<T>::get_measured_qubits() {
+    return this->submit([](QStateVec<T>& state) { return state.get_measured_qubits(); });
+}
+
+template <typename T>
+future<expected<vector<T>, Error>> AsyncQStateVec<T>::get_probabilities(vector<int> qubits) {
+    return this->submit([qubits = std::move(qubits)](QStateVec<T>& state) {
+        return state.get_probabilities(qubits);
+    });
+}
+
+template <typename T>
+future<vector<pair<uint64_t, uint64_t>>> AsyncQStateVec<T>::sample(const uint64_t shots,
+                                                                   const uint64_t seed) {
+    return this->submit([=](QStateVec<T>& state) { return state.sample(shots, seed); });
+}
+
+template <typename T>
+future<expected<double, Error>> AsyncQStateVec<T>::expectation(vector<PauliTerm> terms) {
+    return this->submit(
+        [terms = std::move(terms)](QStateVec<T>& state) { return state.expectation(terms); });
+}
+
+template <typename T>
+future<expected<int, Error>> AsyncQStateVec<T>::measure(const int target_qubit) {
+    // The generator is only ever used by the executor
+    return this->submit([this, target_qubit](QStateVec<T>& state) {
+        return state.measure(target_qubit, this->rng);
+    });
+}
+
+template <typename T> future<StateVector<T>> AsyncQStateVec<T>::get_state() {
+    // Returned by value, so the amplitudes are copied into the future
+    return this->submit([](QStateVec<T>& state) { return state.get_state(); });
+}
+
+template class AsyncQStateVec<float>;
+template class AsyncQStateVec<double>;
@@ -0,0 +1,170 @@
+#ifndef ASYNC_QSTATE_VEC_HPP
+#define ASYNC_QSTATE_VEC_HPP
+
+#include "circuit.hpp"
+#include "qstate_vec.hpp"
+#include "spsc_queue.hpp"
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <future>
+#include <optional>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * QStateVec driven by a dedicated executor thread. Gate calls are validated in the caller's
+ * thread, queued and return at once; queries return futures resolved once every gate queued
+ * before them has run. The executor drains the gates available in the queue, up to
+ * MAX_LOOKAHEAD of them and never past a query, and runs them as one compiled Circuit, so
+ * adjacent gates are fused whenever the caller is ahead of the simulation.
+ *
+ * Gates and queries must all be issued from one thread at a time: the queue has a single
+ * producer.
+ */
+template <typename T = double> class AsyncQStateVec {
+  private:
+    /**
+     * Gates to apply, or a task run on the state once the gates before it have been applied.
+     */
+    struct Command {
+        std::optional<Circuit> gates;
+        std::move_only_function<void(QStateVec<T>&)> task;
+        bool stop = false;
+    };
+
+    int num_qubits;
+    int max_fused_qubits;
+    SpscQueue<Command> queue;
+    QStateVec<T> state;
+    std::mt19937_64 rng;
+    std::thread executor;
+
+    void push(Command command);
+    void run();
+
+    /**
+     * @brief Records the gates add appends to a scratch circuit, which validates them, and
+     *  queues them.
+     */
+    template <typename Add> auto record(Add&& add) -> std::expected<void, Error> {
+        Circuit gates(this->num_qubits);
+        if (auto result = add(gates); !result) {
+            return result;
+        }
+        this->push({std::move(gates), {}, false});
+        return {};
+    }
+
+  public:
+    /**
+     * Queued operations compiled and run together at most.
+     */
+    static constexpr int MAX_LOOKAHEAD = 64;
+
+    /**
+     * @brief Starts the executor on a state of num_qubits qubits initialized to |0...0>.
+     *
+     * @param num_threads Threads of the gate kernels, as in QStateVec
+     * @param storage_mode As in QStateVec
+     * @param seed Seed of the random outcomes of measure
+     * @param max_fused_qubits Largest block fused from queued gates, as in Circuit::compile
+     * @param queue_capacity Commands the queue holds before gate calls block
+     */
+    AsyncQStateVec(int num_qubits, int num_threads = 0,
+                   StorageMode storage_mode = StorageMode::dense, uint64_t seed = 0,
+                   int max_fused_qubits = 2, std::size_t queue_capacity = 1024);
+
+    /**
+     * @brief Waits for every queued command to run, then stops the executor.
+     */
+    ~AsyncQStateVec();
+
+    AsyncQStateVec(const AsyncQStateVec&) = delete;
+    AsyncQStateVec& operator=(const AsyncQStateVec&) = delete;
+
+    [[nodiscard]] int get_num_qubits() const;
+
+    /**
+     * @brief Queues func(state) after the commands already queued and returns the future of its
+     *  result. Exceptions thrown by func are stored in the future.
+     */
+    template <typename Func>
+    auto submit(Func&& func) -> std::future<std::invoke_result_t<Func&, QStateVec<T>&>> {
+        using Result = std::invoke_result_t<Func&, QStateVec<T>&>;
+        std::packaged_task<Result(QStateVec<T>&)> task(std::forward<Func>(func));
+        auto future = task.get_future();
+        this->push({std::nullopt, std::move(task), false});
+        return future;
+    }
+
+    /**
+     * @brief Queues every operation of the circuit.
+     */
+    auto append(const Circuit& circuit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Blocks until every command queued so far has run.
+     */
+    void synchronize();
+
+    auto apply_1q(int target_qubit, const Matrix2& matrix) -> std::expected<void, Error>;
+    auto apply_nq(const std::vector<int>& target_qubits, const MatrixN& matrix)
+        -> std::expected<void, Error>;
+    auto controlled(uint64_t controls_mask, int target_qubit, const Matrix2& matrix)
+        -> std::expected<void, Error>;
+
+    auto pauli_x(int target_qubit) -> std::expected<void, Error>;
+    auto pauli_y(int target_qubit) -> std::expected<void, Error>;
+    auto pauli_z(int target_qubit) -> std::expected<void, Error>;
+    auto hadamard(int target_qubit) -> std::expected<void, Error>;
+    auto s_gate(int target_qubit) -> std::expected<void, Error>;
+    auto t_gate(int target_qubit) -> std::expected<void, Error>;
+    auto rotation_x(int target_qubit, double angle) -> std::expected<void, Error>;
+    auto rotation_y(int target_qubit, double angle) -> std::expected<void, Error>;
+    auto rotation_z(int target_qubit, double angle) -> std::expected<void, Error>;
+    auto u3(int target_qubit, double theta, double phi, double lambda)
+        -> std::expected<void, Error>;
+    auto controlled_x(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+    auto controlled_z(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+    auto controlled_phase(int control_qubit, int target_qubit, double angle)
+        -> std::expected<void, Error>;
+    auto toffoli(int control_qubit1, int control_qubit2, int target_qubit)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Future of QStateVec::get_measured_qubits.
+     */
+    std::future<std::vector<T>> get_measured_qubits();
+
+    /**
+     * @brief Future of QStateVec::get_probabilities.
+     */
+    std::future<std::expected<std::vector<T>, Error>> get_probabilities(std::vector<int> qubits);
+
+    /**
+     * @brief Future of QStateVec::sample.
+     */
+    std::future<std::vector<std::pair<uint64_t, uint64_t>>> sample(uint64_t shots,
+                                                                   uint64_t seed);
+
+    /**
+     * @brief Future of QStateVec::expectation.
+     */
+    std::future<std::expected<double, Error>> expectation(std::vector<PauliTerm> terms);
+
+    /**
+     * @brief Future of QStateVec::measure, drawing from the generator seeded at construction.
+     */
+    std::future<std::expected<int, Error>> measure(int target_qubit);
+
+    /**
+     * @brief Future of a copy of the amplitudes.
+     */
+    std::future<StateVector<T>> get_state();
+};
+
+#endif
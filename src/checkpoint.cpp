@@ -0,0 +1,134 @@
+#include "checkpoint.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+// Upper bound of one read or write call, which Linux caps just below 2 GiB anyway
+constexpr size_t IO_CHUNK_SIZE = size_t{1} << 30;
+
+bool write_all(const int fd, const byte* data, size_t size) {
+    while (size > 0) {
+        const ssize_t written = ::write(fd, data, min(size, IO_CHUNK_SIZE));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(const int fd, byte* data, size_t size, off_t offset) {
+    while (size > 0) {
+        const ssize_t num_read = pread(fd, data, min(size, IO_CHUNK_SIZE), offset);
+        if (num_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (num_read <= 0) {
+            return false;
+        }
+        data += num_read;
+        size -= static_cast<size_t>(num_read);
+        offset += num_read;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace checkpoint {
+
+auto write(const string& path, const Header& header, span<const byte> payload)
+    -> expected<void, Error> {
+    const string tmp_path = path + ".tmp";
+    const int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return unexpected(Error::io_failure);
+    }
+
+    // The header page is padded with zeros up to the payload
+    vector<byte> header_page(HEADER_SIZE, byte{0});
+    copy_n(reinterpret_cast<const byte*>(&header), sizeof(Header), header_page.begin());
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    const bool written = write_all(fd, header_page.data(), header_page.size()) &&
+                         write_all(fd, payload.data(), payload.size()) && fsync(fd) == 0;
+    if (close(fd) != 0 || !written || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return unexpected(Error::io_failure);
+    }
+    return {};
+}
+
+uint64_t record_size(const Header& header) {
+    const uint64_t amplitude_size = 2ull * header.precision;
+    return header.layout == Layout::dense ? amplitude_size : sizeof(uint64_t) + amplitude_size;
+}
+
+auto read_header(const string& path) -> expected<Header, Error> {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return unexpected(Error::io_failure);
+    }
+    Header header{};
+    struct stat file_stat{};
+    const bool read = fstat(fd, &file_stat) == 0 &&
+                      read_all(fd, reinterpret_cast<byte*>(&header), sizeof(Header), 0);
+    close(fd);
+    if (!read) {
+        return unexpected(Error::io_failure);
+    }
+
+    if (header.magic != MAGIC || header.version != VERSION ||
+        (header.precision != sizeof(float) && header.precision != sizeof(double)) ||
+        (header.layout != Layout::dense && header.layout != Layout::sparse) ||
+        header.num_qubits > 63) {
+        return unexpected(Error::invalid_input);
+    }
+    // Read as raw bytes, so the storage mode may hold any value; a sparse payload is only
+    // written by the sparse storage modes
+    const auto mode = static_cast<uint8_t>(header.storage_mode);
+    if (mode > static_cast<uint8_t>(StorageMode::mapped) ||
+        (header.layout == Layout::sparse && header.storage_mode != StorageMode::sparse &&
+         header.storage_mode != StorageMode::automatic)) {
+        return unexpected(Error::invalid_input);
+    }
+    const uint64_t num_amplitudes = 0x1ull << header.num_qubits;
+    if ((header.layout == Layout::dense && header.num_records != num_amplitudes) ||
+        (header.layout == Layout::sparse && header.num_records > num_amplitudes)) {
+        return unexpected(Error::invalid_input);
+    }
+    // Compared by division, as a corrupt record count could overflow the payload size
+    const auto file_size = static_cast<uint64_t>(file_stat.st_size);
+    if (file_size < HEADER_SIZE || (file_size - HEADER_SIZE) % record_size(header) != 0 ||
+        (file_size - HEADER_SIZE) / record_size(header) != header.num_records) {
+        return unexpected(Error::invalid_input);
+    }
+    return header;
+}
+
+auto read_payload(const string& path, span<byte> payload) -> expected<void, Error> {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return unexpected(Error::io_failure);
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    const bool read =
+        read_all(fd, payload.data(), payload.size(), static_cast<off_t>(HEADER_SIZE));
+    close(fd);
+    if (!read) {
+        return unexpected(Error::io_failure);
+    }
+    return {};
+}
+
+} // namespace checkpoint
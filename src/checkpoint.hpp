@@ -0,0 +1,68 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "qstate_vec.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+
+/**
+ * Binary checkpoint files of QStateVec: a fixed size header followed by the raw amplitudes, in
+ * native byte order. The amplitudes start at HEADER_SIZE, a multiple of the page size, so a
+ * dense checkpoint is loaded by mapping them in place.
+ */
+namespace checkpoint {
+
+constexpr std::array<char, 8> MAGIC = {'Q', 'S', 'V', 'C', 'K', 'P', 'T', '\0'};
+constexpr uint32_t VERSION = 1;
+
+// Page aligned for both 4 KiB and 64 KiB pages
+constexpr uint64_t HEADER_SIZE = 0x1ull << 16;
+
+/**
+ * @brief How the payload is laid out: all 2^n amplitudes, or AmplitudeMap<T>::Entry records of
+ *  the stored ones.
+ */
+enum class Layout : uint32_t { dense, sparse };
+
+struct Header {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t num_qubits;
+    uint32_t precision; // sizeof the real type, 4 or 8
+    Layout layout;
+    StorageMode storage_mode;
+    uint64_t num_records; // Amplitudes or entries in the payload
+};
+
+/**
+ * @brief Writes the header and the payload with large sequential writes. The file is written
+ *  next to path and renamed over it once synced, so a crash leaves the previous checkpoint
+ *  intact and states mapped from it stay valid.
+ */
+auto write(const std::string& path, const Header& header, std::span<const std::byte> payload)
+    -> std::expected<void, Error>;
+
+/**
+ * @brief Returns the size in bytes of one payload record.
+ */
+uint64_t record_size(const Header& header);
+
+/**
+ * @brief Reads and validates the header, including its storage mode and that the file holds
+ *  all of its records.
+ */
+auto read_header(const std::string& path) -> std::expected<Header, Error>;
+
+/**
+ * @brief Reads the payload that follows the header into the buffer.
+ */
+auto read_payload(const std::string& path, std::span<std::byte> payload)
+    -> std::expected<void, Error>;
+
+} // namespace checkpoint
+
+#endif
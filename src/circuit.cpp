@@ -0,0 +1,636 @@
+#include "circuit.hpp"
+#include "gates.hpp"
+#include "kernels.hpp"
+#include "mapped_storage.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <iterator>
+#include <optional>
+
+#define MASK(N) (0x1ull << (N))
+
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Returns the product lhs * rhs of two row-major dim x dim matrices.
+ */
+MatrixN multiply(const MatrixN& lhs, const MatrixN& rhs, const uint64_t dim) {
+    MatrixN product(dim * dim, complex<double>{0.0, 0.0});
+    for (uint64_t row = 0; row < dim; row++) {
+        for (uint64_t mid = 0; mid < dim; mid++) {
+            const auto lhs_value = lhs[row * dim + mid];
+            for (uint64_t col = 0; col < dim; col++) {
+                product[row * dim + col] += lhs_value * rhs[mid * dim + col];
+            }
+        }
+    }
+    return product;
+}
+
+/**
+ * @brief Rewrites a diagonal batch as a dense diagonal unitary over the qubits it touches.
+ */
+Operation batch_to_dense(const Operation& op) {
+    const uint64_t dim = MASK(op.qubits.size());
+    Operation dense = {op.qubits, MatrixN(dim * dim, complex<double>{0.0, 0.0}), 0, {}};
+    for (uint64_t local = 0; local < dim; local++) {
+        uint64_t index = 0;
+        for (size_t j = 0; j < op.qubits.size(); j++) {
+            index |= ((local >> j) & 0x1ull) << (op.qubits[j] - 1);
+        }
+        complex<double> phase = 1.0;
+        for (const auto& gate : op.diagonals) {
+            if ((index & gate.controls_mask) == gate.controls_mask) {
+                phase *= gate.phases[(index >> (gate.target_qubit - 1)) & 0x1ull];
+            }
+        }
+        dense.matrix[local * dim + local] = phase;
+    }
+    return dense;
+}
+
+/**
+ * @brief Rewrites a controlled operation or a diagonal batch as a dense unitary over every
+ *  qubit it acts on.
+ */
+Operation to_dense(const Operation& op) {
+    if (!op.diagonals.empty()) {
+        return batch_to_dense(op);
+    }
+    if (op.controls == 0) {
+        return op;
+    }
+
+    Operation dense = {involved_qubits(op), {}, 0, {}};
+    const auto target_position =
+        static_cast<int>(ranges::find(dense.qubits, op.qubits[0]) - dense.qubits.begin());
+    const uint64_t dim = MASK(dense.qubits.size());
+    const uint64_t controls_set = (dim - 1) & ~MASK(target_position);
+
+    dense.matrix.assign(dim * dim, complex<double>{0.0, 0.0});
+    for (uint64_t row = 0; row < dim; row++) {
+        for (uint64_t col = 0; col < dim; col++) {
+            if ((row & controls_set) != (col & controls_set)) {
+                continue;
+            }
+            if ((row & controls_set) == controls_set) {
+                const uint64_t row_bit = (row >> target_position) & 0x1ull;
+                const uint64_t col_bit = (col >> target_position) & 0x1ull;
+                dense.matrix[row * dim + col] = op.matrix[row_bit * 2 + col_bit];
+            } else if (row == col) {
+                dense.matrix[row * dim + col] = 1;
+            }
+        }
+    }
+    return dense;
+}
+
+/**
+ * @brief Rewrites the matrix of op over the larger qubit list, as identity on the extra qubits.
+ */
+MatrixN expand(const Operation& controlled_op, const vector<int>& qubits) {
+    const Operation op = to_dense(controlled_op);
+    if (op.qubits == qubits) {
+        return op.matrix;
+    }
+
+    // Bit position of each of the op qubits inside the expanded index
+    vector<int> positions;
+    uint64_t op_mask = 0;
+    for (const int qubit : op.qubits) {
+        const auto position = static_cast<int>(ranges::find(qubits, qubit) - qubits.begin());
+        positions.push_back(position);
+        op_mask |= MASK(position);
+    }
+
+    auto gather = [&](const uint64_t index) {
+        uint64_t local = 0;
+        for (size_t j = 0; j < positions.size(); j++) {
+            local |= ((index >> positions[j]) & 0x1ull) << j;
+        }
+        return local;
+    };
+
+    const uint64_t dim = MASK(qubits.size());
+    const uint64_t op_dim = MASK(op.qubits.size());
+    MatrixN expanded(dim * dim, complex<double>{0.0, 0.0});
+    for (uint64_t row = 0; row < dim; row++) {
+        for (uint64_t col = 0; col < dim; col++) {
+            if ((row & ~op_mask) == (col & ~op_mask)) {
+                expanded[row * dim + col] = op.matrix[gather(row) * op_dim + gather(col)];
+            }
+        }
+    }
+    return expanded;
+}
+
+/**
+ * @brief Returns the operation equivalent to applying first then second.
+ */
+Operation fuse(const Operation& first, const Operation& second, const vector<int>& qubits) {
+    return {qubits, multiply(expand(second, qubits), expand(first, qubits), MASK(qubits.size())),
+            0, {}};
+}
+
+/**
+ * @brief Whether the operation is a (controlled) diagonal gate or a diagonal batch.
+ */
+bool is_diagonal(const Operation& op) {
+    return !op.diagonals.empty() ||
+           (op.qubits.size() == 1 && op.matrix[1] == 0.0 && op.matrix[2] == 0.0);
+}
+
+/**
+ * @brief Returns the gates of a diagonal operation: those of a batch, or the operation itself.
+ */
+vector<DiagonalGate> to_diagonal_gates(const Operation& op) {
+    if (!op.diagonals.empty()) {
+        return op.diagonals;
+    }
+    return {{op.controls, op.qubits[0], {op.matrix[0], op.matrix[3]}}};
+}
+
+vector<int> merge_qubits(const Operation& lhs, const Operation& rhs) {
+    vector<int> merged = involved_qubits(lhs);
+    const auto rhs_qubits = involved_qubits(rhs);
+    merged.insert(merged.end(), rhs_qubits.begin(), rhs_qubits.end());
+    ranges::sort(merged);
+    const auto duplicates = ranges::unique(merged);
+    merged.erase(duplicates.begin(), duplicates.end());
+    return merged;
+}
+
+/**
+ * A gate of blocked execution, on 0-based bits. Diagonal gates hold {d0, d1} in matrix.
+ */
+template <typename T> struct BlockGate {
+    vector<int> bits;
+    vector<complex<T>> matrix;
+    uint64_t controls = 0;
+    bool diagonal = false;
+};
+
+template <typename T> vector<BlockGate<T>> to_block_gates(const vector<Operation>& operations) {
+    vector<BlockGate<T>> gates;
+    for (const auto& op : operations) {
+        for (const auto& gate : op.diagonals) {
+            gates.push_back({{gate.target_qubit - 1},
+                             {complex<T>(gate.phases[0]), complex<T>(gate.phases[1])},
+                             gate.controls_mask,
+                             true});
+        }
+        if (!op.diagonals.empty()) {
+            continue;
+        }
+
+        vector<int> bits(op.qubits.size());
+        ranges::transform(op.qubits, bits.begin(), [](const int qubit) { return qubit - 1; });
+        if (is_diagonal(op)) {
+            gates.push_back(
+                {bits, {complex<T>(op.matrix[0]), complex<T>(op.matrix[3])}, op.controls, true});
+        } else {
+            gates.push_back({bits, kernels::cast_matrix<T>(op.matrix), op.controls, false});
+        }
+    }
+    return gates;
+}
+
+/**
+ * @brief Applies the gate, on physical bits, to the chunk of amplitudes starting at index base.
+ *  Bits at or above block_qubits are constant over the chunk.
+ */
+template <typename T>
+void apply_to_chunk(span<complex<T>> chunk, const uint64_t base, const int block_qubits,
+                    const BlockGate<T>& gate) {
+    const uint64_t low_mask = MASK(block_qubits) - 1;
+    const uint64_t high_controls = gate.controls & ~low_mask;
+    const uint64_t low_controls = gate.controls & low_mask;
+    if ((base & high_controls) != high_controls) {
+        return;
+    }
+
+    const int target = gate.bits[0];
+    if (gate.diagonal && target >= block_qubits) {
+        const complex<T> factor = gate.matrix[(base >> target) & 1];
+        for (uint64_t i = 0; i < chunk.size(); i++) {
+            if ((i & low_controls) == low_controls) {
+                chunk[i] = kernels::mul(chunk[i], factor);
+            }
+        }
+    } else if (gate.diagonal) {
+        kernels::apply_diagonal<T>(chunk, low_controls, target, {gate.matrix[0], gate.matrix[1]},
+                                   1);
+    } else if (gate.bits.size() == 1) {
+        const array<complex<T>, 4> matrix = {gate.matrix[0], gate.matrix[1], gate.matrix[2],
+                                             gate.matrix[3]};
+        if (low_controls == 0) {
+            kernels::apply_1q<T>(chunk, target, matrix, 1);
+        } else {
+            kernels::controlled_apply_1q<T>(chunk, low_controls, target, matrix, 1);
+        }
+    } else {
+        kernels::apply_nq<T>(chunk, gate.bits, gate.matrix, 1);
+    }
+}
+
+} // namespace
+
+vector<int> involved_qubits(const Operation& op) {
+    vector<int> qubits = op.qubits;
+    for (int qubit = 1; (op.controls >> (qubit - 1)) != 0; qubit++) {
+        if ((op.controls & MASK(qubit - 1)) != 0) {
+            qubits.push_back(qubit);
+        }
+    }
+    ranges::sort(qubits);
+    return qubits;
+}
+
+template <typename T>
+auto apply_operation(const Operation& op, QStateVec<T>& state) -> expected<void, Error> {
+    if (!op.diagonals.empty()) {
+        return state.apply_diagonals(op.diagonals);
+    }
+    if (op.controls != 0) {
+        return state.controlled(op.controls, op.qubits[0],
+                                {op.matrix[0], op.matrix[1], op.matrix[2], op.matrix[3]});
+    }
+    if (op.qubits.size() == 1) {
+        return state.apply_1q(op.qubits[0],
+                              {op.matrix[0], op.matrix[1], op.matrix[2], op.matrix[3]});
+    }
+    return state.apply_nq(op.qubits, op.matrix);
+}
+
+template auto apply_operation(const Operation& op, QStateVec<float>& state)
+    -> expected<void, Error>;
+template auto apply_operation(const Operation& op, QStateVec<double>& state)
+    -> expected<void, Error>;
+
+Circuit::Circuit(const int num_qubits) {
+    this->num_qubits = num_qubits;
+}
+
+auto Circuit::add_gate(const vector<int>& target_qubits, const MatrixN& matrix)
+    -> expected<void, Error> {
+    const auto num_targets = static_cast<int>(target_qubits.size());
+    if (num_targets == 0 || num_targets > kernels::MAX_BLOCK_QUBITS ||
+        matrix.size() != MASK(2 * num_targets)) {
+        return unexpected(Error::invalid_input);
+    }
+
+    uint64_t target_mask = 0;
+    for (const int target_qubit : target_qubits) {
+        if (target_qubit > this->num_qubits || target_qubit <= 0 ||
+            (target_mask & MASK(target_qubit - 1)) != 0) {
+            return unexpected(Error::invalid_input);
+        }
+        target_mask |= MASK(target_qubit - 1);
+    }
+
+    this->operations.push_back({target_qubits, matrix, 0, {}});
+    return {};
+}
+
+auto Circuit::controlled(const uint64_t controls_mask, const int target_qubit,
+                         const Matrix2& matrix) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0 ||
+        (controls_mask >> this->num_qubits) != 0 ||
+        (controls_mask & MASK(target_qubit - 1)) != 0) {
+        return unexpected(Error::invalid_input);
+    }
+
+    this->operations.push_back(
+        {{target_qubit}, MatrixN(matrix.begin(), matrix.end()), controls_mask, {}});
+    return {};
+}
+
+auto Circuit::controlled_x(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit - 1), target_qubit, gates::pauli_x());
+}
+
+auto Circuit::controlled_z(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit - 1), target_qubit, gates::pauli_z());
+}
+
+auto Circuit::controlled_phase(const int control_qubit, const int target_qubit,
+                               const double angle) -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit - 1), target_qubit,
+                            {complex<double>{1.0, 0.0}, 0.0, 0.0, polar(1.0, angle)});
+}
+
+auto Circuit::toffoli(const int control_qubit1, const int control_qubit2, const int target_qubit)
+    -> expected<void, Error> {
+    if (control_qubit1 > this->num_qubits || control_qubit1 <= 0 ||
+        control_qubit2 > this->num_qubits || control_qubit2 <= 0 ||
+        control_qubit1 == control_qubit2) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit1 - 1) | MASK(control_qubit2 - 1), target_qubit,
+                            gates::pauli_x());
+}
+
+auto Circuit::add_1q(const int target_qubit, const Matrix2& matrix) -> expected<void, Error> {
+    return this->add_gate({target_qubit}, MatrixN(matrix.begin(), matrix.end()));
+}
+
+auto Circuit::pauli_x(const int target_qubit) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::pauli_x());
+}
+
+auto Circuit::pauli_y(const int target_qubit) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::pauli_y());
+}
+
+auto Circuit::pauli_z(const int target_qubit) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::pauli_z());
+}
+
+auto Circuit::hadamard(const int target_qubit) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::hadamard());
+}
+
+auto Circuit::sqrt_pauli_x(const int target_qubit) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::sqrt_pauli_x());
+}
+
+auto Circuit::sqrt_pauli_y(const int target_qubit) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::sqrt_pauli_y());
+}
+
+auto Circuit::s_gate(const int target_qubit) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::s_gate());
+}
+
+auto Circuit::t_gate(const int target_qubit) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::t_gate());
+}
+
+auto Circuit::rotation_x(const int target_qubit, const double angle) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::rotation_x(angle));
+}
+
+auto Circuit::rotation_y(const int target_qubit, const double angle) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::rotation_y(angle));
+}
+
+auto Circuit::rotation_z(const int target_qubit, const double angle) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::rotation_z(angle));
+}
+
+auto Circuit::u3(const int target_qubit, const double theta, const double phi,
+                 const double lambda) -> expected<void, Error> {
+    return this->add_1q(target_qubit, gates::u3(theta, phi, lambda));
+}
+
+auto Circuit::append(const Circuit& other) -> expected<void, Error> {
+    if (other.num_qubits > this->num_qubits) {
+        return unexpected(Error::invalid_input);
+    }
+
+    this->operations.insert(this->operations.end(), other.operations.begin(),
+                            other.operations.end());
+    return {};
+}
+
+Circuit Circuit::compile(const int max_fused_qubits) const {
+    const int max_block = clamp(max_fused_qubits, 1, kernels::MAX_BLOCK_QUBITS);
+
+    // Single qubit gates commute with everything on other qubits, so each run is accumulated per
+    // qubit and only flushed when a multi qubit gate touches that qubit.
+    vector<optional<Operation>> pending(this->num_qubits);
+    vector<Operation> staged;
+    auto flush = [&](const int qubit) {
+        if (pending[qubit - 1]) {
+            staged.push_back(std::move(*pending[qubit - 1]));
+            pending[qubit - 1].reset();
+        }
+    };
+
+    for (const auto& op : this->operations) {
+        if (op.qubits.size() == 1 && op.controls == 0 && op.diagonals.empty()) {
+            auto& run = pending[op.qubits[0] - 1];
+            run = run ? fuse(*run, op, op.qubits) : op;
+            continue;
+        }
+        for (const int qubit : involved_qubits(op)) {
+            flush(qubit);
+        }
+        staged.push_back(op);
+    }
+    for (int qubit = 1; qubit <= this->num_qubits; qubit++) {
+        flush(qubit);
+    }
+
+    // Greedily grow either a dense block, while the union of qubits stays within max_block, or a
+    // batch of consecutive diagonal gates, which has no qubit limit
+    Circuit compiled(this->num_qubits);
+    optional<Operation> block;
+    for (auto& op : staged) {
+        if (block && !block->diagonals.empty()) {
+            if (is_diagonal(op)) {
+                ranges::copy(to_diagonal_gates(op), back_inserter(block->diagonals));
+                block->qubits = merge_qubits(*block, op);
+                continue;
+            }
+        } else if (block) {
+            auto qubits = merge_qubits(*block, op);
+            const bool fits = static_cast<int>(qubits.size()) <= max_block;
+            // Free to fold into the block when it adds no qubit, else diagonals prefer a batch
+            if (fits && (qubits == involved_qubits(*block) || !is_diagonal(op) ||
+                         !is_diagonal(*block))) {
+                block = fuse(*block, op, qubits);
+                continue;
+            }
+            if (is_diagonal(op) && is_diagonal(*block)) {
+                Operation batch = {qubits, {}, 0, to_diagonal_gates(*block)};
+                ranges::copy(to_diagonal_gates(op), back_inserter(batch.diagonals));
+                block = std::move(batch);
+                continue;
+            }
+        }
+
+        if (block) {
+            compiled.operations.push_back(std::move(*block));
+        }
+        block = std::move(op);
+    }
+    if (block) {
+        compiled.operations.push_back(std::move(*block));
+    }
+
+    return compiled;
+}
+
+template <typename T> auto Circuit::run(QStateVec<T>& state) const -> expected<void, Error> {
+    if (state.get_num_qubits() < this->num_qubits) {
+        return unexpected(Error::invalid_input);
+    }
+
+    for (const auto& op : this->operations) {
+        if (auto res = apply_operation(op, state); !res) {
+            return res;
+        }
+    }
+    return {};
+}
+
+template auto Circuit::run(QStateVec<float>& state) const -> expected<void, Error>;
+template auto Circuit::run(QStateVec<double>& state) const -> expected<void, Error>;
+
+template <typename T>
+auto Circuit::run_blocked(QStateVec<T>& state, const int block_qubits) const
+    -> expected<void, Error> {
+    if (state.get_num_qubits() < this->num_qubits) {
+        return unexpected(Error::invalid_input);
+    }
+    if (state.is_sparse()) {
+        return this->run(state);
+    }
+
+    const int num_qubits = state.get_num_qubits();
+    const int num_threads = state.get_num_threads();
+    const int chunk_qubits = min(max(block_qubits, kernels::MAX_BLOCK_QUBITS), num_qubits);
+    const int swap_slots = max(chunk_qubits / 2, min(kernels::MAX_BLOCK_QUBITS, chunk_qubits));
+    const auto gates = to_block_gates<T>(this->operations);
+    span<complex<T>> amps = state.main;
+    const bool mapped = state.main.get_allocator().is_mapped();
+    [[maybe_unused]] const uint64_t state_bytes = amps.size_bytes();
+
+    // physical[q] is the bit currently holding qubit q, logical[b] the qubit held by bit b
+    vector<int> physical(num_qubits);
+    vector<int> logical(num_qubits);
+    for (int bit = 0; bit < num_qubits; bit++) {
+        physical[bit] = bit;
+        logical[bit] = bit;
+    }
+    auto swap_qubits = [&](const vector<pair<int, int>>& pairs) {
+        // Every amplitude outside the fixed points of the swaps moves
+        PROFILE_SCOPE("swap_bits", 0, state_bytes - (state_bytes >> pairs.size()),
+                      state_bytes - (state_bytes >> pairs.size()));
+        kernels::swap_bits<T>(amps, pairs, num_threads);
+        for (const auto& [bit_a, bit_b] : pairs) {
+            swap(logical[bit_a], logical[bit_b]);
+            physical[logical[bit_a]] = bit_a;
+            physical[logical[bit_b]] = bit_b;
+        }
+    };
+
+    vector<BlockGate<T>> batch;
+    auto flush = [&]() {
+        PROFILE_SCOPE("blocked_batch", 0, batch.empty() ? 0 : state_bytes,
+                      batch.empty() ? 0 : state_bytes);
+        const uint64_t chunk_size = MASK(chunk_qubits);
+        const uint64_t num_chunks = amps.size() >> chunk_qubits;
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+        for (uint64_t chunk = 0; chunk < num_chunks; chunk++) {
+            const uint64_t base = chunk << chunk_qubits;
+            // Have the next chunk of a mapped file read in while this one is computed
+            if (mapped && chunk + 1 < num_chunks) {
+                mapped_storage::prefetch(&amps[base + chunk_size], chunk_size * sizeof(amps[0]));
+            }
+            for (const auto& gate : batch) {
+                apply_to_chunk<T>(amps.subspan(base, chunk_size), base, chunk_qubits, gate);
+            }
+        }
+        batch.clear();
+    };
+
+    for (size_t g = 0; g < gates.size(); g++) {
+        const auto& gate = gates[g];
+        // Diagonal gates and controls act within a chunk wherever their bits are
+        vector<int> needed = gate.diagonal ? vector<int>{} : gate.bits;
+        if (ranges::any_of(needed, [&](const int q) { return physical[q] >= chunk_qubits; })) {
+            flush();
+
+            // Qubits only ever move through the top swap_slots low bits, so the bits below stay
+            // put and kernels::swap_bits moves long contiguous runs. Qubits that are targets the
+            // soonest come in, in place of the slot qubits needed the latest, as long as that
+            // brings a qubit needed earlier.
+            vector<size_t> next_use(num_qubits, gates.size());
+            for (size_t later = gates.size(); later-- > g;) {
+                if (!gates[later].diagonal) {
+                    for (const int q : gates[later].bits) {
+                        next_use[q] = later;
+                    }
+                }
+            }
+            vector<int> incoming;
+            for (int bit = chunk_qubits; bit < num_qubits; bit++) {
+                incoming.push_back(bit);
+            }
+            ranges::sort(incoming, {}, [&](const int bit) { return next_use[logical[bit]]; });
+            vector<int> outgoing;
+            for (int bit = chunk_qubits - swap_slots; bit < chunk_qubits; bit++) {
+                if (next_use[logical[bit]] != g) {
+                    outgoing.push_back(bit);
+                }
+            }
+            ranges::sort(outgoing, greater{},
+                         [&](const int bit) { return next_use[logical[bit]]; });
+
+            vector<pair<int, int>> pairs;
+            for (size_t k = 0; k < min(incoming.size(), outgoing.size()) &&
+                               next_use[logical[incoming[k]]] < next_use[logical[outgoing[k]]];
+                 k++) {
+                pairs.emplace_back(outgoing[k], incoming[k]);
+            }
+            swap_qubits(pairs);
+        }
+
+        BlockGate<T> remapped = gate;
+        remapped.controls = 0;
+        for (int q = 0; q < num_qubits; q++) {
+            if ((gate.controls >> q) & 1) {
+                remapped.controls |= MASK(physical[q]);
+            }
+        }
+        ranges::transform(gate.bits, remapped.bits.begin(),
+                          [&](const int q) { return physical[q]; });
+        batch.push_back(std::move(remapped));
+    }
+    flush();
+
+    // Put every qubit back on its own bit, a pass of disjoint swaps at a time
+    while (true) {
+        vector<pair<int, int>> pairs;
+        vector<bool> used(num_qubits, false);
+        for (int bit = 0; bit < num_qubits; bit++) {
+            if (logical[bit] != bit && !used[bit] && !used[physical[bit]]) {
+                pairs.emplace_back(bit, physical[bit]);
+                used[bit] = true;
+                used[physical[bit]] = true;
+            }
+        }
+        if (pairs.empty()) {
+            return {};
+        }
+        swap_qubits(pairs);
+    }
+}
+
+template auto Circuit::run_blocked(QStateVec<float>& state, int block_qubits) const
+    -> expected<void, Error>;
+template auto Circuit::run_blocked(QStateVec<double>& state, int block_qubits) const
+    -> expected<void, Error>;
+
+int Circuit::get_num_qubits() const {
+    return this->num_qubits;
+}
+
+const vector<Operation>& Circuit::get_operations() const {
+    return this->operations;
+}
@@ -0,0 +1,129 @@
+#ifndef CIRCUIT_HPP
+#define CIRCUIT_HPP
+
+#include "kernels.hpp"
+#include "qstate_vec.hpp"
+#include <expected>
+#include <vector>
+
+/**
+ * A gate recorded in a circuit: a dense unitary over a small set of qubits.
+ * qubits[0] is the least significant bit of the matrix row/column index.
+ * When controls is not 0 the operation is a controlled single qubit gate: qubits holds the
+ * target and matrix is 2x2, applied where every control qubit (bit q - 1) is |1>.
+ * When diagonals is not empty the operation is a batch of diagonal gates applied in one sweep,
+ * and qubits lists every qubit they touch.
+ */
+struct Operation {
+    std::vector<int> qubits;
+    MatrixN matrix;
+    uint64_t controls = 0;
+    std::vector<DiagonalGate> diagonals;
+};
+
+/**
+ * @brief Returns every qubit the operation acts on, controls included, in ascending order.
+ */
+std::vector<int> involved_qubits(const Operation& op);
+
+/**
+ * @brief Applies one operation to the state vector, through the kernel matching its kind.
+ */
+template <typename T>
+auto apply_operation(const Operation& op, QStateVec<T>& state) -> std::expected<void, Error>;
+
+/**
+ * Records a sequence of gates and compiles it into fewer state vector passes before running it.
+ */
+class Circuit {
+  private:
+    std::vector<Operation> operations;
+    int num_qubits;
+
+    auto add_1q(int target_qubit, const Matrix2& matrix) -> std::expected<void, Error>;
+
+  public:
+    /**
+     * @brief Construct an empty circuit over num_qubits qubits.
+     *
+     * @param num_qubits
+     */
+    Circuit(int num_qubits);
+
+    /**
+     * @brief Appends a dense unitary over target_qubits, with the layout used by
+     *  QStateVec::apply_nq. Qubits are validated here, once, instead of on every run.
+     */
+    auto add_gate(const std::vector<int>& target_qubits, const MatrixN& matrix)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Appends a controlled single qubit gate, with the layout used by
+     *  QStateVec::controlled. It runs through the control subspace kernel unless fused.
+     */
+    auto controlled(uint64_t controls_mask, int target_qubit, const Matrix2& matrix)
+        -> std::expected<void, Error>;
+
+    auto controlled_x(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+    auto controlled_z(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+    auto controlled_phase(int control_qubit, int target_qubit, double angle)
+        -> std::expected<void, Error>;
+    auto toffoli(int control_qubit1, int control_qubit2, int target_qubit)
+        -> std::expected<void, Error>;
+
+    auto pauli_x(int target_qubit) -> std::expected<void, Error>;
+    auto pauli_y(int target_qubit) -> std::expected<void, Error>;
+    auto pauli_z(int target_qubit) -> std::expected<void, Error>;
+    auto hadamard(int target_qubit) -> std::expected<void, Error>;
+    auto sqrt_pauli_x(int target_qubit) -> std::expected<void, Error>;
+    auto sqrt_pauli_y(int target_qubit) -> std::expected<void, Error>;
+    auto s_gate(int target_qubit) -> std::expected<void, Error>;
+    auto t_gate(int target_qubit) -> std::expected<void, Error>;
+    auto rotation_x(int target_qubit, double angle) -> std::expected<void, Error>;
+    auto rotation_y(int target_qubit, double angle) -> std::expected<void, Error>;
+    auto rotation_z(int target_qubit, double angle) -> std::expected<void, Error>;
+    auto u3(int target_qubit, double theta, double phi, double lambda)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Appends every operation of other, which must not span more qubits than this circuit.
+     */
+    auto append(const Circuit& other) -> std::expected<void, Error>;
+
+    /**
+     * @brief Returns an equivalent circuit with fewer operations.
+     *  Runs of single qubit gates on the same qubit are multiplied into one 2x2 matrix, then
+     *  neighbouring operations are merged into dense blocks over at most max_fused_qubits qubits.
+     *  Consecutive diagonal gates, on any qubits, are batched into a single phase sweep.
+     *
+     * @param max_fused_qubits Largest block to build, clamped to kernels::MAX_BLOCK_QUBITS
+     */
+    [[nodiscard]] Circuit compile(int max_fused_qubits = 3) const;
+
+    /**
+     * @brief Applies every operation, in order, to the state vector.
+     *  Each operation is one pass over the state vector.
+     */
+    template <typename T> auto run(QStateVec<T>& state) const -> std::expected<void, Error>;
+
+    /**
+     * @brief Applies every operation, in order, to the state vector, a batch at a time.
+     *  Consecutive gates acting below bit block_qubits are applied to one 2^block_qubits chunk
+     *  of amplitudes after the other, so the chunk stays in cache for the whole batch instead of
+     *  each gate streaming the state vector. A gate on higher qubits first swaps them with low
+     *  qubits not needed soon; the layout is restored at the end. Diagonal gates and controls
+     *  never need a swap.
+     *  Sparse states fall back to run.
+     *
+     * @param block_qubits Chunk size, at least kernels::MAX_BLOCK_QUBITS
+     */
+    template <typename T>
+    auto run_blocked(QStateVec<T>& state, int block_qubits = kernels::CACHE_BLOCK_QUBITS) const
+        -> std::expected<void, Error>;
+
+    [[nodiscard]] int get_num_qubits() const;
+
+    [[nodiscard]] const std::vector<Operation>& get_operations() const;
+};
+
+#endif
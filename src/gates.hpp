@@ -0,0 +1,87 @@
+#ifndef GATES_HPP
+#define GATES_HPP
+
+#include "qstate_vec.hpp"
+#include <cmath>
+#include <complex>
+#include <numbers>
+
+/**
+ * Single qubit gate matrices. Rotations follow the R(theta) = exp(-i * theta * P / 2) convention.
+ */
+namespace gates {
+
+using Amplitude = std::complex<double>;
+
+inline Matrix2 pauli_x() {
+    return {Amplitude{0, 0}, Amplitude{1, 0}, Amplitude{1, 0}, Amplitude{0, 0}};
+}
+
+inline Matrix2 pauli_y() {
+    return {Amplitude{0, 0}, Amplitude{0, -1}, Amplitude{0, 1}, Amplitude{0, 0}};
+}
+
+inline Matrix2 pauli_z() {
+    return {Amplitude{1, 0}, Amplitude{0, 0}, Amplitude{0, 0}, Amplitude{-1, 0}};
+}
+
+inline Matrix2 hadamard() {
+    const double hadamard_const = 1 / std::numbers::sqrt2;
+    return {Amplitude{hadamard_const, 0}, Amplitude{hadamard_const, 0},
+            Amplitude{hadamard_const, 0}, Amplitude{-hadamard_const, 0}};
+}
+
+inline Matrix2 sqrt_pauli_x() {
+    const double half = 0.5;
+    return {Amplitude{half, half}, Amplitude{half, -half}, Amplitude{half, -half},
+            Amplitude{half, half}};
+}
+
+inline Matrix2 sqrt_pauli_y() {
+    const double half = 0.5;
+    return {Amplitude{half, half}, Amplitude{-half, -half}, Amplitude{half, half},
+            Amplitude{half, half}};
+}
+
+inline Matrix2 s_gate() {
+    return {Amplitude{1, 0}, Amplitude{0, 0}, Amplitude{0, 0}, Amplitude{0, 1}};
+}
+
+inline Matrix2 t_gate() {
+    const double t_const = 1 / std::numbers::sqrt2;
+    return {Amplitude{1, 0}, Amplitude{0, 0}, Amplitude{0, 0}, Amplitude{t_const, t_const}};
+}
+
+inline Matrix2 rotation_x(const double angle) {
+    const double cos_half = std::cos(angle / 2);
+    const double sin_half = std::sin(angle / 2);
+    return {Amplitude{cos_half, 0}, Amplitude{0, -sin_half}, Amplitude{0, -sin_half},
+            Amplitude{cos_half, 0}};
+}
+
+inline Matrix2 rotation_y(const double angle) {
+    const double cos_half = std::cos(angle / 2);
+    const double sin_half = std::sin(angle / 2);
+    return {Amplitude{cos_half, 0}, Amplitude{-sin_half, 0}, Amplitude{sin_half, 0},
+            Amplitude{cos_half, 0}};
+}
+
+inline Matrix2 rotation_z(const double angle) {
+    return {std::polar<double>(1, -angle / 2), Amplitude{0, 0}, Amplitude{0, 0},
+            std::polar<double>(1, angle / 2)};
+}
+
+/**
+ * @brief Generic single qubit rotation U3(theta, phi, lambda), as defined by OpenQASM.
+ */
+inline Matrix2 u3(const double theta, const double phi,
+                  const double lambda) {
+    const double cos_half = std::cos(theta / 2);
+    const double sin_half = std::sin(theta / 2);
+    return {Amplitude{cos_half, 0}, -std::polar(sin_half, lambda), std::polar(sin_half, phi),
+            std::polar(cos_half, phi + lambda)};
+}
+
+} // namespace gates
+
+#endif
@@ -0,0 +1,68 @@
+#include "huge_pages.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+#include <sys/mman.h>
+
+using namespace std;
+
+namespace {
+
+enum class Mode : uint8_t { off, transparent, explicit_pages };
+
+Mode mode() {
+    const char* env = getenv("QSIM_HUGE_PAGES");
+    const string_view name = env != nullptr ? env : "";
+    if (name == "off") {
+        return Mode::off;
+    }
+    return name == "explicit" ? Mode::explicit_pages : Mode::transparent;
+}
+
+size_t rounded_length(const size_t bytes) {
+    return (bytes + huge_pages::HUGE_PAGE_SIZE - 1) & ~(huge_pages::HUGE_PAGE_SIZE - 1);
+}
+
+} // namespace
+
+namespace huge_pages {
+
+void* allocate(const size_t bytes) {
+    const size_t length = rounded_length(bytes);
+    const Mode page_mode = mode();
+    if (page_mode == Mode::explicit_pages) {
+        void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            return ptr;
+        }
+    }
+
+    // One extra huge page of address space, trimmed at both ends, aligns the start to 2 MiB
+    void* raw = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        throw bad_alloc();
+    }
+    const auto start = reinterpret_cast<uintptr_t>(raw);
+    const uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (aligned > start) {
+        munmap(raw, aligned - start);
+    }
+    if (const uintptr_t tail = start + HUGE_PAGE_SIZE - aligned; tail > 0) {
+        munmap(reinterpret_cast<void*>(aligned + length), tail);
+    }
+
+    void* ptr = reinterpret_cast<void*>(aligned);
+    if (page_mode != Mode::off) {
+        madvise(ptr, length, MADV_HUGEPAGE);
+    }
+    return ptr;
+}
+
+void deallocate(void* ptr, const size_t bytes) noexcept {
+    munmap(ptr, rounded_length(bytes));
+}
+
+} // namespace huge_pages
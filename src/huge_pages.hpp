@@ -0,0 +1,35 @@
+#ifndef HUGE_PAGES_HPP
+#define HUGE_PAGES_HPP
+
+#include <cstddef>
+
+/**
+ * Anonymous memory for large state vectors, backed by 2 MiB pages so a pass over a 30+ qubit
+ * state does not miss the TLB on every 4 KiB. The QSIM_HUGE_PAGES environment variable selects
+ * the page source:
+ *  - "transparent" (default): regular pages aligned to 2 MiB and marked MADV_HUGEPAGE, which the
+ *    kernel backs with huge pages when /sys/kernel/mm/transparent_hugepage allows it;
+ *  - "explicit": pages from the reserved hugetlbfs pool (vm.nr_hugepages), falling back to
+ *    transparent ones when the pool is too small;
+ *  - "off": regular pages.
+ * The pages are zero and not touched here, so each one is placed on the NUMA node of the thread
+ * that first writes it.
+ */
+namespace huge_pages {
+
+constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{1} << 21;
+
+/**
+ * @brief Maps bytes of zero-filled memory, aligned to HUGE_PAGE_SIZE.
+ *  Throws std::bad_alloc on failure.
+ */
+void* allocate(std::size_t bytes);
+
+/**
+ * @brief Releases memory returned by allocate for the same number of bytes.
+ */
+void deallocate(void* ptr, std::size_t bytes) noexcept;
+
+} // namespace huge_pages
+
+#endif
@@ -0,0 +1,821 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <omp.h>
+#include <random>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * State vector kernels.
+ * Every kernel updates the amplitudes in place, visiting each pair (i, i | mask) exactly once,
+ * so a gate is a single read/write pass over the state vector.
+ * Pairs are independent, so the pass is split statically over num_threads OpenMP threads;
+ * num_threads == 1 runs serially without entering a parallel region.
+ */
+namespace kernels {
+
+/**
+ * Below this many qubits the state vector sits in cache and threading overhead dominates.
+ */
+constexpr int PARALLEL_QUBIT_THRESHOLD = 14;
+
+/**
+ * @brief Returns the thread count for a state of num_qubits qubits: requested when positive,
+ *  else QSIM_NUM_THREADS when set, else the OpenMP default. Always 1 below the threshold.
+ */
+inline int resolve_num_threads(const int num_qubits, const int requested) {
+    if (num_qubits < PARALLEL_QUBIT_THRESHOLD) {
+        return 1;
+    }
+    if (requested > 0) {
+        return requested;
+    }
+
+    if (const char* env = std::getenv("QSIM_NUM_THREADS")) {
+        int from_env = 0;
+        const auto [ptr, ec] = std::from_chars(env, env + std::strlen(env), from_env);
+        if (ec == std::errc{} && from_env > 0) {
+            return from_env;
+        }
+    }
+    return omp_get_max_threads();
+}
+
+/**
+ * @brief Writes zeros over the amplitudes with a static split of the index range. For every
+ *  target but the top ones, that gives each thread the same contiguous range the pair kernels
+ *  give it, so on a NUMA machine the pages of fresh storage land on the node of the thread that
+ *  updates them.
+ */
+template <typename T> void first_touch(std::span<std::complex<T>> amps, const int num_threads) {
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t i = 0; i < amps.size(); i++) {
+        amps[i] = {};
+    }
+}
+
+/**
+ * @brief Inserts a zero bit at position `bit` of `index`, shifting the higher bits up.
+ *  Enumerating k in [0, 2^(n-1)) yields every index whose `bit` is 0.
+ */
+constexpr uint64_t insert_zero_bit(const uint64_t index, const int bit) {
+    const uint64_t low_bits = index & ((0x1ull << bit) - 1);
+    return ((index >> bit) << (bit + 1)) | low_bits;
+}
+
+/**
+ * Targets below this have a pair loop compiled for their stride: up to 32 amplitudes apart, so
+ * within a couple of cache lines and where the generic loop's index arithmetic costs the most
+ * relative to the gate.
+ */
+constexpr int NUM_SPECIALIZED_TARGETS = 6;
+
+/**
+ * @brief for_each_pair with the target fixed at compile time. The amplitudes are visited in
+ *  blocks of 2^(Target + 1), whose first half holds the i0 of the block's pairs, so the indices
+ *  are a constant offset apart and the fixed length inner loop unrolls. Blocks are split
+ *  statically over the threads, which leaves each thread the same contiguous range.
+ */
+template <int Target, typename Func>
+void for_each_pair_fixed(const uint64_t size, const int num_threads, Func& func) {
+    constexpr uint64_t stride = 0x1ull << Target;
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t block = 0; block < size / (2 * stride); block++) {
+        const uint64_t base = block * 2 * stride;
+        for (uint64_t offset = 0; offset < stride; offset++) {
+            func(base + offset, base + offset + stride);
+        }
+    }
+}
+
+/**
+ * @brief Calls func(i0, i1) for every amplitude pair that differs only on bit `target`,
+ *  with i0 being the index where the target bit is 0.
+ *  Low targets go through a table of for_each_pair_fixed instantiations for the functor, built at
+ *  compile time; higher ones, whose pairs are far apart anyway, through a generic loop that
+ *  inserts the target bit into a pair counter.
+ */
+template <typename Func>
+void for_each_pair(const uint64_t size, const int target, const int num_threads, Func&& func) {
+    using Functor = std::remove_reference_t<Func>;
+    static constexpr auto specialized =
+        []<int... Targets>(std::integer_sequence<int, Targets...>) {
+            return std::array{&for_each_pair_fixed<Targets, Functor>...};
+        }(std::make_integer_sequence<int, NUM_SPECIALIZED_TARGETS>{});
+    if (target < NUM_SPECIALIZED_TARGETS) {
+        specialized[target](size, num_threads, func);
+        return;
+    }
+
+    const uint64_t mask = 0x1ull << target;
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t k = 0; k < size / 2; k++) {
+        const uint64_t i0 = insert_zero_bit(k, target);
+        func(i0, i0 | mask);
+    }
+}
+
+/**
+ * @brief Calls func(i0, i1) for every amplitude pair that differs only on bit `target` and has
+ *  every bit of controls_mask set. Only the 2^(n-k-1) qualifying pairs are enumerated: each free
+ *  index gets a zero inserted at every control and target bit, then the control bits are set.
+ */
+template <typename Func>
+void for_each_controlled_pair(const uint64_t size, const uint64_t controls_mask, const int target,
+                              const int num_threads, Func&& func) {
+    const uint64_t mask = 0x1ull << target;
+    const uint64_t fixed_mask = controls_mask | mask;
+
+    std::array<int, 64> fixed_bits{};
+    int num_fixed = 0;
+    for (int bit = 0; (fixed_mask >> bit) != 0; bit++) {
+        if ((fixed_mask >> bit) & 0x1ull) {
+            fixed_bits[num_fixed++] = bit;
+        }
+    }
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t k = 0; k < (size >> num_fixed); k++) {
+        uint64_t i0 = k;
+        for (int j = 0; j < num_fixed; j++) {
+            i0 = insert_zero_bit(i0, fixed_bits[j]);
+        }
+        i0 |= controls_mask;
+        func(i0, i0 | mask);
+    }
+}
+
+/**
+ * @brief Returns m0 * a0 + m1 * a1.
+ *  Spelled out on the real and imaginary parts, std::complex multiplication would otherwise go
+ *  through the NaN/Inf-checking library call and block vectorization.
+ */
+template <typename T>
+inline std::complex<T> mul_add(const std::complex<T>& m0, const std::complex<T>& a0,
+                               const std::complex<T>& m1, const std::complex<T>& a1) {
+    return {m0.real() * a0.real() - m0.imag() * a0.imag() + m1.real() * a1.real() -
+                m1.imag() * a1.imag(),
+            m0.real() * a0.imag() + m0.imag() * a0.real() + m1.real() * a1.imag() +
+                m1.imag() * a1.real()};
+}
+
+/**
+ * @brief Returns lhs * rhs, spelled out for the same reason as mul_add.
+ */
+template <typename T>
+inline std::complex<T> mul(const std::complex<T>& lhs, const std::complex<T>& rhs) {
+    return {lhs.real() * rhs.real() - lhs.imag() * rhs.imag(),
+            lhs.real() * rhs.imag() + lhs.imag() * rhs.real()};
+}
+
+/**
+ * @brief Rounds a double precision gate matrix to the precision of the state vector.
+ */
+template <typename T>
+std::array<std::complex<T>, 4> cast_matrix(const std::array<std::complex<double>, 4>& matrix) {
+    return {std::complex<T>(matrix[0]), std::complex<T>(matrix[1]), std::complex<T>(matrix[2]),
+            std::complex<T>(matrix[3])};
+}
+
+template <typename T>
+std::vector<std::complex<T>> cast_matrix(const std::vector<std::complex<double>>& matrix) {
+    return {matrix.begin(), matrix.end()};
+}
+
+/**
+ * @brief Applies the row-major 2x2 matrix {m00, m01, m10, m11} to the target qubit.
+ */
+template <typename T>
+void apply_1q(std::span<std::complex<T>> amps, const int target,
+              const std::array<std::complex<T>, 4>& matrix, const int num_threads) {
+    for_each_pair(amps.size(), target, num_threads, [&](const uint64_t i0, const uint64_t i1) {
+        const std::complex<T> amp0 = amps[i0];
+        const std::complex<T> amp1 = amps[i1];
+        amps[i0] = mul_add(matrix[0], amp0, matrix[1], amp1);
+        amps[i1] = mul_add(matrix[2], amp0, matrix[3], amp1);
+    });
+}
+
+/**
+ * @brief Applies the 2x2 matrix to the target bit of the amplitudes whose control bits are all set.
+ */
+template <typename T>
+void controlled_apply_1q(std::span<std::complex<T>> amps, const uint64_t controls_mask,
+                         const int target, const std::array<std::complex<T>, 4>& matrix,
+                         const int num_threads) {
+    for_each_controlled_pair(amps.size(), controls_mask, target, num_threads,
+                             [&](const uint64_t i0, const uint64_t i1) {
+                                 const std::complex<T> amp0 = amps[i0];
+                                 const std::complex<T> amp1 = amps[i1];
+                                 amps[i0] = mul_add(matrix[0], amp0, matrix[1], amp1);
+                                 amps[i1] = mul_add(matrix[2], amp0, matrix[3], amp1);
+                             });
+}
+
+template <typename T>
+void controlled_pauli_x(std::span<std::complex<T>> amps, const uint64_t controls_mask,
+                        const int target, const int num_threads) {
+    for_each_controlled_pair(
+        amps.size(), controls_mask, target, num_threads,
+        [&](const uint64_t i0, const uint64_t i1) { std::swap(amps[i0], amps[i1]); });
+}
+
+/**
+ * @brief Multiplies the amplitudes by diagonal[b], b being their target bit, on the basis states
+ *  where every control bit is set. No amplitudes are exchanged, and the |0> half is not touched
+ *  at all when diagonal[0] == 1 (Z, S, T, CZ, controlled phase).
+ */
+template <typename T>
+void apply_diagonal(std::span<std::complex<T>> amps, const uint64_t controls_mask,
+                    const int target, const std::array<std::complex<T>, 2>& diagonal,
+                    const int num_threads) {
+    auto scale = [&](const uint64_t i0, const uint64_t i1) {
+        if (diagonal[0] != std::complex<T>{1, 0}) {
+            amps[i0] = mul(amps[i0], diagonal[0]);
+        }
+        amps[i1] = mul(amps[i1], diagonal[1]);
+    };
+
+    if (controls_mask == 0) {
+        for_each_pair(amps.size(), target, num_threads, scale);
+    } else {
+        for_each_controlled_pair(amps.size(), controls_mask, target, num_threads, scale);
+    }
+}
+
+/**
+ * Number of index bits covered by one phase lookup table.
+ */
+constexpr int PHASE_CHUNK_BITS = 8;
+
+/**
+ * Product of many diagonal phases, ready to be applied in one sweep.
+ * The phase of basis state i is the product of chunks[c][(i >> 8c) & 0xFF] over every 8-bit
+ * chunk c of the index, times every cross term whose mask bits are all set in i.
+ */
+template <typename T> struct PhaseTable {
+    std::vector<std::array<std::complex<T>, 0x1ull << PHASE_CHUNK_BITS>> chunks;
+    std::vector<std::pair<uint64_t, std::complex<T>>> cross_terms;
+};
+
+/**
+ * @brief Builds the phase table of a product of terms, each multiplying by `phase` the basis
+ *  states that have every bit of `mask` set. Terms whose mask lies inside a single chunk are
+ *  folded into that chunk's table; the others become cross terms.
+ */
+template <typename T>
+PhaseTable<T> make_phase_table(const int num_bits,
+                               const std::vector<std::pair<uint64_t, std::complex<double>>>& terms,
+                               const std::complex<double> global_phase) {
+    const int num_chunks = std::max(1, (num_bits + PHASE_CHUNK_BITS - 1) / PHASE_CHUNK_BITS);
+    const uint64_t chunk_mask = (0x1ull << PHASE_CHUNK_BITS) - 1;
+
+    std::vector<std::array<std::complex<double>, 0x1ull << PHASE_CHUNK_BITS>> chunks(num_chunks);
+    for (auto& chunk : chunks) {
+        chunk.fill({1.0, 0.0});
+    }
+    for (auto& entry : chunks[0]) {
+        entry *= global_phase;
+    }
+
+    PhaseTable<T> table;
+    for (const auto& [mask, phase] : terms) {
+        const int chunk = std::countr_zero(mask) / PHASE_CHUNK_BITS;
+        const uint64_t local_mask = mask >> (chunk * PHASE_CHUNK_BITS);
+        if ((local_mask & ~chunk_mask) != 0) {
+            table.cross_terms.emplace_back(mask, std::complex<T>(phase));
+            continue;
+        }
+        for (uint64_t entry = 0; entry <= chunk_mask; entry++) {
+            if ((entry & local_mask) == local_mask) {
+                chunks[chunk][entry] *= phase;
+            }
+        }
+    }
+
+    table.chunks.resize(num_chunks);
+    for (int chunk = 0; chunk < num_chunks; chunk++) {
+        for (uint64_t entry = 0; entry <= chunk_mask; entry++) {
+            table.chunks[chunk][entry] = std::complex<T>(chunks[chunk][entry]);
+        }
+    }
+    return table;
+}
+
+/**
+ * @brief Multiplies every amplitude by its phase from the table, in a single sweep.
+ */
+template <typename T>
+void apply_phases(std::span<std::complex<T>> amps, const PhaseTable<T>& table,
+                  const int num_threads) {
+    const auto num_chunks = static_cast<int>(table.chunks.size());
+    const uint64_t chunk_mask = (0x1ull << PHASE_CHUNK_BITS) - 1;
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t i = 0; i < amps.size(); i++) {
+        std::complex<T> phase = table.chunks[0][i & chunk_mask];
+        for (int chunk = 1; chunk < num_chunks; chunk++) {
+            phase = mul(phase, table.chunks[chunk][(i >> (chunk * PHASE_CHUNK_BITS)) & chunk_mask]);
+        }
+        for (const auto& [mask, cross_phase] : table.cross_terms) {
+            if ((i & mask) == mask) {
+                phase = mul(phase, cross_phase);
+            }
+        }
+        amps[i] = mul(amps[i], phase);
+    }
+}
+
+/**
+ * Largest number of qubits a dense block unitary may act on.
+ */
+constexpr int MAX_BLOCK_QUBITS = 6;
+
+/**
+ * @brief Applies the row-major 2^k x 2^k matrix to the k target bits in a single pass.
+ *  targets[0] is the least significant bit of the matrix row/column index.
+ *  Each group of 2^k amplitudes that differ only on the target bits is gathered, multiplied and
+ *  scattered back in place.
+ */
+template <typename T>
+void apply_nq(std::span<std::complex<T>> amps, const std::vector<int>& targets,
+              const std::vector<std::complex<T>>& matrix, const int num_threads) {
+    const auto num_targets = static_cast<int>(targets.size());
+    const uint64_t block_size = 0x1ull << num_targets;
+
+    std::vector<int> sorted_targets = targets;
+    std::ranges::sort(sorted_targets);
+
+    // Offset of every local basis state from the group base index
+    std::array<uint64_t, 0x1ull << MAX_BLOCK_QUBITS> offsets{};
+    for (uint64_t local = 0; local < block_size; local++) {
+        for (int j = 0; j < num_targets; j++) {
+            if ((local >> j) & 0x1ull) {
+                offsets[local] |= 0x1ull << targets[j];
+            }
+        }
+    }
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t k = 0; k < amps.size() / block_size; k++) {
+        // Left uninitialized, only the first block_size entries are written then read
+        std::array<T, 0x1ull << MAX_BLOCK_QUBITS> block_real;
+        std::array<T, 0x1ull << MAX_BLOCK_QUBITS> block_imag;
+        uint64_t base = k;
+        for (const int bit : sorted_targets) {
+            base = insert_zero_bit(base, bit);
+        }
+
+        for (uint64_t row = 0; row < block_size; row++) {
+            block_real[row] = amps[base + offsets[row]].real();
+            block_imag[row] = amps[base + offsets[row]].imag();
+        }
+        for (uint64_t row = 0; row < block_size; row++) {
+            T real = 0;
+            T imag = 0;
+            const std::complex<T>* matrix_row = &matrix[row * block_size];
+            for (uint64_t col = 0; col < block_size; col++) {
+                real += matrix_row[col].real() * block_real[col] -
+                        matrix_row[col].imag() * block_imag[col];
+                imag += matrix_row[col].real() * block_imag[col] +
+                        matrix_row[col].imag() * block_real[col];
+            }
+            amps[base + offsets[row]] = {real, imag};
+        }
+    }
+}
+
+template <typename T>
+void pauli_x(std::span<std::complex<T>> amps, const int target, const int num_threads) {
+    for_each_pair(amps.size(), target, num_threads,
+                  [&](const uint64_t i0, const uint64_t i1) { std::swap(amps[i0], amps[i1]); });
+}
+
+template <typename T>
+void pauli_y(std::span<std::complex<T>> amps, const int target, const int num_threads) {
+    // |0> -> i|1>, |1> -> -i|0>
+    for_each_pair(amps.size(), target, num_threads, [&](const uint64_t i0, const uint64_t i1) {
+        const std::complex<T> amp0 = amps[i0];
+        const std::complex<T> amp1 = amps[i1];
+        amps[i0] = {amp1.imag(), -amp1.real()};
+        amps[i1] = {-amp0.imag(), amp0.real()};
+    });
+}
+
+/**
+ * @brief Returns the total probability of the indices with bit `target` cleared and set.
+ */
+template <typename T>
+std::pair<double, double> pair_probabilities(std::span<const std::complex<T>> amps,
+                                             const int target, const int num_threads) {
+    const uint64_t mask = 0x1ull << target;
+    double p0 = 0;
+    double p1 = 0;
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) reduction(+ : p0, p1)      \
+    schedule(static)
+    for (uint64_t k = 0; k < amps.size() / 2; k++) {
+        const uint64_t i0 = insert_zero_bit(k, target);
+        p0 += std::norm(amps[i0]);
+        p1 += std::norm(amps[i0 | mask]);
+    }
+    return {p0, p1};
+}
+
+/**
+ * @brief Projects bit `target` onto outcome and multiplies the kept amplitudes by scale.
+ *  With reset the kept amplitudes are written to the index with the bit cleared.
+ */
+template <typename T>
+void collapse(std::span<std::complex<T>> amps, const int target, const int outcome,
+              const T scale, const bool reset, const int num_threads) {
+    for_each_pair(amps.size(), target, num_threads, [&](const uint64_t i0, const uint64_t i1) {
+        const std::complex<T> kept = amps[outcome == 0 ? i0 : i1] * scale;
+        amps[i0] = outcome == 0 || reset ? kept : std::complex<T>{};
+        amps[i1] = outcome == 1 && !reset ? kept : std::complex<T>{};
+    });
+}
+
+/**
+ * @brief Exchanges bits a and b of every index, for every (a, b) pair, in one pass.
+ *  The pairs are disjoint, so the index permutation is its own inverse and each amplitude pair
+ *  is swapped once, from its smaller index. Bits below the lowest swapped bit are left alone, so
+ *  whole runs of amplitudes move together: the higher the swapped bits, the closer this gets to
+ *  a streaming copy.
+ */
+template <typename T>
+void swap_bits(std::span<std::complex<T>> amps, std::span<const std::pair<int, int>> pairs,
+               const int num_threads) {
+    int lowest = std::countr_zero(amps.size());
+    for (const auto& [bit_a, bit_b] : pairs) {
+        lowest = std::min({lowest, bit_a, bit_b});
+    }
+    const uint64_t run = 0x1ull << lowest;
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t r = 0; r < (amps.size() >> lowest); r++) {
+        const uint64_t i = r << lowest;
+        uint64_t j = i;
+        for (const auto& [bit_a, bit_b] : pairs) {
+            if (((i >> bit_a) ^ (i >> bit_b)) & 1) {
+                j ^= (0x1ull << bit_a) | (0x1ull << bit_b);
+            }
+        }
+        if (j > i) {
+            std::swap_ranges(amps.begin() + i, amps.begin() + i + run, amps.begin() + j);
+        }
+    }
+}
+
+/**
+ * Blocked execution works on chunks of 2^CACHE_BLOCK_QUBITS amplitudes: 512 KiB in double
+ * precision, so a chunk stays in L2 while a whole batch of gates runs on it.
+ */
+constexpr int CACHE_BLOCK_QUBITS = 15;
+
+/**
+ * Measurement kernels split the index into a low part of up to MARGINAL_BLOCK_BITS bits and a
+ * high part, so each block of consecutive amplitudes shares one high part.
+ */
+constexpr int MARGINAL_BLOCK_BITS = 10;
+
+/**
+ * @brief Returns, for each of the num_bits bits of the index, the total probability of the
+ *  indices with that bit set, in one pass.
+ *  Each thread accumulates the probabilities of every low part into a small array, and block
+ *  totals into the high bits it has set; the low array is folded into marginals once at the end.
+ *
+ * @param probability Returns the probability of index i
+ */
+template <typename T, typename Func>
+std::vector<T> marginal_probabilities(const uint64_t size, const int num_bits,
+                                      const int num_threads, Func&& probability) {
+    const int low_bits = std::min(num_bits, MARGINAL_BLOCK_BITS);
+    const int high_bits = num_bits - low_bits;
+    const uint64_t block_size = 1ull << low_bits;
+    const uint64_t num_blocks = size >> low_bits;
+
+    std::vector<T> low_sums(block_size, 0);
+    std::vector<T> marginals(num_bits, 0);
+#pragma omp parallel num_threads(num_threads) if (num_threads > 1)
+    {
+        std::vector<T> local_low(block_size, 0);
+        std::vector<T> local_high(high_bits, 0);
+
+#pragma omp for schedule(static)
+        for (uint64_t block = 0; block < num_blocks; block++) {
+            const uint64_t base = block << low_bits;
+            T total = 0;
+#pragma omp simd reduction(+ : total)
+            for (uint64_t i = 0; i < block_size; i++) {
+                const T p = probability(base + i);
+                local_low[i] += p;
+                total += p;
+            }
+            for (int j = 0; j < high_bits; j++) {
+                local_high[j] += ((block >> j) & 1) != 0 ? total : 0;
+            }
+        }
+
+#pragma omp critical
+        {
+            for (uint64_t i = 0; i < block_size; i++) {
+                low_sums[i] += local_low[i];
+            }
+            for (int j = 0; j < high_bits; j++) {
+                marginals[low_bits + j] += local_high[j];
+            }
+        }
+    }
+
+    for (uint64_t i = 0; i < block_size; i++) {
+        for (int j = 0; j < low_bits; j++) {
+            marginals[j] += ((i >> j) & 1) != 0 ? low_sums[i] : 0;
+        }
+    }
+    return marginals;
+}
+
+/**
+ * @brief Returns the joint distribution of the given index bits: entry m is the total
+ *  probability of the indices whose bit bits[k] equals bit k of m, for every k.
+ *  The output index of every low part is tabulated once and each block adds the output index of
+ *  its high part, so the pass is one table lookup and one add per amplitude.
+ *  Each thread owns a copy of the 2^bits.size() distribution, summed at the end.
+ *
+ * @param bits Distinct 0-based index bits, all below log2(size)
+ * @param probability Returns the probability of index i
+ */
+template <typename T, typename Func>
+std::vector<T> joint_probabilities(const uint64_t size, std::span<const int> bits,
+                                   const int num_threads, Func&& probability) {
+    auto gather = [&](const uint64_t index) {
+        uint64_t out = 0;
+        for (size_t k = 0; k < bits.size(); k++) {
+            out |= ((index >> bits[k]) & 1) << k;
+        }
+        return out;
+    };
+
+    const int low_bits = std::min(std::countr_zero(size), MARGINAL_BLOCK_BITS);
+    const uint64_t block_size = 1ull << low_bits;
+    const uint64_t num_blocks = size >> low_bits;
+    std::vector<uint64_t> low_index(block_size);
+    for (uint64_t i = 0; i < block_size; i++) {
+        low_index[i] = gather(i);
+    }
+
+    std::vector<T> distribution(1ull << bits.size(), 0);
+#pragma omp parallel num_threads(num_threads) if (num_threads > 1)
+    {
+        std::vector<T> local(distribution.size(), 0);
+
+#pragma omp for schedule(static)
+        for (uint64_t block = 0; block < num_blocks; block++) {
+            const uint64_t base = block << low_bits;
+            const uint64_t high_index = gather(base);
+            for (uint64_t i = 0; i < block_size; i++) {
+                local[high_index | low_index[i]] += probability(base + i);
+            }
+        }
+
+#pragma omp critical
+        for (size_t m = 0; m < distribution.size(); m++) {
+            distribution[m] += local[m];
+        }
+    }
+    return distribution;
+}
+
+/**
+ * How one amplitude pair (i, i ^ flip_mask), i being the smaller index, adds to the expectation of
+ * the Pauli string with X or Y on the bits of flip_mask and Z or Y on the bits of z_mask.
+ * Writing P = (-i)^num_y X^flip Z^z up to the sign (-1)^popcount(i & z) of the pair, the two
+ * terms conj(a_i) a_j and conj(a_j) a_i add up to scale times the real or the imaginary part of
+ * p = conj(a_i) a_j. Without flips every index is its own pair and adds |a_i|^2.
+ */
+struct PauliPairWeight {
+    double scale;
+    bool imaginary;
+};
+
+inline PauliPairWeight pauli_pair_weight(const uint64_t flip_mask, const uint64_t z_mask) {
+    if (flip_mask == 0) {
+        return {1.0, false};
+    }
+    switch (std::popcount(flip_mask & z_mask) % 4) {
+    case 0:
+        return {2.0, false};
+    case 1:
+        return {2.0, true};
+    case 2:
+        return {-2.0, false};
+    default:
+        return {-2.0, true};
+    }
+}
+
+/**
+ * Pauli expectations visit the amplitude pairs in blocks of 2^PAULI_BLOCK_BITS, with a table of
+ * the signs of the low bits per term: 2 KiB per term in double precision, so a group of a few
+ * dozen terms stays in L1/L2.
+ */
+constexpr int PAULI_BLOCK_BITS = 8;
+
+/**
+ * @brief Returns the expectation value of every Pauli string sharing the X/Y mask flip_mask, one
+ *  per Z/Y mask, in one pass reading each amplitude once: every string of the group is a signed
+ *  sum over the same amplitude pairs. The overlaps of a block of pairs are computed once, and
+ *  each term adds their dot product with its sign table times the sign of the block's high bits.
+ *  Each thread keeps its own sums, added up at the end.
+ */
+template <typename T>
+std::vector<double> pauli_expectations(std::span<const std::complex<T>> amps,
+                                       const uint64_t flip_mask,
+                                       std::span<const uint64_t> z_masks, const int num_threads) {
+    const size_t num_terms = z_masks.size();
+    // Pairs are enumerated from the indices with the top flipped bit cleared: pair k is index
+    // insert_zero_bit(k, pair_bit), so its signs come from k and the z masks without that bit
+    const int pair_bit = flip_mask == 0 ? -1 : std::bit_width(flip_mask) - 1;
+    const uint64_t num_pairs = flip_mask == 0 ? amps.size() : amps.size() / 2;
+    std::vector<PauliPairWeight> weights(num_terms);
+    std::vector<uint64_t> pair_z_masks(num_terms);
+    for (size_t t = 0; t < num_terms; t++) {
+        weights[t] = pauli_pair_weight(flip_mask, z_masks[t]);
+        const uint64_t z_mask = z_masks[t];
+        pair_z_masks[t] = pair_bit < 0 ? z_mask
+                                       : (z_mask & ((0x1ull << pair_bit) - 1)) |
+                                             ((z_mask >> (pair_bit + 1)) << pair_bit);
+    }
+
+    const int low_bits = std::min(std::countr_zero(num_pairs), PAULI_BLOCK_BITS);
+    const uint64_t block_size = 0x1ull << low_bits;
+    const uint64_t num_blocks = num_pairs >> low_bits;
+    std::vector<double> signs(num_terms * block_size);
+    for (size_t t = 0; t < num_terms; t++) {
+        for (uint64_t l = 0; l < block_size; l++) {
+            signs[t * block_size + l] = (std::popcount(l & pair_z_masks[t]) & 1) != 0 ? -1 : 1;
+        }
+    }
+
+    std::vector<double> sums(num_terms, 0);
+#pragma omp parallel num_threads(num_threads) if (num_threads > 1)
+    {
+        std::vector<double> local(num_terms, 0);
+        // Real and imaginary parts of conj(a_i) * a_(i ^ flip_mask) over the block
+        std::vector<double> overlap_real(block_size);
+        std::vector<double> overlap_imag(block_size);
+
+#pragma omp for schedule(static)
+        for (uint64_t block = 0; block < num_blocks; block++) {
+            const uint64_t base = block << low_bits;
+            for (uint64_t l = 0; l < block_size; l++) {
+                const uint64_t i = pair_bit < 0 ? base + l : insert_zero_bit(base + l, pair_bit);
+                const std::complex<double> amp = amps[i];
+                const std::complex<double> partner = amps[i ^ flip_mask];
+                overlap_real[l] = amp.real() * partner.real() + amp.imag() * partner.imag();
+                overlap_imag[l] = amp.real() * partner.imag() - amp.imag() * partner.real();
+            }
+
+            for (size_t t = 0; t < num_terms; t++) {
+                const double* overlap =
+                    weights[t].imaginary ? overlap_imag.data() : overlap_real.data();
+                const double* sign = &signs[t * block_size];
+                double dot = 0;
+#pragma omp simd reduction(+ : dot)
+                for (uint64_t l = 0; l < block_size; l++) {
+                    dot += sign[l] * overlap[l];
+                }
+                local[t] += (std::popcount(base & pair_z_masks[t]) & 1) != 0 ? -dot : dot;
+            }
+        }
+
+#pragma omp critical
+        for (size_t t = 0; t < num_terms; t++) {
+            sums[t] += local[t];
+        }
+    }
+
+    for (size_t t = 0; t < num_terms; t++) {
+        sums[t] *= weights[t].scale;
+    }
+    return sums;
+}
+
+/**
+ * @brief Returns shots sorted uniforms in [0, scale), drawn in O(shots) without sorting: the
+ *  running sums of shots + 1 exponential variates, normalized by the last one, are distributed
+ *  as the order statistics of shots uniforms.
+ */
+inline std::vector<double> sorted_uniforms(const uint64_t shots, const double scale,
+                                           std::mt19937_64& rng) {
+    std::exponential_distribution<double> exponential;
+    std::vector<double> uniforms(shots);
+    double sum = 0;
+    for (auto& uniform : uniforms) {
+        sum += exponential(rng);
+        uniform = sum;
+    }
+    const double norm = scale / (sum + exponential(rng));
+    for (auto& uniform : uniforms) {
+        uniform *= norm;
+    }
+    return uniforms;
+}
+
+/**
+ * @brief Draws shots indices from the distribution given by probability and returns how often
+ *  each drawn index came up, sorted by index.
+ *  Block totals form a coarse cumulative distribution, computed in one parallel pass. The sorted
+ *  uniforms are split between blocks by binary search, and only blocks that received a shot are
+ *  scanned again, merging their running sum with their uniforms. The result only depends on
+ *  seed, not on num_threads.
+ *
+ * @param probability Returns the probability of index i
+ */
+template <typename Func>
+std::vector<std::pair<uint64_t, uint64_t>> sample_counts(const uint64_t size, const uint64_t shots,
+                                                         const uint64_t seed,
+                                                         const int num_threads,
+                                                         Func&& probability) {
+    const int low_bits = std::min(std::countr_zero(size), MARGINAL_BLOCK_BITS);
+    const uint64_t block_size = 1ull << low_bits;
+    const uint64_t num_blocks = size >> low_bits;
+
+    // prefix[b] is the total probability of the blocks before b
+    std::vector<double> prefix(num_blocks + 1, 0);
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t block = 0; block < num_blocks; block++) {
+        double total = 0;
+#pragma omp simd reduction(+ : total)
+        for (uint64_t i = 0; i < block_size; i++) {
+            total += probability((block << low_bits) + i);
+        }
+        prefix[block + 1] = total;
+    }
+    for (uint64_t block = 0; block < num_blocks; block++) {
+        prefix[block + 1] += prefix[block];
+    }
+
+    std::mt19937_64 rng(seed);
+    const auto uniforms = sorted_uniforms(shots, prefix.back(), rng);
+
+    // With a static schedule each thread owns a contiguous, ordered range of blocks, so the
+    // per-thread counts concatenate in index order
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> thread_counts(num_threads);
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t block = 0; block < num_blocks; block++) {
+        auto first = std::ranges::lower_bound(uniforms, prefix[block]);
+        const auto last = block + 1 == num_blocks ? uniforms.end()
+                                                  : std::ranges::lower_bound(uniforms,
+                                                                             prefix[block + 1]);
+        if (first == last) {
+            continue;
+        }
+
+        auto& counts = thread_counts[omp_get_thread_num()];
+        const uint64_t base = block << low_bits;
+        double cumulative = prefix[block];
+        for (uint64_t i = 0; i < block_size && first != last; i++) {
+            const double p = probability(base + i);
+            cumulative += p;
+            const auto drawn = std::find_if(first, last, [&](double u) { return u >= cumulative; });
+            if (drawn != first && p > 0) {
+                counts.emplace_back(base + i, drawn - first);
+                first = drawn;
+            }
+        }
+        // Uniforms left over by rounding go to the last index of the block that can be drawn
+        if (first != last) {
+            for (uint64_t i = block_size; i-- > 0;) {
+                if (probability(base + i) > 0) {
+                    if (counts.empty() || counts.back().first != base + i) {
+                        counts.emplace_back(base + i, 0);
+                    }
+                    counts.back().second += last - first;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> counts;
+    for (const auto& local : thread_counts) {
+        counts.insert(counts.end(), local.begin(), local.end());
+    }
+    return counts;
+}
+
+} // namespace kernels
+
+#endif
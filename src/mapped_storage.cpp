@@ -0,0 +1,81 @@
+#include "mapped_storage.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+uintptr_t page_size() {
+    static const auto size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+string mapped_dir() {
+    if (const char* dir = getenv("QSIM_MAPPED_DIR"); dir != nullptr && *dir != '\0') {
+        return dir;
+    }
+    return filesystem::temp_directory_path().string();
+}
+
+} // namespace
+
+namespace mapped_storage {
+
+void* map(const size_t bytes) {
+    string path = mapped_dir() + "/qsim-state-XXXXXX";
+    const int fd = mkstemp(path.data());
+    if (fd < 0) {
+        throw bad_alloc();
+    }
+    unlink(path.c_str());
+
+    // A freshly truncated file reads as zeros without any page being written
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        close(fd);
+        throw bad_alloc();
+    }
+    void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        throw bad_alloc();
+    }
+
+    madvise(ptr, bytes, MADV_SEQUENTIAL);
+    return ptr;
+}
+
+void* map_file(const FileRegion& region, const size_t bytes) {
+    const int fd = open(region.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw bad_alloc();
+    }
+    void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                     static_cast<off_t>(region.offset));
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        throw bad_alloc();
+    }
+
+    madvise(ptr, bytes, MADV_SEQUENTIAL);
+    return ptr;
+}
+
+void unmap(void* ptr, const size_t bytes) noexcept {
+    munmap(ptr, bytes);
+}
+
+void prefetch(const void* ptr, const size_t bytes) noexcept {
+    // madvise needs a page aligned start
+    const auto begin = reinterpret_cast<uintptr_t>(ptr) & ~(page_size() - 1);
+    const auto end = reinterpret_cast<uintptr_t>(ptr) + bytes;
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+}
+
+} // namespace mapped_storage
@@ -0,0 +1,45 @@
+#ifndef MAPPED_STORAGE_HPP
+#define MAPPED_STORAGE_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Memory-mapped file storage for state vectors larger than RAM. The file lives in the directory
+ * named by the QSIM_MAPPED_DIR environment variable, else the system temporary directory, and is
+ * unlinked as soon as it is mapped, so nothing is left behind even if the process dies.
+ * Pages are read and written back by the kernel on demand; the kernels stream through the state
+ * vector, which is the access pattern the readahead hints below are for.
+ */
+namespace mapped_storage {
+
+/**
+ * @brief Maps a new zero-filled file of the given size, hinted for sequential access.
+ *  Throws std::bad_alloc when the file cannot be created or mapped.
+ */
+void* map(std::size_t bytes);
+
+/**
+ * @brief Region of an existing file to map in place of a new one, e.g. a checkpoint.
+ */
+struct FileRegion {
+    std::string path;
+    std::size_t offset; // Multiple of the page size
+};
+
+/**
+ * @brief Maps the region of the file copy-on-write: pages are read from the file on first
+ *  access, and writes stay private to the process. Throws std::bad_alloc on failure.
+ */
+void* map_file(const FileRegion& region, std::size_t bytes);
+
+void unmap(void* ptr, std::size_t bytes) noexcept;
+
+/**
+ * @brief Asks the kernel to start reading the pages of the range in the background.
+ */
+void prefetch(const void* ptr, std::size_t bytes) noexcept;
+
+} // namespace mapped_storage
+
+#endif
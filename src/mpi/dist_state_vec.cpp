@@ -0,0 +1,296 @@
+#include "dist_state_vec.hpp"
+#include "gates.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <limits>
+
+#define MASK(N) (0x1ull << (N))
+
+using namespace std;
+
+namespace {
+
+template <typename T> MPI_Datatype mpi_complex_type() {
+    return is_same_v<T, float> ? MPI_CXX_FLOAT_COMPLEX : MPI_CXX_DOUBLE_COMPLEX;
+}
+
+template <typename T> MPI_Datatype mpi_real_type() {
+    return is_same_v<T, float> ? MPI_FLOAT : MPI_DOUBLE;
+}
+
+enum ExchangeTag : int { halves_tag, results_tag };
+
+} // namespace
+
+template <typename T>
+DistQStateVec<T>::DistQStateVec(const int num_qubits, MPI_Comm comm, const int num_threads) {
+    this->comm = comm;
+    MPI_Comm_rank(comm, &this->rank);
+    MPI_Comm_size(comm, &this->num_ranks);
+    if (!has_single_bit(static_cast<unsigned>(this->num_ranks)) ||
+        countr_zero(static_cast<unsigned>(this->num_ranks)) >= num_qubits) {
+        if (this->rank == 0) {
+            cerr << "DistQStateVec: " << this->num_ranks
+                 << " ranks is not a power of two below 2^" << num_qubits << "\n";
+        }
+        MPI_Abort(comm, 1);
+    }
+
+    this->num_qubits = num_qubits;
+    this->num_local_qubits = num_qubits - countr_zero(static_cast<unsigned>(this->num_ranks));
+    this->num_threads = kernels::resolve_num_threads(this->num_local_qubits, num_threads);
+
+    this->local = StateVector<T>(MASK(this->num_local_qubits), complex<T>{0.0, 0.0});
+    if (this->rank == 0) {
+        this->local[0] = complex<T>{1.0, 0.0};
+    }
+}
+
+template <typename T>
+void DistQStateVec<T>::apply_local(const uint64_t controls_mask, const int target,
+                                   const array<complex<T>, 4>& matrix) {
+    if (matrix[1] == complex<T>{} && matrix[2] == complex<T>{}) {
+        kernels::apply_diagonal<T>(this->local, controls_mask, target, {matrix[0], matrix[3]},
+                                   this->num_threads);
+        return;
+    }
+    kernels::controlled_apply_1q<T>(this->local, controls_mask, target, matrix,
+                                    this->num_threads);
+}
+
+template <typename T>
+void DistQStateVec<T>::apply_global(const uint64_t controls_mask, const int target,
+                                    const array<complex<T>, 4>& matrix) {
+    const int global_bit = target - this->num_local_qubits;
+    const bool high = ((this->rank >> global_bit) & 1) != 0;
+
+    // A diagonal gate only scales this rank's amplitudes by the entry its bit selects
+    if (matrix[1] == complex<T>{} && matrix[2] == complex<T>{}) {
+        const complex<T> factor = matrix[high ? 3 : 0];
+        const uint64_t size = this->local.size();
+#pragma omp parallel for num_threads(this->num_threads) if (this->num_threads > 1) schedule(static)
+        for (uint64_t i = 0; i < size; i++) {
+            if ((i & controls_mask) == controls_mask) {
+                this->local[i] = kernels::mul(this->local[i], factor);
+            }
+        }
+        return;
+    }
+
+    // The pair of local index i is (i on the low rank, i on the high rank). The low rank updates
+    // the pairs of the first half of the partition and the high rank those of the second half,
+    // so each sends the half it does not keep and receives the partner's amplitudes of its own.
+    const int partner = this->rank ^ (1 << global_bit);
+    const uint64_t half = this->local.size() / 2;
+    const uint64_t chunk_size = min(half, this->exchange_chunk_size);
+    const auto num_chunks = static_cast<int>(half / chunk_size);
+    complex<T>* kept = this->local.data() + (high ? half : 0);
+    complex<T>* sent = this->local.data() + (high ? 0 : half);
+    const uint64_t kept_offset = high ? half : 0;
+    this->buffer.resize(half);
+
+    const MPI_Datatype type = mpi_complex_type<T>();
+    const auto count = static_cast<int>(chunk_size);
+    vector<MPI_Request> halves_received(num_chunks);
+    vector<MPI_Request> halves_sent(num_chunks);
+    vector<MPI_Request> results(2 * num_chunks);
+    for (int k = 0; k < num_chunks; k++) {
+        MPI_Irecv(this->buffer.data() + k * chunk_size, count, type, partner, halves_tag,
+                  this->comm, &halves_received[k]);
+        MPI_Isend(sent + k * chunk_size, count, type, partner, halves_tag, this->comm,
+                  &halves_sent[k]);
+    }
+
+    // Update each chunk as soon as it arrives and send it back right away, so the transfers of
+    // the remaining chunks overlap with computation
+    for (int k = 0; k < num_chunks; k++) {
+        MPI_Wait(&halves_received[k], MPI_STATUS_IGNORE);
+
+        complex<T>* own = kept + k * chunk_size;
+        complex<T>* other = this->buffer.data() + k * chunk_size;
+        const uint64_t base = kept_offset + k * chunk_size;
+#pragma omp parallel for num_threads(this->num_threads) if (this->num_threads > 1) schedule(static)
+        for (uint64_t i = 0; i < chunk_size; i++) {
+            if (((base + i) & controls_mask) != controls_mask) {
+                continue;
+            }
+            const complex<T> amp0 = high ? other[i] : own[i];
+            const complex<T> amp1 = high ? own[i] : other[i];
+            const complex<T> new0 = kernels::mul_add(matrix[0], amp0, matrix[1], amp1);
+            const complex<T> new1 = kernels::mul_add(matrix[2], amp0, matrix[3], amp1);
+            own[i] = high ? new1 : new0;
+            other[i] = high ? new0 : new1;
+        }
+
+        // The results land where the chunk was sent from, so that send must be done
+        MPI_Wait(&halves_sent[k], MPI_STATUS_IGNORE);
+        MPI_Irecv(sent + k * chunk_size, count, type, partner, results_tag, this->comm,
+                  &results[2 * k]);
+        MPI_Isend(other, count, type, partner, results_tag, this->comm, &results[2 * k + 1]);
+    }
+    MPI_Waitall(2 * num_chunks, results.data(), MPI_STATUSES_IGNORE);
+}
+
+template <typename T>
+auto DistQStateVec<T>::controlled(const uint64_t controls_mask, const int target_qubit,
+                                  const Matrix2& matrix) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0 ||
+        (controls_mask >> this->num_qubits) != 0 ||
+        (controls_mask & MASK(target_qubit - 1)) != 0) {
+        return unexpected(Error::invalid_input);
+    }
+
+    // Global controls are either all set on this rank, and its partner, or the gate is a no-op
+    const uint64_t local_mask = MASK(this->num_local_qubits) - 1;
+    const uint64_t global_controls = controls_mask >> this->num_local_qubits;
+    if ((static_cast<uint64_t>(this->rank) & global_controls) != global_controls) {
+        return {};
+    }
+
+    const int target = target_qubit - 1;
+    const auto cast_matrix = kernels::cast_matrix<T>(matrix);
+    if (target < this->num_local_qubits) {
+        this->apply_local(controls_mask & local_mask, target, cast_matrix);
+    } else {
+        this->apply_global(controls_mask & local_mask, target, cast_matrix);
+    }
+    return {};
+}
+
+template <typename T>
+auto DistQStateVec<T>::apply_1q(const int target_qubit, const Matrix2& matrix)
+    -> expected<void, Error> {
+    return this->controlled(0, target_qubit, matrix);
+}
+
+template <typename T>
+auto DistQStateVec<T>::pauli_x(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::pauli_x());
+}
+
+template <typename T>
+auto DistQStateVec<T>::pauli_y(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::pauli_y());
+}
+
+template <typename T>
+auto DistQStateVec<T>::pauli_z(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::pauli_z());
+}
+
+template <typename T>
+auto DistQStateVec<T>::hadamard(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::hadamard());
+}
+
+template <typename T>
+auto DistQStateVec<T>::rotation_x(const int target_qubit, const double angle)
+    -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::rotation_x(angle));
+}
+
+template <typename T>
+auto DistQStateVec<T>::rotation_y(const int target_qubit, const double angle)
+    -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::rotation_y(angle));
+}
+
+template <typename T>
+auto DistQStateVec<T>::rotation_z(const int target_qubit, const double angle)
+    -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::rotation_z(angle));
+}
+
+template <typename T>
+auto DistQStateVec<T>::controlled_x(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit - 1), target_qubit, gates::pauli_x());
+}
+
+template <typename T>
+auto DistQStateVec<T>::controlled_z(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit - 1), target_qubit, gates::pauli_z());
+}
+
+template <typename T>
+auto DistQStateVec<T>::toffoli(const int control_qubit1, const int control_qubit2,
+                               const int target_qubit) -> expected<void, Error> {
+    if (control_qubit1 > this->num_qubits || control_qubit1 <= 0 ||
+        control_qubit2 > this->num_qubits || control_qubit2 <= 0 ||
+        control_qubit1 == control_qubit2) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit1 - 1) | MASK(control_qubit2 - 1), target_qubit,
+                            gates::pauli_x());
+}
+
+template <typename T> vector<T> DistQStateVec<T>::get_measured_qubits() const {
+    const complex<T>* amps = this->local.data();
+    auto probability = [amps](const uint64_t i) { return norm(amps[i]); };
+    auto marginals = kernels::marginal_probabilities<T>(this->local.size(), this->num_local_qubits,
+                                                        this->num_threads, probability);
+
+    // Global qubits are fixed on a rank: each gets the whole local probability or nothing
+    const auto total = kernels::joint_probabilities<T>(this->local.size(), {}, this->num_threads,
+                                                       probability)[0];
+    marginals.resize(this->num_qubits);
+    for (int j = this->num_local_qubits; j < this->num_qubits; j++) {
+        marginals[j] = ((this->rank >> (j - this->num_local_qubits)) & 1) != 0 ? total : 0;
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, marginals.data(), this->num_qubits, mpi_real_type<T>(), MPI_SUM,
+                  this->comm);
+    return marginals;
+}
+
+template <typename T> StateVector<T> DistQStateVec<T>::gather_state(const int root) const {
+    StateVector<T> state(this->rank == root ? MASK(this->num_qubits) : 0);
+    const auto count = static_cast<int>(this->local.size());
+    MPI_Gather(this->local.data(), count, mpi_complex_type<T>(), state.data(), count,
+               mpi_complex_type<T>(), root, this->comm);
+    return state;
+}
+
+template <typename T> const StateVector<T>& DistQStateVec<T>::get_local_state() const {
+    return this->local;
+}
+
+template <typename T>
+auto DistQStateVec<T>::set_exchange_chunk_size(const uint64_t chunk_size)
+    -> expected<void, Error> {
+    // Half the local state is a power of two, so a power of two chunk always divides it
+    if (!has_single_bit(chunk_size) ||
+        chunk_size > static_cast<uint64_t>(numeric_limits<int>::max())) {
+        return unexpected(Error::invalid_input);
+    }
+    this->exchange_chunk_size = chunk_size;
+    return {};
+}
+
+template <typename T> int DistQStateVec<T>::get_num_qubits() const {
+    return this->num_qubits;
+}
+
+template <typename T> int DistQStateVec<T>::get_num_local_qubits() const {
+    return this->num_local_qubits;
+}
+
+template <typename T> int DistQStateVec<T>::get_rank() const {
+    return this->rank;
+}
+
+template <typename T> int DistQStateVec<T>::get_num_ranks() const {
+    return this->num_ranks;
+}
+
+template class DistQStateVec<float>;
+template class DistQStateVec<double>;
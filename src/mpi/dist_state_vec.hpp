@@ -0,0 +1,110 @@
+#ifndef DIST_STATE_VEC_HPP
+#define DIST_STATE_VEC_HPP
+
+#include "qstate_vec.hpp"
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <expected>
+#include <mpi.h>
+#include <vector>
+
+/**
+ * Amplitudes sent per message when exchanging half partitions. Chunking lets a rank compute on
+ * the chunks that already arrived while the next ones are still in flight.
+ */
+constexpr uint64_t EXCHANGE_CHUNK_SIZE = 0x1ull << 18;
+
+/**
+ * State vector partitioned over the ranks of an MPI communicator.
+ * With 2^p ranks each rank holds 2^(n - p) consecutive amplitudes: the low n - p qubits are
+ * local and the high p qubits are global, given by the bits of the rank.
+ * Gates on local qubits, and diagonal gates on any qubit, need no communication. A gate on a
+ * global qubit pairs each rank with the rank differing on that bit; the two swap half of their
+ * partition in bulk, each updates the pairs of the half it kept, and they swap the results back.
+ * Every method is collective: all ranks must call it with the same arguments.
+ */
+template <typename T = double> class DistQStateVec {
+  private:
+    StateVector<T> local;
+    StateVector<T> buffer;
+    MPI_Comm comm;
+    int rank;
+    int num_ranks;
+    int num_qubits;
+    int num_local_qubits;
+    int num_threads;
+    uint64_t exchange_chunk_size = EXCHANGE_CHUNK_SIZE;
+
+    void apply_local(uint64_t controls_mask, int target,
+                     const std::array<std::complex<T>, 4>& matrix);
+    void apply_global(uint64_t controls_mask, int target,
+                      const std::array<std::complex<T>, 4>& matrix);
+
+  public:
+    /**
+     * @brief Construct a distributed state vector initialized to |0...0>.
+     *  Aborts the communicator unless its size is a power of two below 2^num_qubits.
+     *
+     * @param num_qubits
+     * @param comm Communicator whose ranks share the state
+     * @param num_threads Same meaning as in QStateVec, for the local kernels of each rank
+     */
+    DistQStateVec(int num_qubits, MPI_Comm comm = MPI_COMM_WORLD, int num_threads = 0);
+
+    /**
+     * @brief Applies a single qubit unitary on the target qubit, where every control qubit is |1>.
+     *
+     * @param controls_mask Qubit q is bit q - 1, 0 for an uncontrolled gate
+     * @param target_qubit
+     * @param matrix Row-major {m00, m01, m10, m11}
+     */
+    auto controlled(uint64_t controls_mask, int target_qubit, const Matrix2& matrix)
+        -> std::expected<void, Error>;
+
+    auto apply_1q(int target_qubit, const Matrix2& matrix) -> std::expected<void, Error>;
+
+    auto pauli_x(int target_qubit) -> std::expected<void, Error>;
+    auto pauli_y(int target_qubit) -> std::expected<void, Error>;
+    auto pauli_z(int target_qubit) -> std::expected<void, Error>;
+    auto hadamard(int target_qubit) -> std::expected<void, Error>;
+    auto rotation_x(int target_qubit, double angle) -> std::expected<void, Error>;
+    auto rotation_y(int target_qubit, double angle) -> std::expected<void, Error>;
+    auto rotation_z(int target_qubit, double angle) -> std::expected<void, Error>;
+    auto controlled_x(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+    auto controlled_z(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+    auto toffoli(int control_qubit1, int control_qubit2, int target_qubit)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Returns, on every rank, the probability of measuring each qubit as |1>.
+     */
+    [[nodiscard]] std::vector<T> get_measured_qubits() const;
+
+    /**
+     * @brief Returns the whole state vector on root, and an empty vector on the other ranks.
+     *  Only meant for states that fit on one rank.
+     */
+    [[nodiscard]] StateVector<T> gather_state(int root = 0) const;
+
+    /**
+     * @brief Returns the amplitudes held by this rank, global indices
+     *  [rank * 2^local_qubits, (rank + 1) * 2^local_qubits).
+     */
+    [[nodiscard]] const StateVector<T>& get_local_state() const;
+
+    /**
+     * @brief Sets the number of amplitudes per message of a global gate exchange, a power of
+     *  two, used as is up to half the local state. Smaller chunks start computing sooner, larger
+     *  ones pay less per-message overhead. Fails with Error::invalid_input when chunk_size is not
+     *  a power of two or does not fit an MPI message count.
+     */
+    auto set_exchange_chunk_size(uint64_t chunk_size) -> std::expected<void, Error>;
+
+    [[nodiscard]] int get_num_qubits() const;
+    [[nodiscard]] int get_num_local_qubits() const;
+    [[nodiscard]] int get_rank() const;
+    [[nodiscard]] int get_num_ranks() const;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "noise.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+bool is_probability(const double p) {
+    return p >= 0.0 && p <= 1.0;
+}
+
+// Pauli 0 = I, 1 = X, 2 = Y, 3 = Z
+template <typename T> void apply_pauli(QStateVec<T>& state, const int qubit, const int pauli) {
+    switch (pauli) {
+    case 1:
+        (void)state.pauli_x(qubit);
+        break;
+    case 2:
+        (void)state.pauli_y(qubit);
+        break;
+    case 3:
+        (void)state.pauli_z(qubit);
+        break;
+    default:
+        break;
+    }
+}
+
+} // namespace
+
+template <typename T>
+TrajectorySimulator<T>::TrajectorySimulator(const int num_qubits, const NoiseModel& noise,
+                                            const int num_threads)
+    : num_qubits(num_qubits), noise(noise) {
+    // Trajectories are parallel whatever the state size, so no small state threshold applies
+    this->num_threads = kernels::resolve_num_threads(kernels::PARALLEL_QUBIT_THRESHOLD,
+                                                     num_threads);
+    this->pool.reserve(this->num_threads);
+    for (int thread = 0; thread < this->num_threads; thread++) {
+        this->pool.emplace_back(num_qubits, 1);
+    }
+}
+
+template <typename T> int TrajectorySimulator<T>::get_num_qubits() const {
+    return this->num_qubits;
+}
+
+template <typename T> int TrajectorySimulator<T>::get_num_threads() const {
+    return this->num_threads;
+}
+
+template <typename T>
+void TrajectorySimulator<T>::apply_noise(QStateVec<T>& state, const Operation& op,
+                                         mt19937_64& rng) const {
+    const auto qubits = involved_qubits(op);
+    uniform_real_distribution<double> uniform(0.0, 1.0);
+    if (qubits.size() == 2) {
+        if (this->noise.depolarizing_2q > 0.0 && uniform(rng) < this->noise.depolarizing_2q) {
+            // One of the 15 Pauli pairs other than I x I, two bits per qubit
+            const int paulis = uniform_int_distribution<int>(1, 15)(rng);
+            apply_pauli(state, qubits[0], paulis & 0x3);
+            apply_pauli(state, qubits[1], paulis >> 2);
+        }
+    } else if (this->noise.depolarizing > 0.0) {
+        for (const int qubit : qubits) {
+            if (uniform(rng) < this->noise.depolarizing) {
+                apply_pauli(state, qubit, uniform_int_distribution<int>(1, 3)(rng));
+            }
+        }
+    }
+
+    if (this->noise.amplitude_damping > 0.0) {
+        for (const int qubit : qubits) {
+            (void)state.amplitude_damping(qubit, this->noise.amplitude_damping, rng);
+        }
+    }
+}
+
+template <typename T>
+auto TrajectorySimulator<T>::run(const Circuit& circuit, const uint64_t num_trajectories,
+                                 const uint64_t seed, const uint64_t shots_per_trajectory)
+    -> expected<vector<pair<uint64_t, uint64_t>>, Error> {
+    if (circuit.get_num_qubits() > this->num_qubits || !is_probability(this->noise.depolarizing) ||
+        !is_probability(this->noise.depolarizing_2q) ||
+        !is_probability(this->noise.amplitude_damping) ||
+        !is_probability(this->noise.readout_error)) {
+        return unexpected(Error::invalid_input);
+    }
+
+    // Per thread counts, merged once every trajectory has run
+    vector<unordered_map<uint64_t, uint64_t>> thread_counts(this->num_threads);
+#pragma omp parallel num_threads(this->num_threads)
+    {
+        const int thread = omp_get_thread_num();
+        QStateVec<T>& state = this->pool[thread];
+        auto& counts = thread_counts[thread];
+
+#pragma omp for schedule(dynamic)
+        for (uint64_t trajectory = 0; trajectory < num_trajectories; trajectory++) {
+            mt19937_64 rng(seed + trajectory * 0x9E3779B97F4A7C15ull);
+            state.set_zero_state();
+            // Operations were validated when recorded, so applying them cannot fail
+            for (const auto& op : circuit.get_operations()) {
+                (void)apply_operation(op, state);
+                this->apply_noise(state, op, rng);
+            }
+
+            for (auto [outcome, count] : state.sample(shots_per_trajectory, rng())) {
+                if (this->noise.readout_error == 0.0) {
+                    counts[outcome] += count;
+                    continue;
+                }
+                // Each shot of an outcome gets its own bit flips
+                bernoulli_distribution flip(this->noise.readout_error);
+                for (uint64_t shot = 0; shot < count; shot++) {
+                    uint64_t read = outcome;
+                    for (int bit = 0; bit < this->num_qubits; bit++) {
+                        read ^= static_cast<uint64_t>(flip(rng)) << bit;
+                    }
+                    counts[read]++;
+                }
+            }
+        }
+    }
+
+    vector<pair<uint64_t, uint64_t>> merged;
+    for (const auto& counts : thread_counts) {
+        merged.insert(merged.end(), counts.begin(), counts.end());
+    }
+    ranges::sort(merged);
+    vector<pair<uint64_t, uint64_t>> totals;
+    for (const auto& [outcome, count] : merged) {
+        if (!totals.empty() && totals.back().first == outcome) {
+            totals.back().second += count;
+        } else {
+            totals.emplace_back(outcome, count);
+        }
+    }
+    return totals;
+}
+
+template class TrajectorySimulator<float>;
+template class TrajectorySimulator<double>;
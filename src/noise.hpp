@@ -0,0 +1,75 @@
+#ifndef NOISE_HPP
+#define NOISE_HPP
+
+#include "circuit.hpp"
+#include "qstate_vec.hpp"
+#include <cstdint>
+#include <expected>
+#include <random>
+#include <utility>
+#include <vector>
+
+/**
+ * Noise channels applied by TrajectorySimulator. Gate noise follows every operation of the
+ * circuit, on the qubits it acts on; readout noise applies to each measured bit.
+ */
+struct NoiseModel {
+    // Probability of a uniformly random X, Y or Z on each qubit of an operation not on two qubits
+    double depolarizing = 0.0;
+    // Probability of a uniformly random non-identity Pauli pair after a two qubit operation
+    double depolarizing_2q = 0.0;
+    // Decay probability gamma of |1> to |0> on each qubit of an operation
+    double amplitude_damping = 0.0;
+    // Probability of each measured bit being flipped
+    double readout_error = 0.0;
+};
+
+/**
+ * Monte Carlo simulation of a noisy circuit: each trajectory runs the circuit on a pure state,
+ * drawing one Kraus operator of every noise channel at random, and is measured at the end.
+ * The measurement statistics over many trajectories converge to those of the noisy mixed state.
+ *
+ * Trajectories run in parallel, one per thread at a time. Each thread owns a state vector from
+ * a pool allocated once, at construction, and reset between trajectories, so the pool holds
+ * num_threads * 2^num_qubits amplitudes for the simulator's whole lifetime.
+ */
+template <typename T = double> class TrajectorySimulator {
+  private:
+    int num_qubits;
+    int num_threads;
+    NoiseModel noise;
+    std::vector<QStateVec<T>> pool;
+
+    void apply_noise(QStateVec<T>& state, const Operation& op, std::mt19937_64& rng) const;
+
+  public:
+    /**
+     * @brief Allocates one num_qubits state vector per thread.
+     *
+     * @param num_threads Trajectories run at the same time. When 0, the QSIM_NUM_THREADS
+     *  environment variable is used if set, else the OpenMP default. The kernels of each
+     *  trajectory run serially.
+     */
+    TrajectorySimulator(int num_qubits, const NoiseModel& noise, int num_threads = 0);
+
+    [[nodiscard]] int get_num_qubits() const;
+
+    [[nodiscard]] int get_num_threads() const;
+
+    /**
+     * @brief Runs num_trajectories noisy trajectories of the circuit and measures every qubit
+     *  shots_per_trajectory times at the end of each. Noise is drawn per operation, so pass the
+     *  circuit uncompiled to get noise after every gate.
+     *  Each trajectory draws from its own generator, seeded from seed and its index, so the
+     *  counts do not depend on the number of threads.
+     *
+     * @return (outcome, count) pairs sorted by outcome, counts summing to
+     *  num_trajectories * shots_per_trajectory. Fails with Error::invalid_input when a noise
+     *  probability is outside [0, 1] or the circuit has more qubits than the simulator.
+     */
+    auto run(const Circuit& circuit, uint64_t num_trajectories, uint64_t seed,
+             uint64_t shots_per_trajectory = 1)
+        -> std::expected<std::vector<std::pair<uint64_t, uint64_t>>, Error>;
+};
+
+#endif
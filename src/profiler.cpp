@@ -0,0 +1,152 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    int target_qubit;
+    int thread;
+    double start_us;
+    double duration_us;
+    uint64_t bytes;
+};
+
+struct Totals {
+    uint64_t calls = 0;
+    double seconds = 0.0;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+};
+
+struct Recorder {
+    mutex lock;
+    chrono::steady_clock::time_point origin = chrono::steady_clock::now();
+    map<pair<string_view, int>, Totals> totals;
+    vector<TraceEvent> events;
+};
+
+Recorder& recorder() {
+    static Recorder instance;
+    return instance;
+}
+
+thread_local int scope_depth = 0;
+
+int thread_index() {
+    static atomic<int> next_index = 0;
+    thread_local const int index = next_index++;
+    return index;
+}
+
+// Names are identifiers, but escape them anyway so the output is always valid JSON
+void write_string(ostream& ostr, const string_view text) {
+    ostr << '"';
+    for (const char character : text) {
+        if (character == '"' || character == '\\') {
+            ostr << '\\';
+        }
+        ostr << character;
+    }
+    ostr << '"';
+}
+
+} // namespace
+
+namespace profiler {
+
+ScopedEvent::ScopedEvent(const char* name, const int target_qubit, const uint64_t bytes_read,
+                         const uint64_t bytes_written)
+    : name(name), target_qubit(target_qubit), bytes_read(bytes_read),
+      bytes_written(bytes_written), outermost(scope_depth++ == 0),
+      start(chrono::steady_clock::now()) {}
+
+ScopedEvent::~ScopedEvent() {
+    const auto end = chrono::steady_clock::now();
+    scope_depth--;
+    if (!this->outermost) {
+        return;
+    }
+
+    auto& rec = recorder();
+    const lock_guard guard(rec.lock);
+    auto& totals = rec.totals[{this->name, this->target_qubit}];
+    totals.calls++;
+    totals.seconds += chrono::duration<double>(end - this->start).count();
+    totals.bytes_read += this->bytes_read;
+    totals.bytes_written += this->bytes_written;
+
+    if (rec.events.size() < MAX_TRACE_EVENTS) {
+        rec.events.push_back(
+            {this->name, this->target_qubit, thread_index(),
+             chrono::duration<double, micro>(this->start - rec.origin).count(),
+             chrono::duration<double, micro>(end - this->start).count(),
+             this->bytes_read + this->bytes_written});
+    }
+}
+
+vector<GateStats> get_stats() {
+    auto& rec = recorder();
+    const lock_guard guard(rec.lock);
+    vector<GateStats> stats;
+    stats.reserve(rec.totals.size());
+    for (const auto& [key, totals] : rec.totals) {
+        stats.push_back({string(key.first), key.second, totals.calls, totals.seconds,
+                         totals.bytes_read, totals.bytes_written});
+    }
+    ranges::stable_sort(stats, greater{}, &GateStats::seconds);
+    return stats;
+}
+
+void reset() {
+    auto& rec = recorder();
+    const lock_guard guard(rec.lock);
+    rec.totals.clear();
+    rec.events.clear();
+    rec.origin = chrono::steady_clock::now();
+}
+
+void dump_json(ostream& ostr) {
+    const auto stats = get_stats();
+    const auto precision = ostr.precision(12);
+    ostr << "[";
+    for (size_t i = 0; i < stats.size(); i++) {
+        const auto& entry = stats[i];
+        ostr << (i == 0 ? "\n" : ",\n") << "  {\"name\": ";
+        write_string(ostr, entry.name);
+        ostr << ", \"target_qubit\": " << entry.target_qubit << ", \"calls\": " << entry.calls
+             << ", \"seconds\": " << entry.seconds << ", \"bytes_read\": " << entry.bytes_read
+             << ", \"bytes_written\": " << entry.bytes_written
+             << ", \"bandwidth\": " << entry.bandwidth() << "}";
+    }
+    ostr << "\n]\n";
+    ostr.precision(precision);
+}
+
+void dump_chrome_trace(ostream& ostr) {
+    auto& rec = recorder();
+    const lock_guard guard(rec.lock);
+    // Timestamps are microseconds since the last reset, printed to the nanosecond
+    const auto precision = ostr.precision(15);
+    ostr << "{\"traceEvents\": [";
+    for (size_t i = 0; i < rec.events.size(); i++) {
+        const auto& event = rec.events[i];
+        ostr << (i == 0 ? "\n" : ",\n") << "  {\"name\": ";
+        write_string(ostr, event.name);
+        ostr << ", \"cat\": \"gate\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << event.thread
+             << ", \"ts\": " << event.start_us << ", \"dur\": " << event.duration_us
+             << ", \"args\": {\"target_qubit\": " << event.target_qubit
+             << ", \"bytes\": " << event.bytes << "}}";
+    }
+    ostr << "\n], \"displayTimeUnit\": \"ns\"}\n";
+    ostr.precision(precision);
+}
+
+} // namespace profiler
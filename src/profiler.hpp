@@ -0,0 +1,101 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Per gate instrumentation, built in with -DENABLE_PROFILING=ON (which defines QSIM_PROFILING).
+ * Without it PROFILE_SCOPE expands to nothing, its arguments are not evaluated, and the queries
+ * below return empty results.
+ *
+ * Only the outermost scope on a thread is recorded, so a gate implemented through another one,
+ * e.g. hadamard through apply_1q, is counted once under its own name.
+ */
+#ifdef QSIM_PROFILING
+#define PROFILE_SCOPE(name, target_qubit, bytes_read, bytes_written)                               \
+    const profiler::ScopedEvent profile_scope_event((name), (target_qubit), (bytes_read),          \
+                                                    (bytes_written))
+#else
+#define PROFILE_SCOPE(name, target_qubit, bytes_read, bytes_written) static_cast<void>(0)
+#endif
+
+namespace profiler {
+
+#ifdef QSIM_PROFILING
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+// Trace events kept for the Chrome trace; totals keep counting past it
+constexpr uint64_t MAX_TRACE_EVENTS = 0x1ull << 20;
+
+/**
+ * Totals of one gate type on one target qubit (0 when the operation has none).
+ */
+struct GateStats {
+    std::string name;
+    int target_qubit;
+    uint64_t calls;
+    double seconds;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+
+    /**
+     * @brief Achieved bandwidth in bytes per second, reads and writes together.
+     */
+    [[nodiscard]] double bandwidth() const {
+        return this->seconds > 0 ? static_cast<double>(this->bytes_read + this->bytes_written) /
+                                       this->seconds
+                                 : 0.0;
+    }
+};
+
+/**
+ * Times the enclosing scope. name must outlive the profiler, e.g. a string literal.
+ */
+class ScopedEvent {
+  private:
+    const char* name;
+    int target_qubit;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    bool outermost;
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    ScopedEvent(const char* name, int target_qubit, uint64_t bytes_read, uint64_t bytes_written);
+    ~ScopedEvent();
+
+    ScopedEvent(const ScopedEvent&) = delete;
+    ScopedEvent& operator=(const ScopedEvent&) = delete;
+};
+
+/**
+ * @brief Returns the totals recorded so far, by decreasing time.
+ */
+std::vector<GateStats> get_stats();
+
+/**
+ * @brief Clears the totals and the trace.
+ */
+void reset();
+
+/**
+ * @brief Writes the totals as a JSON array of objects with the GateStats fields and bandwidth.
+ */
+void dump_json(std::ostream& ostr);
+
+/**
+ * @brief Writes the recorded events in the Chrome trace event format, for chrome://tracing or
+ *  Perfetto.
+ */
+void dump_chrome_trace(std::ostream& ostr);
+
+} // namespace profiler
+
+#endif
@@ -0,0 +1,960 @@
+#include "qasm_parser.hpp"
+#include "gates.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <unordered_map>
+
+#define MASK(N) (0x1ull << (N))
+
+using namespace std;
+
+namespace {
+
+// Qubits and classical bits of all registers together, each indexed by a bit of a 64 bit mask
+constexpr int MAX_REGISTER_BITS = 63;
+
+// Plain ASCII tests: the <cctype> ones go through the locale on every character
+constexpr bool is_digit(const char character) {
+    return character >= '0' && character <= '9';
+}
+
+constexpr bool is_identifier_start(const char character) {
+    return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') ||
+           character == '_';
+}
+
+enum class TokenKind : uint8_t { identifier, number, string, symbol, end };
+
+struct Token {
+    TokenKind kind = TokenKind::end;
+    string_view text;
+    int line = 1;
+};
+
+/**
+ * Splits the source into tokens on demand, so the program is never held as a token list.
+ */
+class Lexer {
+  private:
+    string_view source;
+    size_t pos = 0;
+    int line = 1;
+
+    [[nodiscard]] bool at(const size_t offset, const char character) const {
+        return this->pos + offset < this->source.size() &&
+               this->source[this->pos + offset] == character;
+    }
+
+    [[nodiscard]] bool at_digit(const size_t offset) const {
+        return this->pos + offset < this->source.size() &&
+               is_digit(this->source[this->pos + offset]);
+    }
+
+    void skip_digits() {
+        while (this->at_digit(0)) {
+            this->pos++;
+        }
+    }
+
+  public:
+    explicit Lexer(const string_view source) : source(source) {}
+
+    Token next() {
+        // Whitespace and // comments
+        while (this->pos < this->source.size()) {
+            const char character = this->source[this->pos];
+            if (character == '\n') {
+                this->line++;
+                this->pos++;
+            } else if (character == ' ' || character == '\t' || character == '\r' ||
+                       character == '\f' || character == '\v') {
+                this->pos++;
+            } else if (character == '/' && this->at(1, '/')) {
+                while (this->pos < this->source.size() && this->source[this->pos] != '\n') {
+                    this->pos++;
+                }
+            } else {
+                break;
+            }
+        }
+        if (this->pos >= this->source.size()) {
+            return {TokenKind::end, {}, this->line};
+        }
+
+        const size_t start = this->pos;
+        const char character = this->source[start];
+        TokenKind kind = TokenKind::symbol;
+        if (is_identifier_start(character)) {
+            kind = TokenKind::identifier;
+            while (this->pos < this->source.size() &&
+                   (is_identifier_start(this->source[this->pos]) ||
+                    is_digit(this->source[this->pos]))) {
+                this->pos++;
+            }
+        } else if (is_digit(character) || (character == '.' && this->at_digit(1))) {
+            kind = TokenKind::number;
+            this->skip_digits();
+            if (this->at(0, '.')) {
+                this->pos++;
+                this->skip_digits();
+            }
+            const bool signed_exponent =
+                (this->at(1, '+') || this->at(1, '-')) && this->at_digit(2);
+            if ((this->at(0, 'e') || this->at(0, 'E')) && (this->at_digit(1) || signed_exponent)) {
+                this->pos += 2;
+                this->skip_digits();
+            }
+        } else if (character == '"') {
+            const size_t close = this->source.find('"', start + 1);
+            if (close != string_view::npos) {
+                this->pos = close + 1;
+                return {TokenKind::string, this->source.substr(start + 1, close - start - 1),
+                        this->line};
+            }
+            this->pos++;
+        } else if ((character == '-' && this->at(1, '>')) ||
+                   (character == '=' && this->at(1, '='))) {
+            this->pos += 2;
+        } else {
+            this->pos++;
+        }
+        return {kind, this->source.substr(start, this->pos - start), this->line};
+    }
+};
+
+/**
+ * Parameter expression compiled to postfix, so gate definitions are not re-parsed on every
+ * application.
+ */
+enum class ExprOpKind : uint8_t {
+    constant,
+    parameter,
+    negate,
+    add,
+    subtract,
+    multiply,
+    divide,
+    power,
+    sin,
+    cos,
+    tan,
+    exp,
+    ln,
+    sqrt
+};
+
+struct ExprOp {
+    ExprOpKind kind;
+    double value;
+    int parameter;
+};
+
+using Expr = vector<ExprOp>;
+
+double evaluate(const Expr& expr, span<const double> params, vector<double>& stack) {
+    stack.clear();
+    for (const auto& op : expr) {
+        if (op.kind == ExprOpKind::constant) {
+            stack.push_back(op.value);
+            continue;
+        }
+        if (op.kind == ExprOpKind::parameter) {
+            stack.push_back(params[op.parameter]);
+            continue;
+        }
+
+        // Binary operators pop their right operand; the result replaces the top
+        const double rhs = stack.back();
+        if (op.kind >= ExprOpKind::add && op.kind <= ExprOpKind::power) {
+            stack.pop_back();
+        }
+        double& top = stack.back();
+        switch (op.kind) {
+        case ExprOpKind::negate:
+            top = -rhs;
+            break;
+        case ExprOpKind::add:
+            top += rhs;
+            break;
+        case ExprOpKind::subtract:
+            top -= rhs;
+            break;
+        case ExprOpKind::multiply:
+            top *= rhs;
+            break;
+        case ExprOpKind::divide:
+            top /= rhs;
+            break;
+        case ExprOpKind::power:
+            top = pow(top, rhs);
+            break;
+        case ExprOpKind::sin:
+            top = sin(rhs);
+            break;
+        case ExprOpKind::cos:
+            top = cos(rhs);
+            break;
+        case ExprOpKind::tan:
+            top = tan(rhs);
+            break;
+        case ExprOpKind::exp:
+            top = exp(rhs);
+            break;
+        case ExprOpKind::ln:
+            top = log(rhs);
+            break;
+        case ExprOpKind::sqrt:
+            top = sqrt(rhs);
+            break;
+        default:
+            break;
+        }
+    }
+    return stack.back();
+}
+
+constexpr array<pair<string_view, ExprOpKind>, 6> FUNCTIONS = {{{"sin", ExprOpKind::sin},
+                                                                {"cos", ExprOpKind::cos},
+                                                                {"tan", ExprOpKind::tan},
+                                                                {"exp", ExprOpKind::exp},
+                                                                {"ln", ExprOpKind::ln},
+                                                                {"sqrt", ExprOpKind::sqrt}}};
+
+/**
+ * Gates of qelib1.inc, recorded straight into the circuit gate set.
+ */
+using Emit = expected<void, Error> (*)(Circuit&, const double*, const int*);
+
+struct Builtin {
+    string_view name;
+    int num_params;
+    int num_qubits;
+    Emit emit;
+};
+
+Matrix2 phase(const double lambda) {
+    return {complex<double>{1.0, 0.0}, 0.0, 0.0, polar(1.0, lambda)};
+}
+
+Matrix2 adjoint(const Matrix2& matrix) {
+    return {conj(matrix[0]), conj(matrix[2]), conj(matrix[1]), conj(matrix[3])};
+}
+
+expected<void, Error> single(Circuit& circuit, const int target, const Matrix2& matrix) {
+    return circuit.controlled(0, target, matrix);
+}
+
+expected<void, Error> control(Circuit& circuit, const int control_qubit, const int target,
+                              const Matrix2& matrix) {
+    return circuit.controlled(MASK(control_qubit - 1), target, matrix);
+}
+
+// Two qubit exp(-i * theta / 2 * P x P), P = X or Z, with qubits[0] the low matrix index bit
+MatrixN pauli_pair_rotation(const double theta, const bool pauli_x) {
+    const complex<double> cos_half{cos(theta / 2), 0.0};
+    const complex<double> minus_i_sin{0.0, -sin(theta / 2)};
+    MatrixN matrix(16, 0.0);
+    for (int row = 0; row < 4; row++) {
+        if (pauli_x) {
+            matrix[row * 4 + row] = cos_half;
+            matrix[row * 4 + (3 - row)] = minus_i_sin;
+        } else {
+            const bool odd = row == 1 || row == 2;
+            matrix[row * 4 + row] = cos_half + (odd ? -minus_i_sin : minus_i_sin);
+        }
+    }
+    return matrix;
+}
+
+const array<Builtin, 38> BUILTINS = {{
+    {"U", 3, 1,
+     [](Circuit& c, const double* p, const int* q) { return c.u3(q[0], p[0], p[1], p[2]); }},
+    {"u3", 3, 1,
+     [](Circuit& c, const double* p, const int* q) { return c.u3(q[0], p[0], p[1], p[2]); }},
+    {"u", 3, 1,
+     [](Circuit& c, const double* p, const int* q) { return c.u3(q[0], p[0], p[1], p[2]); }},
+    {"u2", 2, 1,
+     [](Circuit& c, const double* p, const int* q) {
+         return c.u3(q[0], numbers::pi / 2, p[0], p[1]);
+     }},
+    {"u1", 1, 1,
+     [](Circuit& c, const double* p, const int* q) { return single(c, q[0], phase(p[0])); }},
+    {"p", 1, 1,
+     [](Circuit& c, const double* p, const int* q) { return single(c, q[0], phase(p[0])); }},
+    {"u0", 1, 1, [](Circuit&, const double*, const int*) { return expected<void, Error>{}; }},
+    {"id", 0, 1, [](Circuit&, const double*, const int*) { return expected<void, Error>{}; }},
+    {"x", 0, 1, [](Circuit& c, const double*, const int* q) { return c.pauli_x(q[0]); }},
+    {"y", 0, 1, [](Circuit& c, const double*, const int* q) { return c.pauli_y(q[0]); }},
+    {"z", 0, 1, [](Circuit& c, const double*, const int* q) { return c.pauli_z(q[0]); }},
+    {"h", 0, 1, [](Circuit& c, const double*, const int* q) { return c.hadamard(q[0]); }},
+    {"s", 0, 1, [](Circuit& c, const double*, const int* q) { return c.s_gate(q[0]); }},
+    {"sdg", 0, 1,
+     [](Circuit& c, const double*, const int* q) {
+         return single(c, q[0], adjoint(gates::s_gate()));
+     }},
+    {"t", 0, 1, [](Circuit& c, const double*, const int* q) { return c.t_gate(q[0]); }},
+    {"tdg", 0, 1,
+     [](Circuit& c, const double*, const int* q) {
+         return single(c, q[0], adjoint(gates::t_gate()));
+     }},
+    {"sx", 0, 1, [](Circuit& c, const double*, const int* q) { return c.sqrt_pauli_x(q[0]); }},
+    {"sxdg", 0, 1,
+     [](Circuit& c, const double*, const int* q) {
+         return single(c, q[0], adjoint(gates::sqrt_pauli_x()));
+     }},
+    {"rx", 1, 1,
+     [](Circuit& c, const double* p, const int* q) { return c.rotation_x(q[0], p[0]); }},
+    {"ry", 1, 1,
+     [](Circuit& c, const double* p, const int* q) { return c.rotation_y(q[0], p[0]); }},
+    {"rz", 1, 1,
+     [](Circuit& c, const double* p, const int* q) { return c.rotation_z(q[0], p[0]); }},
+    {"CX", 0, 2,
+     [](Circuit& c, const double*, const int* q) { return c.controlled_x(q[0], q[1]); }},
+    {"cx", 0, 2,
+     [](Circuit& c, const double*, const int* q) { return c.controlled_x(q[0], q[1]); }},
+    {"cy", 0, 2,
+     [](Circuit& c, const double*, const int* q) {
+         return control(c, q[0], q[1], gates::pauli_y());
+     }},
+    {"cz", 0, 2,
+     [](Circuit& c, const double*, const int* q) { return c.controlled_z(q[0], q[1]); }},
+    {"ch", 0, 2,
+     [](Circuit& c, const double*, const int* q) {
+         return control(c, q[0], q[1], gates::hadamard());
+     }},
+    {"csx", 0, 2,
+     [](Circuit& c, const double*, const int* q) {
+         return control(c, q[0], q[1], gates::sqrt_pauli_x());
+     }},
+    {"crx", 1, 2,
+     [](Circuit& c, const double* p, const int* q) {
+         return control(c, q[0], q[1], gates::rotation_x(p[0]));
+     }},
+    {"cry", 1, 2,
+     [](Circuit& c, const double* p, const int* q) {
+         return control(c, q[0], q[1], gates::rotation_y(p[0]));
+     }},
+    {"crz", 1, 2,
+     [](Circuit& c, const double* p, const int* q) {
+         return control(c, q[0], q[1], gates::rotation_z(p[0]));
+     }},
+    {"cu1", 1, 2,
+     [](Circuit& c, const double* p, const int* q) {
+         return c.controlled_phase(q[0], q[1], p[0]);
+     }},
+    {"cp", 1, 2,
+     [](Circuit& c, const double* p, const int* q) {
+         return c.controlled_phase(q[0], q[1], p[0]);
+     }},
+    {"cu3", 3, 2,
+     [](Circuit& c, const double* p, const int* q) {
+         return control(c, q[0], q[1], gates::u3(p[0], p[1], p[2]));
+     }},
+    {"swap", 0, 2,
+     [](Circuit& c, const double*, const int* q) {
+         return c.add_gate({q[0], q[1]}, {1, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 1});
+     }},
+    {"rxx", 1, 2,
+     [](Circuit& c, const double* p, const int* q) {
+         return c.add_gate({q[0], q[1]}, pauli_pair_rotation(p[0], true));
+     }},
+    {"rzz", 1, 2,
+     [](Circuit& c, const double* p, const int* q) {
+         return c.add_gate({q[0], q[1]}, pauli_pair_rotation(p[0], false));
+     }},
+    {"ccx", 0, 3,
+     [](Circuit& c, const double*, const int* q) { return c.toffoli(q[0], q[1], q[2]); }},
+    {"cswap", 0, 3,
+     [](Circuit& c, const double*, const int* q) {
+         if (auto result = c.controlled_x(q[2], q[1]); !result) {
+             return result;
+         }
+         if (auto result = c.toffoli(q[0], q[1], q[2]); !result) {
+             return result;
+         }
+         return c.controlled_x(q[2], q[1]);
+     }},
+}};
+
+const Builtin* find_builtin(const string_view name) {
+    static const unordered_map<string_view, const Builtin*> by_name = [] {
+        unordered_map<string_view, const Builtin*> table;
+        for (const auto& builtin : BUILTINS) {
+            table.emplace(builtin.name, &builtin);
+        }
+        return table;
+    }();
+    const auto found = by_name.find(name);
+    return found == by_name.end() ? nullptr : found->second;
+}
+
+struct GateDef;
+
+/**
+ * Gate applied in the body of a gate definition. args index the arguments of the definition.
+ */
+struct BodyCall {
+    const Builtin* builtin;
+    const GateDef* gate;
+    vector<Expr> params;
+    vector<int> args;
+};
+
+struct GateDef {
+    int num_params;
+    int num_qubits;
+    vector<BodyCall> body;
+};
+
+struct Register {
+    int offset;
+    int size;
+};
+
+/**
+ * Register or single element operand of a statement.
+ */
+struct Operand {
+    Register reg;
+    int index; // -1 for the whole register
+};
+
+using Registers = vector<pair<string_view, Register>>;
+
+struct ParseFailure {
+    QasmError error;
+};
+
+class Parser {
+  private:
+    Lexer lexer;
+    Token token;
+    // Programs declare a handful of registers, so they are searched linearly
+    Registers qregs;
+    Registers cregs;
+    unordered_map<string_view, GateDef> gate_defs;
+    int num_qubits = 0;
+    int num_clbits = 0;
+    optional<Circuit> circuit;
+    vector<Measurement> measurements;
+    vector<bool> measured;
+
+    // Reused by every statement, so parsing a gate allocates nothing
+    Expr expr_buffer;
+    vector<double> eval_stack;
+    vector<double> params_buffer;
+    vector<Operand> operands_buffer;
+    vector<int> qubits_buffer;
+
+    [[noreturn]] void fail(const string& message) const {
+        throw ParseFailure{{this->token.line, message}};
+    }
+
+    void advance() {
+        this->token = this->lexer.next();
+    }
+
+    [[nodiscard]] bool at(const string_view text) const {
+        return this->token.kind != TokenKind::string && this->token.text == text;
+    }
+
+    [[nodiscard]] string found() const {
+        if (this->token.kind == TokenKind::end) {
+            return "end of file";
+        }
+        string quoted = "'";
+        quoted.append(this->token.text).append("'");
+        return quoted;
+    }
+
+    void expect(const string_view symbol) {
+        if (!this->at(symbol)) {
+            this->fail("expected '" + string(symbol) + "' but found " + this->found());
+        }
+        this->advance();
+    }
+
+    string_view expect_identifier() {
+        if (this->token.kind != TokenKind::identifier) {
+            this->fail("expected an identifier but found " + this->found());
+        }
+        const string_view name = this->token.text;
+        this->advance();
+        return name;
+    }
+
+    int expect_integer() {
+        int value = 0;
+        const string_view text = this->token.text;
+        const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+        if (this->token.kind != TokenKind::number || error != errc{} ||
+            end != text.data() + text.size()) {
+            this->fail("expected an integer but found " + this->found());
+        }
+        this->advance();
+        return value;
+    }
+
+    // expression := term (('+' | '-') term)*
+    void parse_expression(Expr& expr, span<const string_view> param_names) {
+        this->parse_term(expr, param_names);
+        while (this->at("+") || this->at("-")) {
+            const auto kind = this->at("+") ? ExprOpKind::add : ExprOpKind::subtract;
+            this->advance();
+            this->parse_term(expr, param_names);
+            expr.push_back({kind, 0.0, 0});
+        }
+    }
+
+    // term := unary (('*' | '/') unary)*
+    void parse_term(Expr& expr, span<const string_view> param_names) {
+        this->parse_unary(expr, param_names);
+        while (this->at("*") || this->at("/")) {
+            const auto kind = this->at("*") ? ExprOpKind::multiply : ExprOpKind::divide;
+            this->advance();
+            this->parse_unary(expr, param_names);
+            expr.push_back({kind, 0.0, 0});
+        }
+    }
+
+    // unary := '-' unary | primary ('^' unary)?
+    void parse_unary(Expr& expr, span<const string_view> param_names) {
+        if (this->at("-")) {
+            this->advance();
+            this->parse_unary(expr, param_names);
+            expr.push_back({ExprOpKind::negate, 0.0, 0});
+            return;
+        }
+        if (this->at("+")) {
+            this->advance();
+            this->parse_unary(expr, param_names);
+            return;
+        }
+        this->parse_primary(expr, param_names);
+        if (this->at("^")) {
+            this->advance();
+            this->parse_unary(expr, param_names);
+            expr.push_back({ExprOpKind::power, 0.0, 0});
+        }
+    }
+
+    void parse_primary(Expr& expr, span<const string_view> param_names) {
+        if (this->token.kind == TokenKind::number) {
+            double value = 0.0;
+            const string_view text = this->token.text;
+            from_chars(text.data(), text.data() + text.size(), value);
+            expr.push_back({ExprOpKind::constant, value, 0});
+            this->advance();
+            return;
+        }
+        if (this->at("(")) {
+            this->advance();
+            this->parse_expression(expr, param_names);
+            this->expect(")");
+            return;
+        }
+        if (this->token.kind != TokenKind::identifier) {
+            this->fail("expected an expression but found " + this->found());
+        }
+
+        const string_view name = this->token.text;
+        if (name == "pi") {
+            expr.push_back({ExprOpKind::constant, numbers::pi, 0});
+            this->advance();
+            return;
+        }
+        if (const auto param = ranges::find(param_names, name); param != param_names.end()) {
+            expr.push_back(
+                {ExprOpKind::parameter, 0.0, static_cast<int>(param - param_names.begin())});
+            this->advance();
+            return;
+        }
+        const auto function = ranges::find(FUNCTIONS, name, &pair<string_view, ExprOpKind>::first);
+        if (function == FUNCTIONS.end()) {
+            this->fail("unknown parameter '" + string(name) + "'");
+        }
+        this->advance();
+        this->expect("(");
+        this->parse_expression(expr, param_names);
+        this->expect(")");
+        expr.push_back({function->second, 0.0, 0});
+    }
+
+    // ('(' expression (',' expression)* ')')?
+    vector<Expr> parse_params(span<const string_view> param_names) {
+        vector<Expr> params;
+        if (!this->at("(")) {
+            return params;
+        }
+        this->advance();
+        if (!this->at(")")) {
+            params.emplace_back();
+            this->parse_expression(params.back(), param_names);
+            while (this->at(",")) {
+                this->advance();
+                params.emplace_back();
+                this->parse_expression(params.back(), param_names);
+            }
+        }
+        this->expect(")");
+        return params;
+    }
+
+    static const Register* find_register(const Registers& registers, const string_view name) {
+        const auto reg = ranges::find(registers, name, &pair<string_view, Register>::first);
+        return reg == registers.end() ? nullptr : &reg->second;
+    }
+
+    void parse_register(Registers& registers, int& total) {
+        if (this->circuit) {
+            this->fail("registers must be declared before the first gate");
+        }
+        const string_view name = this->expect_identifier();
+        this->expect("[");
+        const int size = this->expect_integer();
+        this->expect("]");
+        // Checked before the ';' so errors point at the declaration's line
+        if (size <= 0) {
+            this->fail("register '" + string(name) + "' must hold at least one bit");
+        }
+        if (find_register(this->qregs, name) != nullptr ||
+            find_register(this->cregs, name) != nullptr) {
+            this->fail("register '" + string(name) + "' is already declared");
+        }
+        // Checked before adding, so the total cannot overflow
+        if (size > MAX_REGISTER_BITS - total) {
+            this->fail(&registers == &this->qregs ? "at most 63 qubits are supported"
+                                                  : "at most 63 classical bits are supported");
+        }
+        this->expect(";");
+        registers.emplace_back(name, Register{total, size});
+        total += size;
+    }
+
+    Operand parse_operand(const Registers& registers) {
+        const string_view name = this->expect_identifier();
+        const Register* reg = find_register(registers, name);
+        if (reg == nullptr) {
+            this->fail("unknown register '" + string(name) + "'");
+        }
+        if (!this->at("[")) {
+            return {*reg, -1};
+        }
+        this->advance();
+        const int index = this->expect_integer();
+        if (index < 0 || index >= reg->size) {
+            this->fail("index " + to_string(index) + " is out of range for register '" +
+                       string(name) + "' of size " + to_string(reg->size));
+        }
+        this->expect("]");
+        return {*reg, index};
+    }
+
+    /**
+     * @brief Number of times a statement is applied: the size of its whole register operands,
+     *  which must agree, or 1.
+     */
+    int broadcast_size(span<const Operand> operands) const {
+        int size = 1;
+        bool whole = false;
+        for (const auto& operand : operands) {
+            if (operand.index >= 0) {
+                continue;
+            }
+            if (whole && operand.reg.size != size) {
+                this->fail("registers of different sizes in one statement");
+            }
+            size = operand.reg.size;
+            whole = true;
+        }
+        return size;
+    }
+
+    Circuit& get_circuit() {
+        if (!this->circuit) {
+            if (this->num_qubits == 0) {
+                this->fail("no quantum register is declared");
+            }
+            this->circuit.emplace(this->num_qubits);
+            this->measured.assign(this->num_qubits, false);
+        }
+        return *this->circuit;
+    }
+
+    void apply(const Builtin* builtin, const GateDef* gate, span<const double> params,
+               span<const int> qubits) {
+        if (builtin != nullptr) {
+            for (const int qubit : qubits) {
+                if (this->measured[qubit - 1]) {
+                    this->fail("gate applied to measured qubit " + to_string(qubit) +
+                               "; mid-circuit measurement is not supported");
+                }
+            }
+            if (!builtin->emit(*this->circuit, params.data(), qubits.data())) {
+                this->fail("invalid operands for '" + string(builtin->name) + "'");
+            }
+            return;
+        }
+
+        vector<double> call_params;
+        vector<int> call_qubits;
+        for (const auto& call : gate->body) {
+            call_params.clear();
+            for (const auto& expr : call.params) {
+                call_params.push_back(evaluate(expr, params, this->eval_stack));
+            }
+            call_qubits.clear();
+            for (const int arg : call.args) {
+                call_qubits.push_back(qubits[arg]);
+            }
+            this->apply(call.builtin, call.gate, call_params, call_qubits);
+        }
+    }
+
+    /**
+     * @brief Looks up a gate, user definitions first, and checks its arity.
+     */
+    pair<const Builtin*, const GateDef*> resolve_gate(const string_view name,
+                                                      const size_t num_params) const {
+        int expected_params = 0;
+        pair<const Builtin*, const GateDef*> resolved{nullptr, nullptr};
+        if (const auto def = this->gate_defs.empty() ? this->gate_defs.end()
+                                                     : this->gate_defs.find(name);
+            def != this->gate_defs.end()) {
+            resolved.second = &def->second;
+            expected_params = def->second.num_params;
+        } else if (const Builtin* builtin = find_builtin(name); builtin != nullptr) {
+            resolved.first = builtin;
+            expected_params = builtin->num_params;
+        } else {
+            this->fail("unknown gate '" + string(name) + "'");
+        }
+        if (static_cast<int>(num_params) != expected_params) {
+            this->fail("gate '" + string(name) + "' takes " + to_string(expected_params) +
+                       " parameters, not " + to_string(num_params));
+        }
+        return resolved;
+    }
+
+    static int num_gate_qubits(const pair<const Builtin*, const GateDef*>& gate) {
+        return gate.first != nullptr ? gate.first->num_qubits : gate.second->num_qubits;
+    }
+
+    // ('(' expression (',' expression)* ')')?, evaluated right away
+    void parse_constant_params(vector<double>& params) {
+        params.clear();
+        if (!this->at("(")) {
+            return;
+        }
+        this->advance();
+        while (!this->at(")")) {
+            if (!params.empty()) {
+                this->expect(",");
+            }
+            this->expr_buffer.clear();
+            this->parse_expression(this->expr_buffer, {});
+            params.push_back(evaluate(this->expr_buffer, {}, this->eval_stack));
+        }
+        this->advance();
+    }
+
+    void parse_gate_application(const string_view name) {
+        auto& params = this->params_buffer;
+        this->parse_constant_params(params);
+        const auto gate = this->resolve_gate(name, params.size());
+
+        auto& operands = this->operands_buffer;
+        operands.assign(1, this->parse_operand(this->qregs));
+        while (this->at(",")) {
+            this->advance();
+            operands.push_back(this->parse_operand(this->qregs));
+        }
+        if (static_cast<int>(operands.size()) != num_gate_qubits(gate)) {
+            this->fail("gate '" + string(name) + "' acts on " +
+                       to_string(num_gate_qubits(gate)) + " qubits, not " +
+                       to_string(operands.size()));
+        }
+
+        const int repeats = this->broadcast_size(operands);
+        this->get_circuit();
+        auto& qubits = this->qubits_buffer;
+        qubits.resize(operands.size());
+        for (int i = 0; i < repeats; i++) {
+            for (size_t k = 0; k < operands.size(); k++) {
+                const auto& operand = operands[k];
+                qubits[k] = operand.reg.offset + (operand.index >= 0 ? operand.index : i) + 1;
+                if (find(qubits.begin(), qubits.begin() + static_cast<ptrdiff_t>(k),
+                         qubits[k]) != qubits.begin() + static_cast<ptrdiff_t>(k)) {
+                    this->fail("gate '" + string(name) + "' applied twice to qubit " +
+                               to_string(qubits[k]));
+                }
+            }
+            this->apply(gate.first, gate.second, params, qubits);
+        }
+        this->expect(";");
+    }
+
+    void parse_gate_definition() {
+        const string_view name = this->expect_identifier();
+        if (this->gate_defs.contains(name)) {
+            this->fail("gate '" + string(name) + "' is already defined");
+        }
+
+        vector<string_view> param_names;
+        if (this->at("(")) {
+            this->advance();
+            if (!this->at(")")) {
+                param_names.push_back(this->expect_identifier());
+                while (this->at(",")) {
+                    this->advance();
+                    param_names.push_back(this->expect_identifier());
+                }
+            }
+            this->expect(")");
+        }
+        vector<string_view> arg_names{this->expect_identifier()};
+        while (this->at(",")) {
+            this->advance();
+            arg_names.push_back(this->expect_identifier());
+        }
+
+        GateDef def{static_cast<int>(param_names.size()), static_cast<int>(arg_names.size()), {}};
+        this->expect("{");
+        while (!this->at("}")) {
+            if (this->token.kind == TokenKind::end) {
+                this->fail("unterminated definition of gate '" + string(name) + "'");
+            }
+            const bool barrier = this->at("barrier");
+            const string_view callee = this->expect_identifier();
+            auto params = this->parse_params(param_names);
+            const auto gate = barrier ? pair<const Builtin*, const GateDef*>{}
+                                      : this->resolve_gate(callee, params.size());
+
+            vector<int> args;
+            do {
+                if (!args.empty()) {
+                    this->advance();
+                }
+                const string_view arg = this->expect_identifier();
+                const auto found_arg = ranges::find(arg_names, arg);
+                if (found_arg == arg_names.end()) {
+                    this->fail("unknown qubit argument '" + string(arg) + "'");
+                }
+                const auto index = static_cast<int>(found_arg - arg_names.begin());
+                if (ranges::find(args, index) != args.end()) {
+                    this->fail("gate '" + string(callee) + "' applied twice to '" +
+                               string(arg) + "'");
+                }
+                args.push_back(index);
+            } while (this->at(","));
+            this->expect(";");
+
+            if (barrier) {
+                continue;
+            }
+            if (static_cast<int>(args.size()) != num_gate_qubits(gate)) {
+                this->fail("gate '" + string(callee) + "' acts on " +
+                           to_string(num_gate_qubits(gate)) + " qubits, not " +
+                           to_string(args.size()));
+            }
+            def.body.push_back({gate.first, gate.second, std::move(params), std::move(args)});
+        }
+        this->advance();
+        this->gate_defs.emplace(name, std::move(def));
+    }
+
+    void parse_measure() {
+        const Operand qubit = this->parse_operand(this->qregs);
+        this->expect("->");
+        const Operand clbit = this->parse_operand(this->cregs);
+        this->expect(";");
+        if ((qubit.index < 0) != (clbit.index < 0)) {
+            this->fail("measure needs two registers or two single bits");
+        }
+        const array<Operand, 2> operands{qubit, clbit};
+        const int repeats = this->broadcast_size(operands);
+        this->get_circuit();
+        for (int i = 0; i < repeats; i++) {
+            const int measured_qubit = qubit.reg.offset + (qubit.index >= 0 ? qubit.index : i);
+            const int measured_clbit = clbit.reg.offset + (clbit.index >= 0 ? clbit.index : i);
+            this->measured[measured_qubit] = true;
+            this->measurements.push_back({measured_qubit + 1, measured_clbit});
+        }
+    }
+
+    void parse_statement() {
+        const string_view keyword = this->expect_identifier();
+        if (keyword == "include") {
+            if (this->token.kind != TokenKind::string || this->token.text != "qelib1.inc") {
+                this->fail("only qelib1.inc can be included");
+            }
+            this->advance();
+            this->expect(";");
+        } else if (keyword == "qreg") {
+            this->parse_register(this->qregs, this->num_qubits);
+        } else if (keyword == "creg") {
+            this->parse_register(this->cregs, this->num_clbits);
+        } else if (keyword == "gate") {
+            this->parse_gate_definition();
+        } else if (keyword == "measure") {
+            this->parse_measure();
+        } else if (keyword == "barrier") {
+            while (!this->at(";") && this->token.kind != TokenKind::end) {
+                this->advance();
+            }
+            this->expect(";");
+        } else if (keyword == "opaque" || keyword == "reset" || keyword == "if") {
+            this->fail("'" + string(keyword) + "' statements are not supported");
+        } else {
+            this->parse_gate_application(keyword);
+        }
+    }
+
+  public:
+    explicit Parser(const string_view source) : lexer(source) {
+        this->advance();
+    }
+
+    QasmProgram parse() {
+        if (this->at("OPENQASM")) {
+            this->advance();
+            if (this->token.kind != TokenKind::number || !this->token.text.starts_with("2")) {
+                this->fail("only OpenQASM 2 is supported");
+            }
+            this->advance();
+            this->expect(";");
+        }
+        while (this->token.kind != TokenKind::end) {
+            this->parse_statement();
+        }
+        this->get_circuit();
+        return {std::move(*this->circuit), std::move(this->measurements), this->num_clbits};
+    }
+};
+
+} // namespace
+
+auto parse_qasm(const string_view source) -> expected<QasmProgram, QasmError> {
+    try {
+        return Parser(source).parse();
+    } catch (const ParseFailure& failure) {
+        return unexpected(failure.error);
+    }
+}
+
+auto parse_qasm_file(const string& path) -> expected<QasmProgram, QasmError> {
+    ifstream file(path, ios::binary);
+    if (!file) {
+        return unexpected(QasmError{0, "cannot open '" + path + "'"});
+    }
+    stringstream contents;
+    contents << file.rdbuf();
+    return parse_qasm(contents.view());
+}
@@ -0,0 +1,58 @@
+#ifndef QASM_PARSER_HPP
+#define QASM_PARSER_HPP
+
+#include "circuit.hpp"
+#include <expected>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Measurement recorded by a QASM measure statement: qubit (1-based, as everywhere else) is read
+ * into clbit, the 0-based position in the classical registers concatenated in declaration order.
+ */
+struct Measurement {
+    int qubit;
+    int clbit;
+};
+
+/**
+ * An OpenQASM 2 program: its gates, recorded into a circuit, and its measurements.
+ */
+struct QasmProgram {
+    Circuit circuit;
+    std::vector<Measurement> measurements;
+    int num_clbits;
+};
+
+struct QasmError {
+    int line;
+    std::string message;
+};
+
+inline std::string to_string(const QasmError& err) {
+    return "line " + std::to_string(err.line) + ": " + err.message;
+}
+
+inline std::ostream& operator<<(std::ostream& ostr, const QasmError& err) {
+    return ostr << to_string(err);
+}
+
+/**
+ * @brief Parses an OpenQASM 2 program into a circuit, in a single pass over the source.
+ *  The qelib1.inc gates are built in, so the include is accepted without reading the file,
+ *  and gate definitions are expanded into them where they are applied. Register indices are
+ *  checked here, so running the circuit checks nothing per gate.
+ *  Qubits are numbered through the quantum registers in declaration order, which must all come
+ *  before the first gate. Measurements must come after the last gate on their qubit; barriers
+ *  are ignored; opaque, reset and if statements are rejected.
+ */
+auto parse_qasm(std::string_view source) -> std::expected<QasmProgram, QasmError>;
+
+/**
+ * @brief Reads the file at path in one go and parses it with parse_qasm.
+ */
+auto parse_qasm_file(const std::string& path) -> std::expected<QasmProgram, QasmError>;
+
+#endif
@@ -1,7 +1,16 @@
 #include "qstate_vec.hpp"
-#include <cassert>
+#include "checkpoint.hpp"
+#include "gates.hpp"
+#include "kernels.hpp"
+#include "profiler.hpp"
+#include "sparse_kernels.hpp"
+#include <algorithm>
+#include <bit>
 #include <cmath>
 #include <iostream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
 
 #define MASK(N) (0x1ull << N)
 #define PRINT(var_name, var)                                                                       \
@@ -10,556 +19,755 @@
 
 using namespace std;
 
-auto QStateVec::pauli_y(const int target_qubit) -> expected<void, Error> {
+namespace {
+
+bool is_diagonal(const Matrix2& matrix) {
+    return matrix[1] == 0.0 && matrix[2] == 0.0;
+}
+
+} // namespace
+
+template <typename T> auto QStateVec<T>::pauli_y(const int target_qubit) -> expected<void, Error> {
     if (target_qubit > this->num_qubits || target_qubit <= 0) {
         return unexpected(Error::invalid_input);
     }
+    PROFILE_SCOPE("pauli_y", target_qubit, this->stored_bytes(), this->stored_bytes());
 
-    for (size_t i = 0; i < this->main.size(); i++) {
-        if (abs(this->main[i]) != 0) {
-            // if |0>, scalar 1i applies to |1>
-            // if |1>, scalar -1i applies to |0>
-            auto target_state = i ^ MASK((target_qubit - 1));
+    if (this->sparse_storage) {
+        return this->apply_1q(target_qubit, gates::pauli_y());
+    }
 
-            if ((target_state & MASK((target_qubit - 1))) != 0) {
-                this->parity[target_state] = this->main[i] * 1i;
-            } else {
-                this->parity[target_state] = this->main[i] * -1i;
-            }
-        }
+    kernels::pauli_y<T>(this->main, target_qubit - 1, this->num_threads);
+    return {};
+}
+
+template <typename T> auto QStateVec<T>::pauli_x(const int target_qubit) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("pauli_x", target_qubit, this->stored_bytes(), this->stored_bytes());
+
+    if (this->sparse_storage) {
+        return this->apply_1q(target_qubit, gates::pauli_x());
+    }
+
+    kernels::pauli_x<T>(this->main, target_qubit - 1, this->num_threads);
+    return {};
+}
+
+template <typename T>
+auto QStateVec<T>::apply_1q(const int target_qubit, const Matrix2& matrix)
+    -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("apply_1q", target_qubit, this->stored_bytes(), this->stored_bytes());
+
+    if (is_diagonal(matrix)) {
+        return this->apply_diagonal(target_qubit, {matrix[0], matrix[3]});
     }
 
-    this->reset_parity_layer();
+    if (this->sparse_storage) {
+        sparse::controlled_apply_1q<T>(this->update_sparse(), 0, target_qubit - 1,
+                                       kernels::cast_matrix<T>(matrix));
+        this->update_storage();
+        return {};
+    }
+
+    kernels::apply_1q<T>(this->main, target_qubit - 1, kernels::cast_matrix<T>(matrix),
+                         this->num_threads);
     return {};
 }
 
-auto QStateVec::pauli_x(const int target_qubit) -> expected<void, Error> {
+template <typename T>
+auto QStateVec<T>::apply_diagonal(const int target_qubit,
+                                  const array<complex<double>, 2>& diagonal)
+    -> expected<void, Error> {
     if (target_qubit > this->num_qubits || target_qubit <= 0) {
         return unexpected(Error::invalid_input);
     }
+    PROFILE_SCOPE("apply_diagonal", target_qubit, this->stored_bytes(), this->stored_bytes());
+
+    const array<complex<T>, 2> cast_diagonal = {complex<T>(diagonal[0]), complex<T>(diagonal[1])};
+    if (this->sparse_storage) {
+        sparse::apply_diagonal<T>(this->update_sparse(), 0, target_qubit - 1, cast_diagonal);
+        return {};
+    }
+
+    kernels::apply_diagonal<T>(this->main, 0, target_qubit - 1, cast_diagonal, this->num_threads);
+    return {};
+}
 
-    for (size_t i = 0; i < this->main.size(); i++) {
-        if (abs(this->main[i]) != 0) {
-            auto target_state = i ^ MASK((target_qubit - 1));
-            this->parity[target_state] = this->main[i];
+template <typename T>
+auto QStateVec<T>::apply_diagonals(const vector<DiagonalGate>& gates) -> expected<void, Error> {
+    // diag(d0, d1) under controls C is d0 on every state with C set, times d1 / d0 on every state
+    // with C and the target set
+    vector<pair<uint64_t, complex<double>>> terms;
+    complex<double> global_phase = {1.0, 0.0};
+    for (const auto& gate : gates) {
+        if (gate.target_qubit > this->num_qubits || gate.target_qubit <= 0) {
+            return unexpected(Error::invalid_input);
         }
+        const uint64_t target_mask = MASK((gate.target_qubit - 1));
+        if ((gate.controls_mask >> this->num_qubits) != 0 ||
+            (gate.controls_mask & target_mask) != 0 || gate.phases[0] == 0.0) {
+            return unexpected(Error::invalid_input);
+        }
+
+        if (gate.controls_mask == 0) {
+            global_phase *= gate.phases[0];
+        } else if (gate.phases[0] != 1.0) {
+            terms.emplace_back(gate.controls_mask, gate.phases[0]);
+        }
+        terms.emplace_back(gate.controls_mask | target_mask, gate.phases[1] / gate.phases[0]);
+    }
+
+    PROFILE_SCOPE("apply_diagonals", 0, this->stored_bytes(), this->stored_bytes());
+
+    // Sparse storage visits few amplitudes per gate, so the phases are applied one gate at a time
+    if (this->sparse_storage) {
+        AmplitudeMap<T>& amps = this->update_sparse();
+        for (const auto& gate : gates) {
+            sparse::apply_diagonal<T>(amps, gate.controls_mask, gate.target_qubit - 1,
+                                      {complex<T>(gate.phases[0]), complex<T>(gate.phases[1])});
+        }
+        return {};
+    }
+
+    // Identical masks collapse into one term
+    ranges::sort(terms, {}, &pair<uint64_t, complex<double>>::first);
+    vector<pair<uint64_t, complex<double>>> merged;
+    for (const auto& term : terms) {
+        if (!merged.empty() && merged.back().first == term.first) {
+            merged.back().second *= term.second;
+        } else {
+            merged.push_back(term);
+        }
+    }
+
+    const auto table = kernels::make_phase_table<T>(this->num_qubits, merged, global_phase);
+    kernels::apply_phases<T>(this->main, table, this->num_threads);
+    return {};
+}
+
+template <typename T>
+auto QStateVec<T>::apply_nq(const vector<int>& target_qubits, const MatrixN& matrix)
+    -> expected<void, Error> {
+    const auto num_targets = static_cast<int>(target_qubits.size());
+    if (num_targets == 0 || num_targets > kernels::MAX_BLOCK_QUBITS ||
+        matrix.size() != MASK(2 * num_targets)) {
+        return unexpected(Error::invalid_input);
+    }
+
+    uint64_t target_mask = 0;
+    for (const int target_qubit : target_qubits) {
+        if (target_qubit > this->num_qubits || target_qubit <= 0 ||
+            (target_mask & MASK((target_qubit - 1))) != 0) {
+            return unexpected(Error::invalid_input);
+        }
+        target_mask |= MASK((target_qubit - 1));
+    }
+
+    PROFILE_SCOPE("apply_nq", target_qubits[0], this->stored_bytes(), this->stored_bytes());
+    vector<int> targets(target_qubits.size());
+    ranges::transform(target_qubits, targets.begin(), [](const int qubit) { return qubit - 1; });
+    if (this->sparse_storage) {
+        sparse::apply_nq<T>(this->update_sparse(), targets, kernels::cast_matrix<T>(matrix));
+        this->update_storage();
+        return {};
+    }
+    kernels::apply_nq<T>(this->main, targets, kernels::cast_matrix<T>(matrix), this->num_threads);
+    return {};
+}
+
+template <typename T>
+auto QStateVec<T>::controlled(const uint64_t controls_mask, const int target_qubit,
+                              const Matrix2& matrix) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0 ||
+        (controls_mask >> this->num_qubits) != 0 ||
+        (controls_mask & MASK((target_qubit - 1))) != 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("controlled", target_qubit, this->stored_bytes() >> popcount(controls_mask),
+                  this->stored_bytes() >> popcount(controls_mask));
+
+    if (this->sparse_storage) {
+        sparse::controlled_apply_1q<T>(this->update_sparse(), controls_mask, target_qubit - 1,
+                                       kernels::cast_matrix<T>(matrix));
+        this->update_storage();
+        return {};
+    }
+
+    if (is_diagonal(matrix)) {
+        kernels::apply_diagonal<T>(this->main, controls_mask, target_qubit - 1,
+                                   {complex<T>(matrix[0]), complex<T>(matrix[3])},
+                                   this->num_threads);
+        return {};
     }
 
-    this->reset_parity_layer();
+    kernels::controlled_apply_1q<T>(this->main, controls_mask, target_qubit - 1,
+                                    kernels::cast_matrix<T>(matrix), this->num_threads);
     return {};
 }
 
-void QStateVec::reset_parity_layer() {
-    this->main = this->parity;
-    std::ranges::fill(this->parity, std::complex<PRECISION_TYPE>{0.0, 0.0});
+template <typename T>
+auto QStateVec<T>::controlled_x(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0 || target_qubit > this->num_qubits ||
+        target_qubit <= 0 || control_qubit == target_qubit) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("controlled_x", target_qubit, this->stored_bytes() / 2, this->stored_bytes() / 2);
+
+    if (this->sparse_storage) {
+        return this->controlled(MASK((control_qubit - 1)), target_qubit, gates::pauli_x());
+    }
+
+    kernels::controlled_pauli_x<T>(this->main, MASK((control_qubit - 1)), target_qubit - 1,
+                                   this->num_threads);
+    return {};
+}
+
+template <typename T>
+auto QStateVec<T>::controlled_z(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0 || target_qubit > this->num_qubits ||
+        target_qubit <= 0 || control_qubit == target_qubit) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("controlled_z", target_qubit, this->stored_bytes() / 2, this->stored_bytes() / 2);
+    return this->controlled(MASK((control_qubit - 1)), target_qubit, gates::pauli_z());
+}
+
+template <typename T>
+auto QStateVec<T>::controlled_phase(const int control_qubit, const int target_qubit,
+                                    const double angle) -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0 || target_qubit > this->num_qubits ||
+        target_qubit <= 0 || control_qubit == target_qubit) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("controlled_phase", target_qubit, this->stored_bytes() / 2,
+                  this->stored_bytes() / 2);
+    return this->controlled(MASK((control_qubit - 1)), target_qubit,
+                            {complex<double>{1.0, 0.0}, 0.0, 0.0, polar(1.0, angle)});
+}
+
+template <typename T>
+auto QStateVec<T>::toffoli(const int control_qubit1, const int control_qubit2,
+                           const int target_qubit) -> expected<void, Error> {
+    if (control_qubit1 > this->num_qubits || control_qubit1 <= 0 ||
+        control_qubit2 > this->num_qubits || control_qubit2 <= 0 ||
+        control_qubit1 == control_qubit2 || target_qubit > this->num_qubits ||
+        target_qubit <= 0 || control_qubit1 == target_qubit || control_qubit2 == target_qubit) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("toffoli", target_qubit, this->stored_bytes() / 4, this->stored_bytes() / 4);
+
+    if (this->sparse_storage) {
+        return this->controlled(MASK((control_qubit1 - 1)) | MASK((control_qubit2 - 1)),
+                                target_qubit, gates::pauli_x());
+    }
+
+    kernels::controlled_pauli_x<T>(this->main,
+                                   MASK((control_qubit1 - 1)) | MASK((control_qubit2 - 1)),
+                                   target_qubit - 1, this->num_threads);
+    return {};
 }
 
-vector<PRECISION_TYPE> QStateVec::get_measured_qubits() const {
-    auto measured_qubits = vector<PRECISION_TYPE>(this->num_qubits, 0.0);
+template <typename T> auto QStateVec<T>::pauli_z(const int target_qubit) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("pauli_z", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::pauli_z());
+}
 
-    for (size_t i = 0; i < this->main.size(); i++) {
-        if (abs(this->main[i]) == 0) {
-            continue;
+template <typename T> auto QStateVec<T>::hadamard(const int target_qubit) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("hadamard", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::hadamard());
+}
+
+template <typename T>
+auto QStateVec<T>::sqrt_pauli_x(const int target_qubit) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("sqrt_pauli_x", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::sqrt_pauli_x());
+}
+
+template <typename T>
+auto QStateVec<T>::sqrt_pauli_y(const int target_qubit) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("sqrt_pauli_y", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::sqrt_pauli_y());
+}
+
+template <typename T> auto QStateVec<T>::s_gate(const int target_qubit) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("s_gate", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::s_gate());
+}
+
+template <typename T> auto QStateVec<T>::t_gate(const int target_qubit) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("t_gate", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::t_gate());
+}
+
+template <typename T> auto QStateVec<T>::rotation_x(const int target_qubit, const double angle)
+    -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("rotation_x", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::rotation_x(angle));
+}
+
+template <typename T> auto QStateVec<T>::rotation_y(const int target_qubit, const double angle)
+    -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("rotation_y", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::rotation_y(angle));
+}
+
+template <typename T> auto QStateVec<T>::rotation_z(const int target_qubit, const double angle)
+    -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("rotation_z", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::rotation_z(angle));
+}
+
+template <typename T>
+auto QStateVec<T>::u3(const int target_qubit, const double theta, const double phi,
+                   const double lambda) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    PROFILE_SCOPE("u3", target_qubit, this->stored_bytes(), this->stored_bytes());
+    return this->apply_1q(target_qubit, gates::u3(theta, phi, lambda));
+}
+
+template <typename T> int QStateVec<T>::get_num_threads() const {
+    return this->num_threads;
+}
+
+template <typename T> void QStateVec<T>::set_zero_state() {
+    if (this->storage_mode == StorageMode::automatic) {
+        this->main = StateVector<T>();
+        this->sparse_storage = true;
+    }
+
+    if (this->sparse_storage) {
+        this->dense_view = {};
+        this->sparse = AmplitudeMap<T>();
+        this->sparse[0] = complex<T>{1.0, 0.0};
+        return;
+    }
+
+    kernels::first_touch<T>(this->main, this->num_threads);
+    this->main[0] = complex<T>{1.0, 0.0};
+}
+
+template <typename T> int QStateVec<T>::get_num_qubits() const {
+    return this->num_qubits;
+}
+
+template <typename T> const StateVector<T>& QStateVec<T>::get_state() const {
+    if (!this->sparse_storage) {
+        return this->main;
+    }
+
+    PROFILE_SCOPE("to_dense", 0, this->stored_bytes(),
+                  MASK(this->num_qubits) * sizeof(complex<T>));
+    this->dense_view = StateVector<T>(MASK(this->num_qubits));
+    sparse::to_dense<T>(this->sparse, this->dense_view);
+    return this->dense_view;
+}
+
+template <typename T> AmplitudeMap<T>& QStateVec<T>::update_sparse() {
+    this->dense_view = {};
+    return this->sparse;
+}
+
+template <typename T> complex<T> QStateVec<T>::get_amplitude(const uint64_t index) const {
+    return this->sparse_storage ? this->sparse.get(index) : this->main[index];
+}
+
+template <typename T> bool QStateVec<T>::is_sparse() const {
+    return this->sparse_storage;
+}
+
+template <typename T> StorageMode QStateVec<T>::get_storage_mode() const {
+    return this->storage_mode;
+}
+
+template <typename T> uint64_t QStateVec<T>::stored_bytes() const {
+    return this->sparse_storage ? this->sparse.size() * sizeof(typename AmplitudeMap<T>::Entry)
+                                : this->main.size() * sizeof(complex<T>);
+}
+
+template <typename T> uint64_t QStateVec<T>::get_num_stored() const {
+    return this->sparse_storage ? this->sparse.size() : this->main.size();
+}
+
+template <typename T> void QStateVec<T>::update_storage() {
+    if (this->storage_mode != StorageMode::automatic) {
+        return;
+    }
+
+    const auto size = static_cast<double>(MASK(this->num_qubits));
+    if (this->sparse_storage) {
+        if (this->num_qubits <= sparse::MAX_AUTO_DENSE_QUBITS &&
+            static_cast<double>(this->sparse.size()) > sparse::DENSE_FILL_RATIO * size) {
+            PROFILE_SCOPE("to_dense", 0, this->stored_bytes(),
+                          MASK(this->num_qubits) * sizeof(complex<T>));
+            this->main = StateVector<T>(MASK(this->num_qubits));
+            kernels::first_touch<T>(this->main, this->num_threads);
+            sparse::to_dense<T>(this->sparse, this->main);
+            this->sparse = {};
+            this->sparse_storage = false;
         }
+        return;
+    }
 
-        for (int j = 0; j < this->num_qubits; j++) {
-            // Does the current state represent part of the qubit counted by j?
-            if (i & MASK(j)) {
-                measured_qubits[j] += norm(this->main[i]);
-            }
+    const uint64_t num_nonzero = sparse::count_nonzero<T>(this->main, this->num_threads);
+    if (static_cast<double>(num_nonzero) < sparse::SPARSE_FILL_RATIO * size) {
+        PROFILE_SCOPE("to_sparse", 0, this->stored_bytes(),
+                      num_nonzero * sizeof(typename AmplitudeMap<T>::Entry));
+        this->sparse = sparse::from_dense<T>(this->main, num_nonzero);
+        this->main = {};
+        this->sparse_storage = true;
+    }
+}
+
+template <typename T> vector<T> QStateVec<T>::get_measured_qubits() const {
+    PROFILE_SCOPE("get_measured_qubits", 0, this->stored_bytes(), 0);
+    if (this->sparse_storage) {
+        return sparse::marginal_probabilities<T>(this->sparse, this->num_qubits);
+    }
+
+    const complex<T>* amps = this->main.data();
+    return kernels::marginal_probabilities<T>(this->main.size(), this->num_qubits,
+                                              this->num_threads,
+                                              [amps](const uint64_t i) { return norm(amps[i]); });
+}
+
+template <typename T>
+auto QStateVec<T>::get_probabilities(const vector<int>& qubits) const
+    -> expected<vector<T>, Error> {
+    vector<int> bits;
+    uint64_t seen = 0;
+    for (const int qubit : qubits) {
+        if (qubit > this->num_qubits || qubit <= 0 || (seen & MASK((qubit - 1))) != 0) {
+            return unexpected(Error::invalid_input);
         }
+        seen |= MASK((qubit - 1));
+        bits.push_back(qubit - 1);
+    }
+
+    PROFILE_SCOPE("get_probabilities", 0, this->stored_bytes(), 0);
+    if (this->sparse_storage) {
+        return sparse::joint_probabilities<T>(this->sparse, bits);
+    }
+
+    const complex<T>* amps = this->main.data();
+    return kernels::joint_probabilities<T>(this->main.size(), bits, this->num_threads,
+                                           [amps](const uint64_t i) { return norm(amps[i]); });
+}
+
+template <typename T>
+vector<pair<uint64_t, uint64_t>> QStateVec<T>::sample(const uint64_t shots,
+                                                      const uint64_t seed) const {
+    PROFILE_SCOPE("sample", 0, this->stored_bytes(), 0);
+    if (this->sparse_storage) {
+        return sparse::sample_counts<T>(this->sparse, shots, seed);
     }
 
-    return measured_qubits;
+    const complex<T>* amps = this->main.data();
+    return kernels::sample_counts(this->main.size(), shots, seed, this->num_threads,
+                                  [amps](const uint64_t i) -> double { return norm(amps[i]); });
 }
 
-void QStateVec::pretty_print() const {
+template <typename T>
+auto QStateVec<T>::expectation_values(const vector<PauliTerm>& terms) const
+    -> expected<vector<double>, Error> {
+    for (const auto& term : terms) {
+        if (((term.x_mask | term.z_mask) >> this->num_qubits) != 0) {
+            return unexpected(Error::invalid_input);
+        }
+    }
+
+    // Terms grouped by flip mask, each group evaluated in one pass
+    vector<size_t> order(terms.size());
+    iota(order.begin(), order.end(), 0);
+    ranges::stable_sort(order, {}, [&](const size_t t) { return terms[t].x_mask; });
+
+    vector<double> values(terms.size());
+    vector<uint64_t> z_masks;
+    for (size_t first = 0; first < order.size();) {
+        const uint64_t flip_mask = terms[order[first]].x_mask;
+        size_t last = first;
+        z_masks.clear();
+        for (; last < order.size() && terms[order[last]].x_mask == flip_mask; last++) {
+            z_masks.push_back(terms[order[last]].z_mask);
+        }
+
+        PROFILE_SCOPE("expectation", 0, this->stored_bytes(), 0);
+        const auto group =
+            this->sparse_storage
+                ? sparse::pauli_expectations<T>(this->sparse, flip_mask, z_masks)
+                : kernels::pauli_expectations<T>(this->main, flip_mask, z_masks,
+                                                 this->num_threads);
+        for (size_t k = 0; k < group.size(); k++) {
+            values[order[first + k]] = group[k];
+        }
+        first = last;
+    }
+    return values;
+}
+
+template <typename T>
+auto QStateVec<T>::expectation(const vector<PauliTerm>& terms) const -> expected<double, Error> {
+    const auto values = this->expectation_values(terms);
+    if (!values) {
+        return unexpected(values.error());
+    }
+    double total = 0;
+    for (size_t t = 0; t < terms.size(); t++) {
+        total += terms[t].coefficient * (*values)[t];
+    }
+    return total;
+}
+
+template <typename T>
+auto QStateVec<T>::collapse(const int target_qubit, mt19937_64& rng, const bool reset)
+    -> expected<int, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    // One pass for the probabilities, one to collapse
+    PROFILE_SCOPE(reset ? "reset" : "measure", target_qubit, 2 * this->stored_bytes(),
+                  this->stored_bytes());
+
+    // Drawing against p0 + p1 rather than 1 also absorbs rounding drift in the norm
+    const auto [p0, p1] =
+        this->sparse_storage
+            ? sparse::pair_probabilities<T>(this->sparse, target_qubit - 1)
+            : kernels::pair_probabilities<T>(this->main, target_qubit - 1, this->num_threads);
+    const double u = uniform_real_distribution<double>(0.0, p0 + p1)(rng);
+    const int outcome = u < p1 ? 1 : 0;
+    const auto scale = static_cast<T>(1.0 / sqrt(outcome == 1 ? p1 : p0));
+
+    if (this->sparse_storage) {
+        sparse::collapse<T>(this->update_sparse(), target_qubit - 1, outcome, scale, reset);
+    } else {
+        kernels::collapse<T>(this->main, target_qubit - 1, outcome, scale, reset,
+                             this->num_threads);
+    }
+    // A measurement is the only operation that can shrink the support of the state
+    this->update_storage();
+    return outcome;
+}
+
+template <typename T>
+auto QStateVec<T>::measure(const int target_qubit, mt19937_64& rng) -> expected<int, Error> {
+    return this->collapse(target_qubit, rng, false);
+}
+
+template <typename T>
+auto QStateVec<T>::reset(const int target_qubit, mt19937_64& rng) -> expected<int, Error> {
+    return this->collapse(target_qubit, rng, true);
+}
+
+template <typename T>
+auto QStateVec<T>::amplitude_damping(const int target_qubit, const double gamma, mt19937_64& rng)
+    -> expected<int, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0 || gamma < 0.0 || gamma > 1.0) {
+        return unexpected(Error::invalid_input);
+    }
+    // One pass for the probabilities, one to apply the drawn Kraus operator
+    PROFILE_SCOPE("amplitude_damping", target_qubit, 2 * this->stored_bytes(),
+                  this->stored_bytes());
+
+    const auto [p0, p1] =
+        this->sparse_storage
+            ? sparse::pair_probabilities<T>(this->sparse, target_qubit - 1)
+            : kernels::pair_probabilities<T>(this->main, target_qubit - 1, this->num_threads);
+    const double decay = gamma * p1;
+    if (uniform_real_distribution<double>(0.0, p0 + p1)(rng) < decay) {
+        // K1 = sqrt(gamma) |0><1|: the |1> half, renormalized, moves onto |0> like a reset
+        const auto scale = static_cast<T>(1.0 / sqrt(p1));
+        if (this->sparse_storage) {
+            sparse::collapse<T>(this->update_sparse(), target_qubit - 1, 1, scale, true);
+        } else {
+            kernels::collapse<T>(this->main, target_qubit - 1, 1, scale, true, this->num_threads);
+        }
+        this->update_storage();
+        return 1;
+    }
+
+    // K0 = |0><0| + sqrt(1 - gamma) |1><1|, renormalized
+    const double scale = 1.0 / sqrt(p0 + p1 - decay);
+    if (gamma == 1.0) {
+        // A projection onto |0>, so the |1> half is dropped rather than stored as zeros
+        if (this->sparse_storage) {
+            sparse::collapse<T>(this->update_sparse(), target_qubit - 1, 0, static_cast<T>(scale),
+                                false);
+        } else {
+            kernels::collapse<T>(this->main, target_qubit - 1, 0, static_cast<T>(scale), false,
+                                 this->num_threads);
+        }
+        this->update_storage();
+        return 0;
+    }
+
+    const array<complex<T>, 2> diagonal = {complex<T>(static_cast<T>(scale)),
+                                           complex<T>(static_cast<T>(sqrt(1.0 - gamma) * scale))};
+    if (this->sparse_storage) {
+        sparse::apply_diagonal<T>(this->update_sparse(), 0, target_qubit - 1, diagonal);
+    } else {
+        kernels::apply_diagonal<T>(this->main, 0, target_qubit - 1, diagonal, this->num_threads);
+    }
+    return 0;
+}
+
+template <typename T> void QStateVec<T>::pretty_print() const {
     stringstream print_buf;
     print_buf << "Main:   ";
 
+    if (this->sparse_storage) {
+        this->sparse.for_each([&](const uint64_t index, const complex<T>& amplitude) {
+            print_buf << index << ":" << amplitude << " ";
+        });
+    }
     for (const auto& qubit : this->main) {
         print_buf << qubit;
     }
     print_buf << "\n";
 
-    print_buf << "Parity: ";
-    for (const auto& qubit : this->parity) {
-        print_buf << qubit;
+    cout << print_buf.str() << "\n";
+}
+
+template <typename T> auto QStateVec<T>::save(const string& path) const -> expected<void, Error> {
+    PROFILE_SCOPE("save", 0, this->stored_bytes(), this->stored_bytes());
+    checkpoint::Header header{};
+    header.magic = checkpoint::MAGIC;
+    header.version = checkpoint::VERSION;
+    header.num_qubits = static_cast<uint32_t>(this->num_qubits);
+    header.precision = sizeof(T);
+    header.storage_mode = this->storage_mode;
+
+    if (!this->sparse_storage) {
+        header.layout = checkpoint::Layout::dense;
+        header.num_records = this->main.size();
+        return checkpoint::write(path, header, as_bytes(span(this->main)));
     }
-    print_buf << "\n";
 
-    cout << print_buf.str() << "\n";
+    vector<typename AmplitudeMap<T>::Entry> entries;
+    entries.reserve(this->sparse.size());
+    this->sparse.for_each([&](const uint64_t index, const complex<T>& amplitude) {
+        entries.push_back({index, amplitude});
+    });
+    header.layout = checkpoint::Layout::sparse;
+    header.num_records = entries.size();
+    return checkpoint::write(path, header, as_bytes(span(entries)));
 }
 
-QStateVec::QStateVec(const int num_qubits) {
+template <typename T>
+auto QStateVec<T>::load(const string& path, const int num_threads)
+    -> expected<QStateVec<T>, Error> {
+    const auto header = checkpoint::read_header(path);
+    if (!header) {
+        return unexpected(header.error());
+    }
+    if (header->precision != sizeof(T)) {
+        return unexpected(Error::invalid_input);
+    }
+
+    // Starts sparse, so nothing of the size of the state is allocated before it is replaced
+    const auto num_qubits = static_cast<int>(header->num_qubits);
+    QStateVec<T> state(num_qubits, num_threads, StorageMode::sparse);
+    state.storage_mode = header->storage_mode;
+
+    if (header->layout == checkpoint::Layout::sparse) {
+        vector<typename AmplitudeMap<T>::Entry> entries(header->num_records);
+        if (const auto read = checkpoint::read_payload(path, as_writable_bytes(span(entries)));
+            !read) {
+            return unexpected(read.error());
+        }
+        // Indices outside the state, the map's EMPTY key among them, or repeated, mean the file is
+        // corrupt
+        state.sparse = AmplitudeMap<T>(entries.size());
+        for (const auto& entry : entries) {
+            if ((entry.index >> num_qubits) != 0) {
+                return unexpected(Error::invalid_input);
+            }
+            state.sparse[entry.index] = entry.amplitude;
+        }
+        if (state.sparse.size() != entries.size()) {
+            return unexpected(Error::invalid_input);
+        }
+        return state;
+    }
+
+    // The allocator maps the amplitudes in place and leaves them unconstructed, so building the
+    // vector reads nothing
+    auto source = make_shared<const mapped_storage::FileRegion>(
+        mapped_storage::FileRegion{path, checkpoint::HEADER_SIZE});
+    state.sparse = {};
+    state.sparse_storage = false;
+    state.storage_mode = StorageMode::mapped;
+    try {
+        state.main = StateVector<T>(header->num_records, StateAllocator<complex<T>>(source));
+    } catch (const bad_alloc&) {
+        return unexpected(Error::io_failure);
+    }
+    return state;
+}
+
+template <typename T>
+QStateVec<T>::QStateVec(const int num_qubits, const int num_threads,
+                        const StorageMode storage_mode) {
+    // Basis states are indexed by 64 bit masks, and sparse storage reserves ~0 as its empty key
+    if (num_qubits < 0 || num_qubits > 63) {
+        throw invalid_argument("QStateVec: num_qubits must be in [0, 63]");
+    }
+
     this->num_qubits = num_qubits;
-    uint64_t state_vec_size = 2 * static_cast<uint64_t>(pow(2, num_qubits));
-
-    this->main = StateVector(state_vec_size, complex<PRECISION_TYPE>{0.0, 0.0});
-    this->main[0] = complex<PRECISION_TYPE>{1.0, 0.0};
-    this->parity = StateVector(state_vec_size, complex<PRECISION_TYPE>{0.0, 0.0});
-}
-
-// void QStateVec::calculateStateProbabilities() {
-//     for (size_t i = 0; i < this->states.size(); i += 2)
-//         this->states[i] = pow(abs(this->states[i]), 2);
-// }
-
-// void QStateVec::measureQubits(PRECISION_TYPE* results) {
-//     uint64_t localStartIndex;
-//     if (this->rank == 0)
-//         localStartIndex = 0;
-//     else
-//         localStartIndex = this->layerLimits[this->rank - 1];
-
-//     for (size_t i = 0; i < this->states.size(); i += 2) {
-//         if (this->states[i] == 0i) {
-//             localStartIndex += 1;
-//             continue;
-//         }
-//         for (unsigned int j = 0; j < this->numQubits; j++) {
-//             if (localStartIndex & MASK(j)) {
-//                 results[j] += this->states[i].real();
-//             }
-//         }
-//         localStartIndex += 1;
-//     }
-// }
-
-// bool QStateVec::checkStateOOB(const uint64_t state) {
-//     return state < this->globalLowerBound || state > this->globalUpperBound;
-// }
-
-// void QStateVec::toffoli(const int controlQubit1, const int controlQubit2,
-//                             const int targetQubit) {
-//     // Executes pauliX if both control qubits are set to |1>
-//     auto applyReceivedOpsPauliX = [&](const vector<complex<PRECISION_TYPE>>& receivedOps) {
-//         for (size_t i = 0; i < receivedOps.size(); i += 2) {
-//             this->states[2 * receivedOps[i].real() + 1] = receivedOps[i + 1];
-//         }
-//     };
-
-//     vector<tuple<uint64_t, complex<PRECISION_TYPE>>> statesOOB;
-
-//     uint64_t limit = LOCKSTEP_THRESHOLD;
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (i == limit) {
-//             manageDistr(statesOOB, applyReceivedOpsPauliX);
-
-//             statesOOB.clear();
-//             limit += LOCKSTEP_THRESHOLD;
-//         }
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             if (state & MASK(controlQubit1) && state & MASK(controlQubit2)) {
-//                 state = state ^ MASK(targetQubit);
-
-//                 // if a state is OOB, store tuple (state, intended_value) to a vector
-//                 if (!checkStateOOB(state)) {
-//                     size_t localIndex = getLocalIndexFromGlobalState(state, this->rank);
-//                     this->states[2 * localIndex + 1] = this->states[2 * i];
-//                 } else {
-//                     // pair (state, intended_value)
-//                     statesOOB.push_back({state, this->states[2 * i]});
-//                 }
-//             } else {
-//                 this->states[2 * i + 1].real(this->states[2 * i].real());
-//             }
-//         }
-//     }
-
-//     manageDistr(statesOOB, applyReceivedOpsPauliX);
-
-//     updateStates();
-// }
-
-// void QStateVec::controlledX(const int controlQubit, const int targetQubit) {
-//     // Executes pauliX if control qubit is |1>
-//     auto applyReceivedOpsPauliX = [&](const vector<complex<PRECISION_TYPE>>& receivedOps) {
-//         for (size_t i = 0; i < receivedOps.size(); i += 2) {
-//             this->states[2 * receivedOps[i].real() + 1] = receivedOps[i + 1];
-//         }
-//     };
-//     // vector of (stateOOB, value) pairs
-//     vector<tuple<uint64_t, complex<PRECISION_TYPE>>> statesOOB;
-
-//     uint64_t limit = LOCKSTEP_THRESHOLD;
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (i == limit) {
-//             manageDistr(statesOOB, applyReceivedOpsPauliX);
-
-//             statesOOB.clear();
-//             limit += LOCKSTEP_THRESHOLD;
-//         }
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             if (state & MASK(controlQubit)) {
-//                 state = state ^ MASK(targetQubit);
-
-//                 // if a state is OOB, store tuple (state, intended_value) to a vector
-//                 if (!checkStateOOB(state)) {
-//                     size_t localIndex = getLocalIndexFromGlobalState(state, this->rank);
-//                     this->states[2 * localIndex + 1] = this->states[2 * i];
-//                 } else {
-//                     // pair (state, intended_value)
-//                     statesOOB.push_back({state, this->states[2 * i]});
-//                 }
-//             } else {
-//                 this->states[2 * i + 1].real(this->states[2 * i].real());
-//             }
-//         }
-//     }
-
-//     manageDistr(statesOOB, applyReceivedOpsPauliX);
-//     updateStates();
-// }
-
-// void QStateVec::controlledZ(const int controlQubit, const int targetQubit) {
-//     // Executes pauliZ if control qubit is |1>
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             if (state & MASK(controlQubit)) {
-//                 state& MASK(targetQubit) ? this->states[2 * i + 1] = -this->states[2 * i]
-//                                          : this->states[2 * i + 1] = this->states[2 * i];
-//             } else {
-//                 this->states[2 * i + 1].real(this->states[2 * i].real());
-//             }
-//         }
-//     }
-//     updateStates();
-// }
-
-// void QStateVec::rotationX(const int targetQubit, const double angle) {
-//     // PRECISION_TYPE hadamard_const = 1 / sqrt(2);
-//     PRECISION_TYPE rotationX_const1 = cos(angle);
-//     complex<PRECISION_TYPE> rotationX_const2 = -1i * sin(angle);
-
-//     vector<tuple<uint64_t, complex<PRECISION_TYPE>>> statesOOB;
-
-//     auto applyReceivedOpsRotationX = [&](const vector<complex<PRECISION_TYPE>>& receivedOps) {
-//         for (size_t i = 0; i < receivedOps.size(); i += 2) {
-//             this->states[2 * receivedOps[i].real() + 1] += rotationX_const2 * receivedOps[i + 1];
-//         }
-//     };
-
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             (state & MASK(targetQubit))
-//                 ? this->states[2 * i + 1] -= rotationX_const1 * this->states[2 * i]
-//                 : this->states[2 * i + 1] += rotationX_const1 * this->states[2 * i];
-//         }
-//     }
-
-//     size_t limit = LOCKSTEP_THRESHOLD;
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (i == limit) {
-//             manageDistr(statesOOB, applyReceivedOpsRotationX);
-//             statesOOB.clear();
-//             limit += LOCKSTEP_THRESHOLD;
-//         }
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             state = state ^ MASK(targetQubit);
-
-//             if (!checkStateOOB(state)) {
-//                 size_t localIndex = getLocalIndexFromGlobalState(state, this->rank);
-//                 this->states[2 * localIndex + 1] += rotationX_const2 * this->states[2 * i];
-//             } else {
-//                 statesOOB.push_back({state, this->states[2 * i]});
-//             }
-//         }
-//     }
-
-//     manageDistr(statesOOB, applyReceivedOpsRotationX);
-
-//     updateStates();
-// }
-
-// void QStateVec::sqrtPauliX(const int targetQubit) {
-//     vector<tuple<uint64_t, complex<PRECISION_TYPE>>> statesOOB;
-
-//     static const PRECISION_TYPE halfConst = (PRECISION_TYPE)1 / (PRECISION_TYPE)2;
-//     static const complex<PRECISION_TYPE> localConst = {halfConst, halfConst};
-//     static const complex<PRECISION_TYPE> remoteConst = {halfConst, -halfConst};
-
-//     auto applyReceivedOpsSqrtPauliX = [&](const vector<complex<PRECISION_TYPE>>& receivedOps) {
-//         for (size_t i = 0; i < receivedOps.size(); i += 2) {
-//             this->states[2 * receivedOps[i].real() + 1] += remoteConst * receivedOps[i + 1];
-//         }
-//     };
-
-//     /**
-//      * TODO: experimentar meter esta operação num único loop
-//      */
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (checkZeroState(i)) {
-//             this->states[2 * i + 1] += localConst * this->states[2 * i];
-//         }
-//     }
-
-//     size_t limit = LOCKSTEP_THRESHOLD;
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (i == limit) {
-//             manageDistr(statesOOB, applyReceivedOpsSqrtPauliX);
-//             statesOOB.clear();
-//             limit += LOCKSTEP_THRESHOLD;
-//         }
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             state = state ^ MASK(targetQubit);
-
-//             if (!checkStateOOB(state)) {
-//                 size_t localIndex = getLocalIndexFromGlobalState(state, this->rank);
-//                 this->states[2 * localIndex + 1] += remoteConst * this->states[2 * i];
-//             } else {
-//                 statesOOB.push_back({state, this->states[2 * i]});
-//             }
-//         }
-//     }
-
-//     manageDistr(statesOOB, applyReceivedOpsSqrtPauliX);
-
-//     updateStates();
-// }
-
-// void QStateVec::sqrtPauliY(const int targetQubit) {
-//     vector<tuple<uint64_t, complex<PRECISION_TYPE>>> statesOOB;
-
-//     static const PRECISION_TYPE halfConst = (PRECISION_TYPE)1 / (PRECISION_TYPE)2;
-//     static const complex<PRECISION_TYPE> auxConst1 = {halfConst, halfConst};
-//     static const complex<PRECISION_TYPE> auxConst2 = {-halfConst, -halfConst};
-
-//     auto applyReceivedOpsSqrtPauliY = [&](const vector<complex<PRECISION_TYPE>>& receivedOps) {
-//         for (size_t i = 0; i < receivedOps.size(); i += 2) {
-//             uint64_t state = this->globalLowerBound + receivedOps[i].real();
-
-//             (state & MASK(targetQubit))
-//                 ? this->states[2 * receivedOps[i].real() + 1] += auxConst1 * receivedOps[i + 1]
-//                 : this->states[2 * receivedOps[i].real() + 1] += auxConst2 * receivedOps[i + 1];
-//         }
-//     };
-
-//     /**
-//      * TODO: experimentar meter esta operação num único loop
-//      */
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (checkZeroState(i)) {
-//             this->states[2 * i + 1] += auxConst1 * this->states[2 * i];
-//         }
-//     }
-
-//     size_t limit = LOCKSTEP_THRESHOLD;
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (i == limit) {
-//             manageDistr(statesOOB, applyReceivedOpsSqrtPauliY);
-//             statesOOB.clear();
-//             limit += LOCKSTEP_THRESHOLD;
-//         }
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             state = state ^ MASK(targetQubit);
-
-//             if (!checkStateOOB(state)) {
-//                 size_t localIndex = getLocalIndexFromGlobalState(state, this->rank);
-//                 (state & MASK(targetQubit))
-//                     ? this->states[2 * localIndex + 1] += auxConst1 * this->states[2 * i]
-//                     : this->states[2 * localIndex + 1] += auxConst2 * this->states[2 * i];
-//             } else {
-//                 statesOOB.push_back({state, this->states[2 * i]});
-//             }
-//         }
-//     }
-
-//     manageDistr(statesOOB, applyReceivedOpsSqrtPauliY);
-
-//     updateStates();
-// }
-
-// void QStateVec::sGate(const int targetQubit) {
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-
-//             state& MASK(targetQubit) ? this->states[2 * i + 1] = 1i * this->states[2 * i]
-//                                      : this->states[2 * i + 1] = this->states[2 * i];
-//         }
-//     }
-//     updateStates();
-// }
-
-// void QStateVec::tGate(const int targetQubit) {
-//     static const complex<PRECISION_TYPE> tConst =
-//         exp((1i * (PRECISION_TYPE)M_PI) / (PRECISION_TYPE)4);
-
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-
-//             state& MASK(targetQubit) ? this->states[2 * i + 1] = tConst * this->states[2 * i]
-//                                      : this->states[2 * i + 1] = this->states[2 * i];
-//         }
-//     }
-//     updateStates();
-// }
-
-// void QStateVec::hadamard(const int targetQubit) {
-//     // PRECISION_TYPE hadamard_const = 1 / sqrt(2);
-//     static const PRECISION_TYPE hadamard_const = 1 / sqrt(2);
-
-//     vector<tuple<uint64_t, complex<PRECISION_TYPE>>> statesOOB;
-
-//     auto applyReceivedOpsHadamard = [&](const vector<complex<PRECISION_TYPE>>& receivedOps) {
-//         for (size_t i = 0; i < receivedOps.size(); i += 2) {
-//             this->states[2 * receivedOps[i].real() + 1] += hadamard_const * receivedOps[i + 1];
-//         }
-//     };
-
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             (state & MASK(targetQubit))
-//                 ? this->states[2 * i + 1] -= hadamard_const * this->states[2 * i]
-//                 : this->states[2 * i + 1] += hadamard_const * this->states[2 * i];
-//         }
-//     }
-
-//     size_t limit = LOCKSTEP_THRESHOLD;
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (i == limit) {
-//             manageDistr(statesOOB, applyReceivedOpsHadamard);
-//             statesOOB.clear();
-//             limit += LOCKSTEP_THRESHOLD;
-//         }
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             state = state ^ MASK(targetQubit);
-
-//             if (!checkStateOOB(state)) {
-//                 size_t localIndex = getLocalIndexFromGlobalState(state, this->rank);
-//                 this->states[2 * localIndex + 1] += hadamard_const * this->states[2 * i];
-//             } else {
-//                 // #ifdef HADAMARD_DEBUG_LOGS
-//                 // 				dynamic_bitset state2 = state;
-//                 // 				appendDebugLog("Hadamard: State |",
-//                 // 							   state2.printBitset(),
-//                 // 							   "> ",
-//                 // 							   state,
-//                 // 							   " out of bounds!\n");
-//                 // #endif
-//                 // pair (state, intended_value)
-//                 statesOOB.push_back({state, this->states[2 * i]});
-//             }
-//         }
-//     }
-
-//     manageDistr(statesOOB, applyReceivedOpsHadamard);
-
-//     updateStates();
-// }
-
-// void QStateVec::pauliZ(const int targetQubit) {
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-
-//             state& MASK(targetQubit) ? this->states[2 * i + 1] = -this->states[2 * i]
-//                                      : this->states[2 * i + 1] = this->states[2 * i];
-//         }
-//     }
-//     updateStates();
-// }
-
-// void QStateVec::pauliY(const int targetQubit) {
-//     // vector of (stateOOB, value) pairs
-//     vector<tuple<uint64_t, complex<PRECISION_TYPE>>> statesOOB;
-
-//     auto applyReceivedOpsPauliY = [&](const vector<complex<PRECISION_TYPE>>& receivedOps) {
-//         for (size_t i = 0; i < receivedOps.size(); i += 2) {
-//             this->states[2 * receivedOps[i].real() + 1].real() == 0
-//                 ? this->states[2 * receivedOps[i].real() + 1] = receivedOps[i + 1] * 1i
-//                 : this->states[2 * receivedOps[i].real() + 1] = receivedOps[i + 1] * -1i;
-//         }
-//     };
-
-//     size_t limit = LOCKSTEP_THRESHOLD;
-//     for (size_t i = 0; i < this->states.size() / 2; i++) {
-//         if (i == limit) {
-//             manageDistr(statesOOB, applyReceivedOpsPauliY);
-
-//             statesOOB.clear();
-//             limit += LOCKSTEP_THRESHOLD;
-//         }
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             // if |0>, scalar 1i applies to |1>
-//             // if |1>, scalar -1i aclear();
-//             // probabily room for optimization here
-//             state = state ^ MASK(targetQubit);
-
-//             if (!checkStateOOB(state)) {
-//                 size_t localIndex = getLocalIndexFromGlobalState(state, this->rank);
-//                 state& MASK(targetQubit)
-//                     ? this->states[2 * localIndex + 1] = this->states[2 * i] * 1i
-//                     : this->states[2 * localIndex + 1] = this->states[2 * i] * -1i;
-//             } else {
-//                 // pair (state, intended_value)
-//                 statesOOB.push_back({state, this->states[2 * i]});
-//             }
-//         }
-//     }
-
-//     manageDistr(statesOOB, applyReceivedOpsPauliY);
-
-//     updateStates();
-// }
-
-// void QStateVec::pauliX(const int targetQubit) {
-//     // vector of (stateOOB, amplitude) pairs
-//     vector<tuple<uint64_t, complex<PRECISION_TYPE>>> statesOOB;
-//     // statesOOB.reserve(LOCKSTEP_THRESHOLD);
-
-//     auto applyReceivedOpsPauliX = [&](const vector<complex<PRECISION_TYPE>>& receivedOps) {
-//         for (size_t i = 0; i < receivedOps.size(); i += 2) {
-//             this->states[2 * receivedOps[i].real() + 1] = receivedOps[i + 1];
-//         }
-//     };
-
-//     size_t limit = LOCKSTEP_THRESHOLD;
-//     for (size_t i = 0; (i < this->states.size() / 2); i++) {
-//         if (i == limit) {
-//             manageDistr(statesOOB, applyReceivedOpsPauliX);
-//             statesOOB.clear();
-//             limit += LOCKSTEP_THRESHOLD;
-//         }
-//         if (checkZeroState(i)) {
-//             uint64_t state = this->globalLowerBound + i;
-//             state = state ^ MASK(targetQubit);
-
-//             // if a state is OOB, store tuple (state, intended_value) to a vector
-//             if (!checkStateOOB(state)) {
-//                 size_t localIndex = getLocalIndexFromGlobalState(state, this->rank);
-//                 this->states[2 * localIndex + 1] = this->states[2 * i];
-//             } else {
-//                 // pair (state, amplitude) ATENCAO
-//                 statesOOB.push_back({state, this->states[2 * i]});
-//             }
-//         }
-//     }
-
-//     manageDistr(statesOOB, applyReceivedOpsPauliX);
-
-//     updateStates();
-// }
-
-// bool QStateVec::checkZeroState(const size_t i) {
-//     return this->states[i * 2] != 0i;
-// }
-
-// void QStateVec::updateStates() {
-//     for (size_t i = 0; i < this->states.size(); i += 2) {
-//         this->states[i] = this->states[i + 1];
-//         this->states[i + 1] = 0i;
-//     }
-// }
+    this->num_threads = kernels::resolve_num_threads(num_qubits, num_threads);
+    this->storage_mode = storage_mode;
+    this->sparse_storage =
+        storage_mode == StorageMode::sparse || storage_mode == StorageMode::automatic;
+
+    if (this->sparse_storage) {
+        this->sparse[0] = complex<T>{1.0, 0.0};
+        return;
+    }
+
+    uint64_t state_vec_size = MASK(num_qubits);
+    // Allocations start out zero; pages of a mapped file are left for the kernels to fault in,
+    // memory pages are first touched by the threads that will update them
+    const StateAllocator<complex<T>> allocator(storage_mode == StorageMode::mapped);
+    this->main = StateVector<T>(state_vec_size, allocator);
+    if (storage_mode != StorageMode::mapped) {
+        kernels::first_touch<T>(this->main, this->num_threads);
+    }
+    this->main[0] = complex<T>{1.0, 0.0};
+}
+
+template class QStateVec<float>;
+template class QStateVec<double>;
@@ -1,22 +1,104 @@
 #ifndef QSTATEVEC_HPP
 #define QSTATEVEC_HPP
 
+#include "amplitude_map.hpp"
+#include "state_allocator.hpp"
+#include <array>
 #include <complex>
 #include <cstdint>
 #include <expected>
 #include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-#define PRECISION_TYPE double
+/**
+ * Amplitudes of a state vector, indexed by basis state. T is float or double.
+ * Heap allocated unless built with a mapped StateAllocator.
+ */
+template <typename T = double>
+using StateVector = std::vector<std::complex<T>, StateAllocator<std::complex<T>>>;
 
-using StateVector = std::vector<std::complex<PRECISION_TYPE>>;
+/**
+ * Row-major 2x2 single qubit unitary {m00, m01, m10, m11}.
+ * Gate matrices are always built in double precision and rounded once per gate call.
+ */
+using Matrix2 = std::array<std::complex<double>, 4>;
 
-enum class Error : std::uint8_t { invalid_input };
+/**
+ * Row-major 2^k x 2^k unitary acting on k qubits.
+ */
+using MatrixN = std::vector<std::complex<double>>;
+
+/**
+ * Diagonal single qubit gate diag(phases[0], phases[1]) on target_qubit, applied on the basis
+ * states where every control qubit (qubit q is bit q - 1 of controls_mask) is |1>.
+ */
+struct DiagonalGate {
+    uint64_t controls_mask;
+    int target_qubit;
+    std::array<std::complex<double>, 2> phases;
+};
+
+/**
+ * Pauli string coefficient * P, with X on the qubits of x_mask only, Z on those of z_mask only
+ * and Y on those in both (qubit q is bit q - 1).
+ */
+struct PauliTerm {
+    uint64_t x_mask;
+    uint64_t z_mask;
+    double coefficient;
+};
+
+enum class Error : std::uint8_t { invalid_input, io_failure };
+
+/**
+ * @brief Builds a PauliTerm from a string over I, X, Y and Z, character k acting on qubit k + 1,
+ *  e.g. "XIZ" is X on qubit 1 and Z on qubit 3.
+ */
+inline auto pauli_term(const std::string_view paulis, const double coefficient = 1.0)
+    -> std::expected<PauliTerm, Error> {
+    if (paulis.size() > 64) {
+        return std::unexpected(Error::invalid_input);
+    }
+    PauliTerm term{0, 0, coefficient};
+    for (size_t k = 0; k < paulis.size(); k++) {
+        const uint64_t bit = 0x1ull << k;
+        switch (paulis[k]) {
+        case 'I':
+            break;
+        case 'X':
+            term.x_mask |= bit;
+            break;
+        case 'Y':
+            term.x_mask |= bit;
+            term.z_mask |= bit;
+            break;
+        case 'Z':
+            term.z_mask |= bit;
+            break;
+        default:
+            return std::unexpected(Error::invalid_input);
+        }
+    }
+    return term;
+}
+
+/**
+ * How QStateVec stores its amplitudes: all 2^n of them, only the non-zero ones in a hash map,
+ * or sparse while the fill ratio is low and dense once it is not. Mapped storage is dense in a
+ * memory-mapped file, for states larger than RAM.
+ */
+enum class StorageMode : std::uint8_t { dense, sparse, automatic, mapped };
 
 inline std::string to_string(Error err) {
     switch (err) {
     case Error::invalid_input:
         return "Invalid Input";
+    case Error::io_failure:
+        return "IO Failure";
     }
     return "Unknown Error";
 }
@@ -25,36 +107,194 @@ inline std::ostream& operator<<(std::ostream& ostr, Error err) {
     return ostr << to_string(err);
 }
 
-class QStateVec {
+/**
+ * State vector simulator. Both QStateVec<float> and QStateVec<double> are built into my_lib.
+ */
+template <typename T = double> class QStateVec {
   private:
-    StateVector main;
-    StateVector parity;
+    StateVector<T> main;
+    AmplitudeMap<T> sparse;
+    // Dense copy of sparse amplitudes handed out by get_state, released by the next gate
+    mutable StateVector<T> dense_view;
     int num_qubits;
+    int num_threads;
+    StorageMode storage_mode;
+    bool sparse_storage;
 
-    /**
-     * @brief Moves the values in parity vector to the main vector.
-     *  Resets the parity layer to zero.
-     */
-    void reset_parity_layer();
+    void update_storage();
+
+    // The sparse amplitudes, for a kernel about to change them
+    AmplitudeMap<T>& update_sparse();
+
+    // Bytes held by whichever storage is in use, for the profiler
+    [[nodiscard]] uint64_t stored_bytes() const;
+
+    // Blocked execution works on the amplitudes directly
+    friend class Circuit;
+
+    auto collapse(int target_qubit, std::mt19937_64& rng, bool reset)
+        -> std::expected<int, Error>;
 
   public:
     /**
      * @brief Construct a qubit layer object.
      *
      * @param numQubits
+     * @param num_threads Threads used by every state vector kernel. When 0, the QSIM_NUM_THREADS
+     *  environment variable is used if set, else the OpenMP default. States smaller than
+     *  kernels::PARALLEL_QUBIT_THRESHOLD qubits always run serially.
+     * @param storage_mode Sparse and automatic storage start sparse, so they can hold states far
+     *  larger than memory as long as few amplitudes are non-zero (at most 63 qubits). Automatic
+     *  storage moves to dense above sparse::DENSE_FILL_RATIO and back after a measurement
+     *  leaves less than sparse::SPARSE_FILL_RATIO. Mapped storage keeps the dense amplitudes in
+     *  an unlinked file under QSIM_MAPPED_DIR (default: the temporary directory); run it with
+     *  Circuit::run_blocked so every chunk of the file is streamed in once per pass.
+     *  Throws std::invalid_argument when num_qubits is outside [0, 63].
      */
-    QStateVec(int num_qubits);
+    QStateVec(int num_qubits, int num_threads = 0, StorageMode storage_mode = StorageMode::dense);
 
     /**
-     * @brief Pretty prints the main and parity state vectors.
+     * @brief Pretty prints the state vector.
      *  Adequate to display small size state vectors.
      */
     void pretty_print() const;
 
+    /**
+     * @brief Saves the state to a binary checkpoint file (see checkpoint.hpp), replacing path
+     *  atomically.
+     */
+    auto save(const std::string& path) const -> std::expected<void, Error>;
+
+    /**
+     * @brief Restores a state saved with save. Dense checkpoints are mapped copy-on-write
+     *  without reading them, so they load in the time of an mmap call and come back with
+     *  StorageMode::mapped; sparse ones are read into memory. Fails with Error::invalid_input
+     *  when the file is not a checkpoint of this precision.
+     */
+    static auto load(const std::string& path, int num_threads = 0)
+        -> std::expected<QStateVec<T>, Error>;
+
+    /**
+     * @brief Returns the state to |0...0> in place. Dense amplitudes keep their allocation, so a
+     *  state can be reused for many runs; automatic storage goes back to sparse.
+     */
+    void set_zero_state();
+
+    /**
+     * @brief Returns the number of qubits of the state vector.
+     */
+    [[nodiscard]] int get_num_qubits() const;
+
+    /**
+     * @brief Returns the number of threads used by the state vector kernels.
+     */
+    [[nodiscard]] int get_num_threads() const;
+
+    /**
+     * @brief Returns the amplitudes of the state vector, indexed by basis state.
+     *  While the storage is sparse, see is_sparse, the amplitudes are expanded into a dense
+     *  copy of all 2^num_qubits amplitudes on every call, valid until the next call or gate;
+     *  prefer get_amplitude there. The copy is a member, so concurrent calls on a sparse state
+     *  are not thread-safe, even though the method is const.
+     */
+    [[nodiscard]] const StateVector<T>& get_state() const;
+
+    /**
+     * @brief Returns the amplitude of one basis state, with either storage.
+     */
+    [[nodiscard]] std::complex<T> get_amplitude(uint64_t index) const;
+
+    /**
+     * @brief Whether the amplitudes are currently stored sparse.
+     */
+    [[nodiscard]] bool is_sparse() const;
+
+    /**
+     * @brief Returns the storage mode the state vector was constructed with.
+     */
+    [[nodiscard]] StorageMode get_storage_mode() const;
+
+    /**
+     * @brief Returns the number of stored amplitudes: the non-zero ones when sparse, 2^n else.
+     */
+    [[nodiscard]] uint64_t get_num_stored() const;
+
     /**
      * @brief Returns the result of the measured collapsed qubits
      */
-    [[nodiscard]] std::vector<PRECISION_TYPE> get_measured_qubits() const;
+    [[nodiscard]] std::vector<T> get_measured_qubits() const;
+
+    /**
+     * @brief Returns the joint distribution of the given qubits, without collapsing the state.
+     *  Entry m is the probability that qubits[k] reads bit k of m, for every k, so the result
+     *  holds 2^qubits.size() entries.
+     *
+     * @param qubits Distinct qubits, in the order of the bits of the result index
+     */
+    [[nodiscard]] auto get_probabilities(const std::vector<int>& qubits) const
+        -> std::expected<std::vector<T>, Error>;
+
+    /**
+     * @brief Measures every qubit shots times, without collapsing the state.
+     *  The distribution is built once per call, so this costs one pass over the state vector
+     *  plus O(shots), and the result is reproducible for a given seed.
+     *
+     * @param shots
+     * @param seed
+     * @return (bitstring, count) pairs sorted by bitstring, only for bitstrings that were drawn.
+     *  Qubit q is bit q - 1 of the bitstring.
+     */
+    [[nodiscard]] std::vector<std::pair<uint64_t, uint64_t>> sample(uint64_t shots,
+                                                                    uint64_t seed) const;
+
+    /**
+     * @brief Returns <psi|P|psi> for the Pauli string P of every term, coefficients aside,
+     *  without modifying or copying the state. Terms sharing an x_mask are evaluated together in
+     *  one pass over the state vector, so a Hamiltonian costs one pass per distinct X/Y pattern.
+     */
+    [[nodiscard]] auto expectation_values(const std::vector<PauliTerm>& terms) const
+        -> std::expected<std::vector<double>, Error>;
+
+    /**
+     * @brief Returns the sum of coefficient * <psi|P|psi> over the terms, e.g. the energy of a
+     *  Hamiltonian given as a sum of Pauli strings.
+     */
+    [[nodiscard]] auto expectation(const std::vector<PauliTerm>& terms) const
+        -> std::expected<double, Error>;
+
+    /**
+     * @brief Measures the target qubit, collapsing the state onto the outcome and renormalizing
+     *  it. One pass computes the outcome probabilities, a second one zeroes the rejected half and
+     *  scales the kept one.
+     *
+     * @param target_qubit
+     * @param rng Source of the random outcome
+     * @return The outcome, 0 or 1
+     */
+    auto measure(int target_qubit, std::mt19937_64& rng) -> std::expected<int, Error>;
+
+    /**
+     * @brief Resets the target qubit to |0>: measures it and, on outcome 1, moves the kept half
+     *  onto |0> in the same pass that collapses it.
+     *
+     * @param target_qubit
+     * @param rng Source of the random measurement outcome
+     * @return The measured outcome, before the reset
+     */
+    auto reset(int target_qubit, std::mt19937_64& rng) -> std::expected<int, Error>;
+
+    /**
+     * @brief Applies one random Kraus operator of the amplitude damping channel with decay
+     *  probability gamma, as in a quantum trajectory: the decay K1 = sqrt(gamma) |0><1| with
+     *  probability gamma * P(1), else K0 = |0><0| + sqrt(1 - gamma) |1><1|, renormalized.
+     *
+     * @param target_qubit
+     * @param gamma Decay probability of |1>, in [0, 1]
+     * @param rng Source of the random jump
+     * @return 1 when the qubit decayed, else 0
+     */
+    auto amplitude_damping(int target_qubit, double gamma, std::mt19937_64& rng)
+        -> std::expected<int, Error>;
 
     /**
      * @brief Executes the Pauli X operation
@@ -66,34 +306,125 @@ class QStateVec {
      */
     auto pauli_y(int target_qubit) -> std::expected<void, Error>;
 
-    // uint64_t& getGlobalStartIndex() { return this->globalLowerBound; }
+    /**
+     * @brief Applies an arbitrary single qubit unitary to the target qubit in a single pass.
+     *  Every other single qubit gate below is a thin wrapper around this one. Diagonal matrices
+     *  are routed to apply_diagonal.
+     *
+     * @param target_qubit
+     * @param matrix Row-major {m00, m01, m10, m11}
+     */
+    auto apply_1q(int target_qubit, const Matrix2& matrix) -> std::expected<void, Error>;
+
+    /**
+     * @brief Applies a dense unitary to a small set of qubits in a single pass.
+     *
+     * @param target_qubits Distinct qubits, target_qubits[0] is the least significant bit of the
+     *  matrix row/column index. At most kernels::MAX_BLOCK_QUBITS qubits.
+     * @param matrix Row-major 2^k x 2^k matrix
+     */
+    auto apply_nq(const std::vector<int>& target_qubits, const MatrixN& matrix)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the Pauli Z operation
+     */
+    auto pauli_z(int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the Hadamard operation
+     */
+    auto hadamard(int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the square root of Pauli X operation
+     */
+    auto sqrt_pauli_x(int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the square root of Pauli Y operation
+     */
+    auto sqrt_pauli_y(int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the S (phase) operation
+     */
+    auto s_gate(int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the T (pi/8) operation
+     */
+    auto t_gate(int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the RX(angle) = exp(-i * angle * X / 2) rotation
+     */
+    auto rotation_x(int target_qubit, double angle) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the RY(angle) = exp(-i * angle * Y / 2) rotation
+     */
+    auto rotation_y(int target_qubit, double angle) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the RZ(angle) = exp(-i * angle * Z / 2) rotation
+     */
+    auto rotation_z(int target_qubit, double angle) -> std::expected<void, Error>;
 
-    // void pauliY(const int targetQubit);
-    // void pauliZ(const int targetQubit);
-    // void hadamard(const int targetQubit);
-    // void controlledZ(const int controlQubit, const int targetQubit);
-    // void controlledX(const int controlQubit, const int targetQubit);
-    // void toffoli(const int controlQubit1, const int controlQubit2, const int targetQubit);
-    // void rotationX(const int targetQubit, const double angle);
-    // void sqrtPauliX(const int targetQubit);
-    // void sqrtPauliY(const int targetQubit);
-    // void sGate(const int targetQubit);
-    // void tGate(const int targetQubit);
+    /**
+     * @brief Executes the generic U3(theta, phi, lambda) rotation
+     */
+    auto u3(int target_qubit, double theta, double phi, double lambda)
+        -> std::expected<void, Error>;
 
     /**
-     * @brief copies values from output state to input state;
-     * sets output states to 0i
+     * @brief Applies a single qubit unitary to the target qubit on the basis states where every
+     *  control qubit is |1>. Only the 2^(n-k) amplitudes of that subspace are touched.
+     *
+     * @param controls_mask Control qubits, qubit q is bit (q - 1). May be 0.
+     * @param target_qubit Must not be one of the controls
+     * @param matrix Row-major {m00, m01, m10, m11}
      */
-    // void updateStates();
+    auto controlled(uint64_t controls_mask, int target_qubit, const Matrix2& matrix)
+        -> std::expected<void, Error>;
 
     /**
-     * @brief Measures qubit probabilities of state vector segment.
-     * Must receive an array from which the return values are placed.
-     * C-style array is used because MPI.
+     * @brief Multiplies each amplitude by the phase selected by its target bit, in place and
+     *  without exchanging amplitudes.
      *
-     * @param result
+     * @param diagonal {d0, d1}, the diagonal of the 2x2 matrix
+     */
+    auto apply_diagonal(int target_qubit, const std::array<std::complex<double>, 2>& diagonal)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Applies a run of diagonal gates, on any qubits, in a single sweep.
+     *  Diagonal gates commute, so their phases are multiplied per basis state from small lookup
+     *  tables instead of running one pass per gate.
+     */
+    auto apply_diagonals(const std::vector<DiagonalGate>& gates) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the CNOT operation
+     */
+    auto controlled_x(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the controlled Pauli Z operation
+     */
+    auto controlled_z(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the controlled phase operation diag(1, 1, 1, exp(i * angle))
+     */
+    auto controlled_phase(int control_qubit, int target_qubit, double angle)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the Toffoli (CCNOT) operation
      */
-    // void measureQubits(PRECISION_TYPE* result);
+    auto toffoli(int control_qubit1, int control_qubit2, int target_qubit)
+        -> std::expected<void, Error>;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "qstate_vec_batch.hpp"
+#include "gates.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#define MASK(N) (0x1ull << (N))
+
+using namespace std;
+
+namespace {
+
+/**
+ * One gate matrix per batch element in split form: entry k of element b is
+ * real[k][b] + i * imag[k][b], so the coefficients load into SIMD lanes like the amplitudes.
+ */
+template <typename T> struct BatchMatrix {
+    array<AlignedBuffer<T>, 4> real;
+    array<AlignedBuffer<T>, 4> imag;
+
+    explicit BatchMatrix(const vector<Matrix2>& matrices) {
+        for (size_t k = 0; k < 4; k++) {
+            this->real[k].resize(matrices.size());
+            this->imag[k].resize(matrices.size());
+            for (size_t b = 0; b < matrices.size(); b++) {
+                this->real[k][b] = static_cast<T>(matrices[b][k].real());
+                this->imag[k][b] = static_cast<T>(matrices[b][k].imag());
+            }
+        }
+    }
+};
+
+/**
+ * @brief Applies element b's matrix to the amplitude pair (real0[b], real1[b]) of every element.
+ */
+template <typename T>
+void apply_to_pair(T* real0, T* imag0, T* real1, T* imag1, const BatchMatrix<T>& matrix,
+                   const uint64_t batch_size) {
+    const T* m00r = matrix.real[0].data();
+    const T* m00i = matrix.imag[0].data();
+    const T* m01r = matrix.real[1].data();
+    const T* m01i = matrix.imag[1].data();
+    const T* m10r = matrix.real[2].data();
+    const T* m10i = matrix.imag[2].data();
+    const T* m11r = matrix.real[3].data();
+    const T* m11i = matrix.imag[3].data();
+#pragma omp simd
+    for (uint64_t b = 0; b < batch_size; b++) {
+        const T a0r = real0[b];
+        const T a0i = imag0[b];
+        const T a1r = real1[b];
+        const T a1i = imag1[b];
+        real0[b] = m00r[b] * a0r - m00i[b] * a0i + m01r[b] * a1r - m01i[b] * a1i;
+        imag0[b] = m00r[b] * a0i + m00i[b] * a0r + m01r[b] * a1i + m01i[b] * a1r;
+        real1[b] = m10r[b] * a0r - m10i[b] * a0i + m11r[b] * a1r - m11i[b] * a1i;
+        imag1[b] = m10r[b] * a0i + m10i[b] * a0r + m11r[b] * a1i + m11i[b] * a1r;
+    }
+}
+
+template <typename Gate> vector<Matrix2> per_element(const vector<double>& angles, Gate gate) {
+    vector<Matrix2> matrices(angles.size());
+    ranges::transform(angles, matrices.begin(), gate);
+    return matrices;
+}
+
+} // namespace
+
+template <typename T>
+QStateVecBatch<T>::QStateVecBatch(const int num_qubits, const int batch_size,
+                                  const int num_threads) {
+    if (num_qubits < 0 || num_qubits > 63 || batch_size < 1) {
+        throw invalid_argument("QStateVecBatch: num_qubits must be in [0, 63], batch_size >= 1");
+    }
+
+    this->num_qubits = num_qubits;
+    this->batch_size = batch_size;
+    // The threshold is about the bytes touched per gate, so it counts the whole batch
+    const int batch_bits = bit_width(static_cast<uint64_t>(batch_size) - 1);
+    this->num_threads = kernels::resolve_num_threads(num_qubits + batch_bits, num_threads);
+
+    const uint64_t size = MASK(num_qubits) * batch_size;
+    this->real = AlignedBuffer<T>(size, 0.0);
+    this->imag = AlignedBuffer<T>(size, 0.0);
+    fill_n(this->real.begin(), batch_size, 1.0);
+}
+
+template <typename T> int QStateVecBatch<T>::get_num_qubits() const {
+    return this->num_qubits;
+}
+
+template <typename T> int QStateVecBatch<T>::get_batch_size() const {
+    return this->batch_size;
+}
+
+template <typename T> int QStateVecBatch<T>::get_num_threads() const {
+    return this->num_threads;
+}
+
+template <typename T>
+auto QStateVecBatch<T>::get_state(const int element) const -> expected<StateVector<T>, Error> {
+    if (element < 0 || element >= this->batch_size) {
+        return unexpected(Error::invalid_input);
+    }
+
+    StateVector<T> amps(MASK(this->num_qubits));
+    for (size_t i = 0; i < amps.size(); i++) {
+        const uint64_t index = i * this->batch_size + element;
+        amps[i] = {this->real[index], this->imag[index]};
+    }
+    return amps;
+}
+
+template <typename T>
+auto QStateVecBatch<T>::get_measured_qubits(const int element) const
+    -> expected<vector<T>, Error> {
+    if (element < 0 || element >= this->batch_size) {
+        return unexpected(Error::invalid_input);
+    }
+
+    const T* real = this->real.data() + element;
+    const T* imag = this->imag.data() + element;
+    const auto stride = static_cast<uint64_t>(this->batch_size);
+    return kernels::marginal_probabilities<T>(
+        MASK(this->num_qubits), this->num_qubits, this->num_threads,
+        [real, imag, stride](const uint64_t i) {
+            return real[i * stride] * real[i * stride] + imag[i * stride] * imag[i * stride];
+        });
+}
+
+template <typename T>
+auto QStateVecBatch<T>::apply(const uint64_t controls_mask, const int target_qubit,
+                              const vector<Matrix2>& matrices) -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0 ||
+        (controls_mask >> this->num_qubits) != 0 ||
+        (controls_mask & MASK(target_qubit - 1)) != 0 ||
+        matrices.size() != static_cast<size_t>(this->batch_size)) {
+        return unexpected(Error::invalid_input);
+    }
+
+    const BatchMatrix<T> batch_matrix(matrices);
+    const auto stride = static_cast<uint64_t>(this->batch_size);
+    T* real = this->real.data();
+    T* imag = this->imag.data();
+    kernels::for_each_controlled_pair(
+        MASK(this->num_qubits), controls_mask, target_qubit - 1, this->num_threads,
+        [&](const uint64_t i0, const uint64_t i1) {
+            apply_to_pair<T>(real + i0 * stride, imag + i0 * stride, real + i1 * stride,
+                             imag + i1 * stride, batch_matrix, stride);
+        });
+    return {};
+}
+
+template <typename T>
+auto QStateVecBatch<T>::apply_1q(const int target_qubit, const Matrix2& matrix)
+    -> expected<void, Error> {
+    return this->apply(0, target_qubit, vector<Matrix2>(this->batch_size, matrix));
+}
+
+template <typename T>
+auto QStateVecBatch<T>::apply_1q(const int target_qubit, const vector<Matrix2>& matrices)
+    -> expected<void, Error> {
+    return this->apply(0, target_qubit, matrices);
+}
+
+template <typename T>
+auto QStateVecBatch<T>::controlled(const uint64_t controls_mask, const int target_qubit,
+                                   const Matrix2& matrix) -> expected<void, Error> {
+    return this->apply(controls_mask, target_qubit, vector<Matrix2>(this->batch_size, matrix));
+}
+
+template <typename T>
+auto QStateVecBatch<T>::controlled(const uint64_t controls_mask, const int target_qubit,
+                                   const vector<Matrix2>& matrices) -> expected<void, Error> {
+    return this->apply(controls_mask, target_qubit, matrices);
+}
+
+template <typename T>
+auto QStateVecBatch<T>::pauli_x(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::pauli_x());
+}
+
+template <typename T>
+auto QStateVecBatch<T>::pauli_y(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::pauli_y());
+}
+
+template <typename T>
+auto QStateVecBatch<T>::pauli_z(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::pauli_z());
+}
+
+template <typename T>
+auto QStateVecBatch<T>::hadamard(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::hadamard());
+}
+
+template <typename T>
+auto QStateVecBatch<T>::rotation_x(const int target_qubit, const vector<double>& angles)
+    -> expected<void, Error> {
+    return this->apply_1q(target_qubit, per_element(angles, gates::rotation_x));
+}
+
+template <typename T>
+auto QStateVecBatch<T>::rotation_y(const int target_qubit, const vector<double>& angles)
+    -> expected<void, Error> {
+    return this->apply_1q(target_qubit, per_element(angles, gates::rotation_y));
+}
+
+template <typename T>
+auto QStateVecBatch<T>::rotation_z(const int target_qubit, const vector<double>& angles)
+    -> expected<void, Error> {
+    return this->apply_1q(target_qubit, per_element(angles, gates::rotation_z));
+}
+
+template <typename T>
+auto QStateVecBatch<T>::controlled_x(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit - 1), target_qubit, gates::pauli_x());
+}
+
+template <typename T>
+auto QStateVecBatch<T>::controlled_z(const int control_qubit, const int target_qubit)
+    -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit - 1), target_qubit, gates::pauli_z());
+}
+
+template <typename T>
+auto QStateVecBatch<T>::controlled_phase(const int control_qubit, const int target_qubit,
+                                         const vector<double>& angles) -> expected<void, Error> {
+    if (control_qubit > this->num_qubits || control_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+    return this->controlled(MASK(control_qubit - 1), target_qubit,
+                            per_element(angles, [](const double angle) -> Matrix2 {
+                                return {complex<double>{1.0, 0.0}, 0.0, 0.0, polar(1.0, angle)};
+                            }));
+}
+
+template class QStateVecBatch<float>;
+template class QStateVecBatch<double>;
@@ -0,0 +1,126 @@
+#ifndef QSTATEVEC_BATCH_HPP
+#define QSTATEVEC_BATCH_HPP
+
+#include "aligned_allocator.hpp"
+#include "qstate_vec.hpp"
+#include <cstdint>
+#include <expected>
+#include <vector>
+
+/**
+ * batch_size independent state vectors of the same qubit count, evolved together. Amplitude i of
+ * element b is stored at i * batch_size + b, with the real and imaginary parts in separate 64-byte
+ * aligned arrays, so a gate makes one pass over the batch and the innermost loop runs across the
+ * elements in SIMD lanes. Each gate takes either one matrix for the whole batch or one per
+ * element, e.g. the rotation angles of a parameter sweep.
+ *
+ * Batch elements are indexed from 0, qubits from 1 as in QStateVec.
+ */
+template <typename T = double> class QStateVecBatch {
+  private:
+    AlignedBuffer<T> real;
+    AlignedBuffer<T> imag;
+    int num_qubits;
+    int batch_size;
+    int num_threads;
+
+    auto apply(uint64_t controls_mask, int target_qubit, const std::vector<Matrix2>& matrices)
+        -> std::expected<void, Error>;
+
+  public:
+    /**
+     * @brief Construct batch_size state vectors, each initialized to |0...0>.
+     *
+     * @param num_qubits
+     * @param batch_size At least 1
+     * @param num_threads Same meaning as in QStateVec, with the threshold applied to the size of
+     *  the whole batch
+     *
+     * Throws std::invalid_argument when batch_size is below 1 or num_qubits outside [0, 63].
+     */
+    QStateVecBatch(int num_qubits, int batch_size, int num_threads = 0);
+
+    [[nodiscard]] int get_num_qubits() const;
+    [[nodiscard]] int get_batch_size() const;
+    [[nodiscard]] int get_num_threads() const;
+
+    /**
+     * @brief Returns a copy of the amplitudes of one element, in the layout used by QStateVec.
+     */
+    [[nodiscard]] auto get_state(int element) const -> std::expected<StateVector<T>, Error>;
+
+    /**
+     * @brief Returns the probability of measuring |1> on every qubit of one element.
+     */
+    [[nodiscard]] auto get_measured_qubits(int element) const
+        -> std::expected<std::vector<T>, Error>;
+
+    /**
+     * @brief Applies the same single qubit unitary to the target qubit of every element.
+     *
+     * @param matrix Row-major {m00, m01, m10, m11}
+     */
+    auto apply_1q(int target_qubit, const Matrix2& matrix) -> std::expected<void, Error>;
+
+    /**
+     * @brief Applies matrices[b] to the target qubit of element b.
+     *
+     * @param matrices One row-major matrix per element
+     */
+    auto apply_1q(int target_qubit, const std::vector<Matrix2>& matrices)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Applies the matrix to the target qubit of the basis states where every control
+     *  qubit (qubit q is bit q - 1 of controls_mask) is |1>, on every element.
+     */
+    auto controlled(uint64_t controls_mask, int target_qubit, const Matrix2& matrix)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Controlled form of apply_1q with one matrix per element.
+     */
+    auto controlled(uint64_t controls_mask, int target_qubit,
+                    const std::vector<Matrix2>& matrices) -> std::expected<void, Error>;
+
+    auto pauli_x(int target_qubit) -> std::expected<void, Error>;
+    auto pauli_y(int target_qubit) -> std::expected<void, Error>;
+    auto pauli_z(int target_qubit) -> std::expected<void, Error>;
+    auto hadamard(int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Rotates element b about the X axis by angles[b].
+     */
+    auto rotation_x(int target_qubit, const std::vector<double>& angles)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Rotates element b about the Y axis by angles[b].
+     */
+    auto rotation_y(int target_qubit, const std::vector<double>& angles)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Rotates element b about the Z axis by angles[b].
+     */
+    auto rotation_z(int target_qubit, const std::vector<double>& angles)
+        -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the CNOT operation on every element
+     */
+    auto controlled_x(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes the controlled Pauli Z operation on every element
+     */
+    auto controlled_z(int control_qubit, int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Executes diag(1, 1, 1, exp(i * angles[b])) on element b.
+     */
+    auto controlled_phase(int control_qubit, int target_qubit, const std::vector<double>& angles)
+        -> std::expected<void, Error>;
+};
+
+#endif
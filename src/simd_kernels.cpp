@@ -0,0 +1,667 @@
+#include "simd_kernels.hpp"
+#include "kernels.hpp"
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86
+#endif
+
+#define MASK(N) (0x1ull << (N))
+
+using namespace std;
+
+namespace {
+
+template <typename T>
+void apply_1q_scalar(T* real, T* imag, const uint64_t size, const int target,
+                     const Matrix2& matrix, const int num_threads) {
+    const auto cast = kernels::cast_matrix<T>(matrix);
+    kernels::for_each_pair(size, target, num_threads, [&](const uint64_t i0, const uint64_t i1) {
+        const complex<T> amp0 = {real[i0], imag[i0]};
+        const complex<T> amp1 = {real[i1], imag[i1]};
+        const auto out0 = kernels::mul_add(cast[0], amp0, cast[1], amp1);
+        const auto out1 = kernels::mul_add(cast[2], amp0, cast[3], amp1);
+        real[i0] = out0.real();
+        imag[i0] = out0.imag();
+        real[i1] = out1.real();
+        imag[i1] = out1.imag();
+    });
+}
+
+/**
+ * @brief Per-lane coefficients {self real, self imag, partner real, partner imag} for pairs that
+ *  sit inside one register: lanes with the target bit unset take m00 for themselves and m01 for
+ *  their partner, lanes with it set take m11 and m10.
+ */
+template <typename T, uint64_t Lanes>
+array<array<T, Lanes>, 4> in_register_coefficients(const Matrix2& matrix, const uint64_t stride) {
+    array<array<T, Lanes>, 4> coefficients{};
+    for (uint64_t lane = 0; lane < Lanes; lane++) {
+        const bool target_set = (lane & stride) != 0;
+        const auto self = target_set ? matrix[3] : matrix[0];
+        const auto partner = target_set ? matrix[2] : matrix[1];
+        coefficients[0][lane] = static_cast<T>(self.real());
+        coefficients[1][lane] = static_cast<T>(self.imag());
+        coefficients[2][lane] = static_cast<T>(partner.real());
+        coefficients[3][lane] = static_cast<T>(partner.imag());
+    }
+    return coefficients;
+}
+
+#ifdef SIMD_X86
+
+/**
+ * @brief Returns c * x + d * y on split complex registers.
+ */
+__attribute__((target("sse2"))) inline void cmul_add_sse2_pd(
+    const __m128d c_r, const __m128d c_i, const __m128d x_r, const __m128d x_i, const __m128d d_r,
+    const __m128d d_i, const __m128d y_r, const __m128d y_i, __m128d& res_r, __m128d& res_i) {
+    const __m128d out_r =
+        _mm_sub_pd(_mm_add_pd(_mm_mul_pd(c_r, x_r), _mm_mul_pd(d_r, y_r)),
+                   _mm_add_pd(_mm_mul_pd(c_i, x_i), _mm_mul_pd(d_i, y_i)));
+    const __m128d out_i =
+        _mm_add_pd(_mm_add_pd(_mm_mul_pd(c_r, x_i), _mm_mul_pd(c_i, x_r)),
+                   _mm_add_pd(_mm_mul_pd(d_r, y_i), _mm_mul_pd(d_i, y_r)));
+    res_r = out_r;
+    res_i = out_i;
+}
+
+/**
+ * @brief Swaps the lanes that differ on bit log2(stride) of their lane index.
+ */
+__attribute__((target("sse2"))) inline __m128d swap_lanes_sse2_pd(const __m128d v,
+                                                                      const uint64_t stride) {
+    switch (stride) {
+    case 1:
+        return _mm_shuffle_pd(v, v, 0x1);
+    }
+    return v;
+}
+
+__attribute__((target("sse2"))) void apply_1q_sse2_pd(
+    double* real, double* imag, const uint64_t size, const int target, const Matrix2& matrix,
+    const int num_threads) {
+    constexpr uint64_t lanes = 2;
+    const uint64_t stride = MASK(target);
+
+    if (stride >= lanes) {
+        const __m128d m00_r = _mm_set1_pd(static_cast<double>(matrix[0].real()));
+        const __m128d m00_i = _mm_set1_pd(static_cast<double>(matrix[0].imag()));
+        const __m128d m01_r = _mm_set1_pd(static_cast<double>(matrix[1].real()));
+        const __m128d m01_i = _mm_set1_pd(static_cast<double>(matrix[1].imag()));
+        const __m128d m10_r = _mm_set1_pd(static_cast<double>(matrix[2].real()));
+        const __m128d m10_i = _mm_set1_pd(static_cast<double>(matrix[2].imag()));
+        const __m128d m11_r = _mm_set1_pd(static_cast<double>(matrix[3].real()));
+        const __m128d m11_i = _mm_set1_pd(static_cast<double>(matrix[3].imag()));
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+        for (uint64_t k = 0; k < size / 2; k += lanes) {
+            const uint64_t i0 = kernels::insert_zero_bit(k, target);
+            const uint64_t i1 = i0 | stride;
+            const __m128d a0_r = _mm_load_pd(real + i0);
+            const __m128d a0_i = _mm_load_pd(imag + i0);
+            const __m128d a1_r = _mm_load_pd(real + i1);
+            const __m128d a1_i = _mm_load_pd(imag + i1);
+
+            __m128d out_r;
+            __m128d out_i;
+            cmul_add_sse2_pd(m00_r, m00_i, a0_r, a0_i, m01_r, m01_i, a1_r, a1_i, out_r, out_i);
+            _mm_store_pd(real + i0, out_r);
+            _mm_store_pd(imag + i0, out_i);
+            cmul_add_sse2_pd(m10_r, m10_i, a0_r, a0_i, m11_r, m11_i, a1_r, a1_i, out_r, out_i);
+            _mm_store_pd(real + i1, out_r);
+            _mm_store_pd(imag + i1, out_i);
+        }
+        return;
+    }
+
+    const auto coefficients = in_register_coefficients<double, lanes>(matrix, stride);
+    const __m128d c_r = _mm_loadu_pd(coefficients[0].data());
+    const __m128d c_i = _mm_loadu_pd(coefficients[1].data());
+    const __m128d d_r = _mm_loadu_pd(coefficients[2].data());
+    const __m128d d_i = _mm_loadu_pd(coefficients[3].data());
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t base = 0; base < size; base += lanes) {
+        const __m128d x_r = _mm_load_pd(real + base);
+        const __m128d x_i = _mm_load_pd(imag + base);
+        const __m128d y_r = swap_lanes_sse2_pd(x_r, stride);
+        const __m128d y_i = swap_lanes_sse2_pd(x_i, stride);
+
+        __m128d out_r;
+        __m128d out_i;
+        cmul_add_sse2_pd(c_r, c_i, x_r, x_i, d_r, d_i, y_r, y_i, out_r, out_i);
+        _mm_store_pd(real + base, out_r);
+        _mm_store_pd(imag + base, out_i);
+    }
+}
+
+/**
+ * @brief Returns c * x + d * y on split complex registers.
+ */
+__attribute__((target("avx2,fma"))) inline void cmul_add_avx2_pd(
+    const __m256d c_r, const __m256d c_i, const __m256d x_r, const __m256d x_i, const __m256d d_r,
+    const __m256d d_i, const __m256d y_r, const __m256d y_i, __m256d& res_r, __m256d& res_i) {
+    __m256d out_r = _mm256_mul_pd(c_r, x_r);
+    out_r = _mm256_fnmadd_pd(c_i, x_i, out_r);
+    out_r = _mm256_fmadd_pd(d_r, y_r, out_r);
+    out_r = _mm256_fnmadd_pd(d_i, y_i, out_r);
+    __m256d out_i = _mm256_mul_pd(c_r, x_i);
+    out_i = _mm256_fmadd_pd(c_i, x_r, out_i);
+    out_i = _mm256_fmadd_pd(d_r, y_i, out_i);
+    out_i = _mm256_fmadd_pd(d_i, y_r, out_i);
+    res_r = out_r;
+    res_i = out_i;
+}
+
+/**
+ * @brief Swaps the lanes that differ on bit log2(stride) of their lane index.
+ */
+__attribute__((target("avx2,fma"))) inline __m256d swap_lanes_avx2_pd(const __m256d v,
+                                                                      const uint64_t stride) {
+    switch (stride) {
+    case 1:
+        return _mm256_permute_pd(v, 0x5);
+    case 2:
+        return _mm256_permute2f128_pd(v, v, 0x1);
+    }
+    return v;
+}
+
+__attribute__((target("avx2,fma"))) void apply_1q_avx2_pd(
+    double* real, double* imag, const uint64_t size, const int target, const Matrix2& matrix,
+    const int num_threads) {
+    constexpr uint64_t lanes = 4;
+    const uint64_t stride = MASK(target);
+
+    if (stride >= lanes) {
+        const __m256d m00_r = _mm256_set1_pd(static_cast<double>(matrix[0].real()));
+        const __m256d m00_i = _mm256_set1_pd(static_cast<double>(matrix[0].imag()));
+        const __m256d m01_r = _mm256_set1_pd(static_cast<double>(matrix[1].real()));
+        const __m256d m01_i = _mm256_set1_pd(static_cast<double>(matrix[1].imag()));
+        const __m256d m10_r = _mm256_set1_pd(static_cast<double>(matrix[2].real()));
+        const __m256d m10_i = _mm256_set1_pd(static_cast<double>(matrix[2].imag()));
+        const __m256d m11_r = _mm256_set1_pd(static_cast<double>(matrix[3].real()));
+        const __m256d m11_i = _mm256_set1_pd(static_cast<double>(matrix[3].imag()));
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+        for (uint64_t k = 0; k < size / 2; k += lanes) {
+            const uint64_t i0 = kernels::insert_zero_bit(k, target);
+            const uint64_t i1 = i0 | stride;
+            const __m256d a0_r = _mm256_load_pd(real + i0);
+            const __m256d a0_i = _mm256_load_pd(imag + i0);
+            const __m256d a1_r = _mm256_load_pd(real + i1);
+            const __m256d a1_i = _mm256_load_pd(imag + i1);
+
+            __m256d out_r;
+            __m256d out_i;
+            cmul_add_avx2_pd(m00_r, m00_i, a0_r, a0_i, m01_r, m01_i, a1_r, a1_i, out_r, out_i);
+            _mm256_store_pd(real + i0, out_r);
+            _mm256_store_pd(imag + i0, out_i);
+            cmul_add_avx2_pd(m10_r, m10_i, a0_r, a0_i, m11_r, m11_i, a1_r, a1_i, out_r, out_i);
+            _mm256_store_pd(real + i1, out_r);
+            _mm256_store_pd(imag + i1, out_i);
+        }
+        return;
+    }
+
+    const auto coefficients = in_register_coefficients<double, lanes>(matrix, stride);
+    const __m256d c_r = _mm256_loadu_pd(coefficients[0].data());
+    const __m256d c_i = _mm256_loadu_pd(coefficients[1].data());
+    const __m256d d_r = _mm256_loadu_pd(coefficients[2].data());
+    const __m256d d_i = _mm256_loadu_pd(coefficients[3].data());
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t base = 0; base < size; base += lanes) {
+        const __m256d x_r = _mm256_load_pd(real + base);
+        const __m256d x_i = _mm256_load_pd(imag + base);
+        const __m256d y_r = swap_lanes_avx2_pd(x_r, stride);
+        const __m256d y_i = swap_lanes_avx2_pd(x_i, stride);
+
+        __m256d out_r;
+        __m256d out_i;
+        cmul_add_avx2_pd(c_r, c_i, x_r, x_i, d_r, d_i, y_r, y_i, out_r, out_i);
+        _mm256_store_pd(real + base, out_r);
+        _mm256_store_pd(imag + base, out_i);
+    }
+}
+
+/**
+ * @brief Returns c * x + d * y on split complex registers.
+ */
+__attribute__((target("avx512f"))) inline void cmul_add_avx512_pd(
+    const __m512d c_r, const __m512d c_i, const __m512d x_r, const __m512d x_i, const __m512d d_r,
+    const __m512d d_i, const __m512d y_r, const __m512d y_i, __m512d& res_r, __m512d& res_i) {
+    __m512d out_r = _mm512_mul_pd(c_r, x_r);
+    out_r = _mm512_fnmadd_pd(c_i, x_i, out_r);
+    out_r = _mm512_fmadd_pd(d_r, y_r, out_r);
+    out_r = _mm512_fnmadd_pd(d_i, y_i, out_r);
+    __m512d out_i = _mm512_mul_pd(c_r, x_i);
+    out_i = _mm512_fmadd_pd(c_i, x_r, out_i);
+    out_i = _mm512_fmadd_pd(d_r, y_i, out_i);
+    out_i = _mm512_fmadd_pd(d_i, y_r, out_i);
+    res_r = out_r;
+    res_i = out_i;
+}
+
+/**
+ * @brief Swaps the lanes that differ on bit log2(stride) of their lane index.
+ */
+__attribute__((target("avx512f"))) inline __m512d swap_lanes_avx512_pd(const __m512d v,
+                                                                      const uint64_t stride) {
+    // Lane i reads lane i ^ stride. The unmasked permutes pass an undefined vector through,
+    // which GCC reports as uninitialized once optimizing; the zero-masked one under a full mask
+    // is the same instruction
+    const __m512i index = _mm512_xor_si512(_mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0),
+                                           _mm512_set1_epi64(static_cast<int64_t>(stride)));
+    return _mm512_maskz_permutexvar_pd(0xFF, index, v);
+}
+
+__attribute__((target("avx512f"))) void apply_1q_avx512_pd(
+    double* real, double* imag, const uint64_t size, const int target, const Matrix2& matrix,
+    const int num_threads) {
+    constexpr uint64_t lanes = 8;
+    const uint64_t stride = MASK(target);
+
+    if (stride >= lanes) {
+        const __m512d m00_r = _mm512_set1_pd(static_cast<double>(matrix[0].real()));
+        const __m512d m00_i = _mm512_set1_pd(static_cast<double>(matrix[0].imag()));
+        const __m512d m01_r = _mm512_set1_pd(static_cast<double>(matrix[1].real()));
+        const __m512d m01_i = _mm512_set1_pd(static_cast<double>(matrix[1].imag()));
+        const __m512d m10_r = _mm512_set1_pd(static_cast<double>(matrix[2].real()));
+        const __m512d m10_i = _mm512_set1_pd(static_cast<double>(matrix[2].imag()));
+        const __m512d m11_r = _mm512_set1_pd(static_cast<double>(matrix[3].real()));
+        const __m512d m11_i = _mm512_set1_pd(static_cast<double>(matrix[3].imag()));
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+        for (uint64_t k = 0; k < size / 2; k += lanes) {
+            const uint64_t i0 = kernels::insert_zero_bit(k, target);
+            const uint64_t i1 = i0 | stride;
+            const __m512d a0_r = _mm512_load_pd(real + i0);
+            const __m512d a0_i = _mm512_load_pd(imag + i0);
+            const __m512d a1_r = _mm512_load_pd(real + i1);
+            const __m512d a1_i = _mm512_load_pd(imag + i1);
+
+            __m512d out_r;
+            __m512d out_i;
+            cmul_add_avx512_pd(m00_r, m00_i, a0_r, a0_i, m01_r, m01_i, a1_r, a1_i, out_r, out_i);
+            _mm512_store_pd(real + i0, out_r);
+            _mm512_store_pd(imag + i0, out_i);
+            cmul_add_avx512_pd(m10_r, m10_i, a0_r, a0_i, m11_r, m11_i, a1_r, a1_i, out_r, out_i);
+            _mm512_store_pd(real + i1, out_r);
+            _mm512_store_pd(imag + i1, out_i);
+        }
+        return;
+    }
+
+    const auto coefficients = in_register_coefficients<double, lanes>(matrix, stride);
+    const __m512d c_r = _mm512_loadu_pd(coefficients[0].data());
+    const __m512d c_i = _mm512_loadu_pd(coefficients[1].data());
+    const __m512d d_r = _mm512_loadu_pd(coefficients[2].data());
+    const __m512d d_i = _mm512_loadu_pd(coefficients[3].data());
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t base = 0; base < size; base += lanes) {
+        const __m512d x_r = _mm512_load_pd(real + base);
+        const __m512d x_i = _mm512_load_pd(imag + base);
+        const __m512d y_r = swap_lanes_avx512_pd(x_r, stride);
+        const __m512d y_i = swap_lanes_avx512_pd(x_i, stride);
+
+        __m512d out_r;
+        __m512d out_i;
+        cmul_add_avx512_pd(c_r, c_i, x_r, x_i, d_r, d_i, y_r, y_i, out_r, out_i);
+        _mm512_store_pd(real + base, out_r);
+        _mm512_store_pd(imag + base, out_i);
+    }
+}
+
+/**
+ * @brief Returns c * x + d * y on split complex registers.
+ */
+__attribute__((target("sse2"))) inline void cmul_add_sse2_ps(
+    const __m128 c_r, const __m128 c_i, const __m128 x_r, const __m128 x_i, const __m128 d_r,
+    const __m128 d_i, const __m128 y_r, const __m128 y_i, __m128& res_r, __m128& res_i) {
+    const __m128 out_r =
+        _mm_sub_ps(_mm_add_ps(_mm_mul_ps(c_r, x_r), _mm_mul_ps(d_r, y_r)),
+                   _mm_add_ps(_mm_mul_ps(c_i, x_i), _mm_mul_ps(d_i, y_i)));
+    const __m128 out_i =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(c_r, x_i), _mm_mul_ps(c_i, x_r)),
+                   _mm_add_ps(_mm_mul_ps(d_r, y_i), _mm_mul_ps(d_i, y_r)));
+    res_r = out_r;
+    res_i = out_i;
+}
+
+/**
+ * @brief Swaps the lanes that differ on bit log2(stride) of their lane index.
+ */
+__attribute__((target("sse2"))) inline __m128 swap_lanes_sse2_ps(const __m128 v,
+                                                                      const uint64_t stride) {
+    switch (stride) {
+    case 1:
+        return _mm_shuffle_ps(v, v, 0xB1);
+    case 2:
+        return _mm_shuffle_ps(v, v, 0x4E);
+    }
+    return v;
+}
+
+__attribute__((target("sse2"))) void apply_1q_sse2_ps(
+    float* real, float* imag, const uint64_t size, const int target, const Matrix2& matrix,
+    const int num_threads) {
+    constexpr uint64_t lanes = 4;
+    const uint64_t stride = MASK(target);
+
+    if (stride >= lanes) {
+        const __m128 m00_r = _mm_set1_ps(static_cast<float>(matrix[0].real()));
+        const __m128 m00_i = _mm_set1_ps(static_cast<float>(matrix[0].imag()));
+        const __m128 m01_r = _mm_set1_ps(static_cast<float>(matrix[1].real()));
+        const __m128 m01_i = _mm_set1_ps(static_cast<float>(matrix[1].imag()));
+        const __m128 m10_r = _mm_set1_ps(static_cast<float>(matrix[2].real()));
+        const __m128 m10_i = _mm_set1_ps(static_cast<float>(matrix[2].imag()));
+        const __m128 m11_r = _mm_set1_ps(static_cast<float>(matrix[3].real()));
+        const __m128 m11_i = _mm_set1_ps(static_cast<float>(matrix[3].imag()));
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+        for (uint64_t k = 0; k < size / 2; k += lanes) {
+            const uint64_t i0 = kernels::insert_zero_bit(k, target);
+            const uint64_t i1 = i0 | stride;
+            const __m128 a0_r = _mm_load_ps(real + i0);
+            const __m128 a0_i = _mm_load_ps(imag + i0);
+            const __m128 a1_r = _mm_load_ps(real + i1);
+            const __m128 a1_i = _mm_load_ps(imag + i1);
+
+            __m128 out_r;
+            __m128 out_i;
+            cmul_add_sse2_ps(m00_r, m00_i, a0_r, a0_i, m01_r, m01_i, a1_r, a1_i, out_r, out_i);
+            _mm_store_ps(real + i0, out_r);
+            _mm_store_ps(imag + i0, out_i);
+            cmul_add_sse2_ps(m10_r, m10_i, a0_r, a0_i, m11_r, m11_i, a1_r, a1_i, out_r, out_i);
+            _mm_store_ps(real + i1, out_r);
+            _mm_store_ps(imag + i1, out_i);
+        }
+        return;
+    }
+
+    const auto coefficients = in_register_coefficients<float, lanes>(matrix, stride);
+    const __m128 c_r = _mm_loadu_ps(coefficients[0].data());
+    const __m128 c_i = _mm_loadu_ps(coefficients[1].data());
+    const __m128 d_r = _mm_loadu_ps(coefficients[2].data());
+    const __m128 d_i = _mm_loadu_ps(coefficients[3].data());
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t base = 0; base < size; base += lanes) {
+        const __m128 x_r = _mm_load_ps(real + base);
+        const __m128 x_i = _mm_load_ps(imag + base);
+        const __m128 y_r = swap_lanes_sse2_ps(x_r, stride);
+        const __m128 y_i = swap_lanes_sse2_ps(x_i, stride);
+
+        __m128 out_r;
+        __m128 out_i;
+        cmul_add_sse2_ps(c_r, c_i, x_r, x_i, d_r, d_i, y_r, y_i, out_r, out_i);
+        _mm_store_ps(real + base, out_r);
+        _mm_store_ps(imag + base, out_i);
+    }
+}
+
+/**
+ * @brief Returns c * x + d * y on split complex registers.
+ */
+__attribute__((target("avx2,fma"))) inline void cmul_add_avx2_ps(
+    const __m256 c_r, const __m256 c_i, const __m256 x_r, const __m256 x_i, const __m256 d_r,
+    const __m256 d_i, const __m256 y_r, const __m256 y_i, __m256& res_r, __m256& res_i) {
+    __m256 out_r = _mm256_mul_ps(c_r, x_r);
+    out_r = _mm256_fnmadd_ps(c_i, x_i, out_r);
+    out_r = _mm256_fmadd_ps(d_r, y_r, out_r);
+    out_r = _mm256_fnmadd_ps(d_i, y_i, out_r);
+    __m256 out_i = _mm256_mul_ps(c_r, x_i);
+    out_i = _mm256_fmadd_ps(c_i, x_r, out_i);
+    out_i = _mm256_fmadd_ps(d_r, y_i, out_i);
+    out_i = _mm256_fmadd_ps(d_i, y_r, out_i);
+    res_r = out_r;
+    res_i = out_i;
+}
+
+/**
+ * @brief Swaps the lanes that differ on bit log2(stride) of their lane index.
+ */
+__attribute__((target("avx2,fma"))) inline __m256 swap_lanes_avx2_ps(const __m256 v,
+                                                                      const uint64_t stride) {
+    switch (stride) {
+    case 1:
+        return _mm256_permute_ps(v, 0xB1);
+    case 2:
+        return _mm256_permute_ps(v, 0x4E);
+    case 4:
+        return _mm256_permute2f128_ps(v, v, 0x1);
+    }
+    return v;
+}
+
+__attribute__((target("avx2,fma"))) void apply_1q_avx2_ps(
+    float* real, float* imag, const uint64_t size, const int target, const Matrix2& matrix,
+    const int num_threads) {
+    constexpr uint64_t lanes = 8;
+    const uint64_t stride = MASK(target);
+
+    if (stride >= lanes) {
+        const __m256 m00_r = _mm256_set1_ps(static_cast<float>(matrix[0].real()));
+        const __m256 m00_i = _mm256_set1_ps(static_cast<float>(matrix[0].imag()));
+        const __m256 m01_r = _mm256_set1_ps(static_cast<float>(matrix[1].real()));
+        const __m256 m01_i = _mm256_set1_ps(static_cast<float>(matrix[1].imag()));
+        const __m256 m10_r = _mm256_set1_ps(static_cast<float>(matrix[2].real()));
+        const __m256 m10_i = _mm256_set1_ps(static_cast<float>(matrix[2].imag()));
+        const __m256 m11_r = _mm256_set1_ps(static_cast<float>(matrix[3].real()));
+        const __m256 m11_i = _mm256_set1_ps(static_cast<float>(matrix[3].imag()));
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+        for (uint64_t k = 0; k < size / 2; k += lanes) {
+            const uint64_t i0 = kernels::insert_zero_bit(k, target);
+            const uint64_t i1 = i0 | stride;
+            const __m256 a0_r = _mm256_load_ps(real + i0);
+            const __m256 a0_i = _mm256_load_ps(imag + i0);
+            const __m256 a1_r = _mm256_load_ps(real + i1);
+            const __m256 a1_i = _mm256_load_ps(imag + i1);
+
+            __m256 out_r;
+            __m256 out_i;
+            cmul_add_avx2_ps(m00_r, m00_i, a0_r, a0_i, m01_r, m01_i, a1_r, a1_i, out_r, out_i);
+            _mm256_store_ps(real + i0, out_r);
+            _mm256_store_ps(imag + i0, out_i);
+            cmul_add_avx2_ps(m10_r, m10_i, a0_r, a0_i, m11_r, m11_i, a1_r, a1_i, out_r, out_i);
+            _mm256_store_ps(real + i1, out_r);
+            _mm256_store_ps(imag + i1, out_i);
+        }
+        return;
+    }
+
+    const auto coefficients = in_register_coefficients<float, lanes>(matrix, stride);
+    const __m256 c_r = _mm256_loadu_ps(coefficients[0].data());
+    const __m256 c_i = _mm256_loadu_ps(coefficients[1].data());
+    const __m256 d_r = _mm256_loadu_ps(coefficients[2].data());
+    const __m256 d_i = _mm256_loadu_ps(coefficients[3].data());
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t base = 0; base < size; base += lanes) {
+        const __m256 x_r = _mm256_load_ps(real + base);
+        const __m256 x_i = _mm256_load_ps(imag + base);
+        const __m256 y_r = swap_lanes_avx2_ps(x_r, stride);
+        const __m256 y_i = swap_lanes_avx2_ps(x_i, stride);
+
+        __m256 out_r;
+        __m256 out_i;
+        cmul_add_avx2_ps(c_r, c_i, x_r, x_i, d_r, d_i, y_r, y_i, out_r, out_i);
+        _mm256_store_ps(real + base, out_r);
+        _mm256_store_ps(imag + base, out_i);
+    }
+}
+
+/**
+ * @brief Returns c * x + d * y on split complex registers.
+ */
+__attribute__((target("avx512f"))) inline void cmul_add_avx512_ps(
+    const __m512 c_r, const __m512 c_i, const __m512 x_r, const __m512 x_i, const __m512 d_r,
+    const __m512 d_i, const __m512 y_r, const __m512 y_i, __m512& res_r, __m512& res_i) {
+    __m512 out_r = _mm512_mul_ps(c_r, x_r);
+    out_r = _mm512_fnmadd_ps(c_i, x_i, out_r);
+    out_r = _mm512_fmadd_ps(d_r, y_r, out_r);
+    out_r = _mm512_fnmadd_ps(d_i, y_i, out_r);
+    __m512 out_i = _mm512_mul_ps(c_r, x_i);
+    out_i = _mm512_fmadd_ps(c_i, x_r, out_i);
+    out_i = _mm512_fmadd_ps(d_r, y_i, out_i);
+    out_i = _mm512_fmadd_ps(d_i, y_r, out_i);
+    res_r = out_r;
+    res_i = out_i;
+}
+
+/**
+ * @brief Swaps the lanes that differ on bit log2(stride) of their lane index.
+ */
+__attribute__((target("avx512f"))) inline __m512 swap_lanes_avx512_ps(const __m512 v,
+                                                                      const uint64_t stride) {
+    // Same zero-masked permute as swap_lanes_avx512_pd
+    const __m512i index =
+        _mm512_xor_si512(_mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0),
+                         _mm512_set1_epi32(static_cast<int>(stride)));
+    return _mm512_maskz_permutexvar_ps(0xFFFF, index, v);
+}
+
+__attribute__((target("avx512f"))) void apply_1q_avx512_ps(
+    float* real, float* imag, const uint64_t size, const int target, const Matrix2& matrix,
+    const int num_threads) {
+    constexpr uint64_t lanes = 16;
+    const uint64_t stride = MASK(target);
+
+    if (stride >= lanes) {
+        const __m512 m00_r = _mm512_set1_ps(static_cast<float>(matrix[0].real()));
+        const __m512 m00_i = _mm512_set1_ps(static_cast<float>(matrix[0].imag()));
+        const __m512 m01_r = _mm512_set1_ps(static_cast<float>(matrix[1].real()));
+        const __m512 m01_i = _mm512_set1_ps(static_cast<float>(matrix[1].imag()));
+        const __m512 m10_r = _mm512_set1_ps(static_cast<float>(matrix[2].real()));
+        const __m512 m10_i = _mm512_set1_ps(static_cast<float>(matrix[2].imag()));
+        const __m512 m11_r = _mm512_set1_ps(static_cast<float>(matrix[3].real()));
+        const __m512 m11_i = _mm512_set1_ps(static_cast<float>(matrix[3].imag()));
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+        for (uint64_t k = 0; k < size / 2; k += lanes) {
+            const uint64_t i0 = kernels::insert_zero_bit(k, target);
+            const uint64_t i1 = i0 | stride;
+            const __m512 a0_r = _mm512_load_ps(real + i0);
+            const __m512 a0_i = _mm512_load_ps(imag + i0);
+            const __m512 a1_r = _mm512_load_ps(real + i1);
+            const __m512 a1_i = _mm512_load_ps(imag + i1);
+
+            __m512 out_r;
+            __m512 out_i;
+            cmul_add_avx512_ps(m00_r, m00_i, a0_r, a0_i, m01_r, m01_i, a1_r, a1_i, out_r, out_i);
+            _mm512_store_ps(real + i0, out_r);
+            _mm512_store_ps(imag + i0, out_i);
+            cmul_add_avx512_ps(m10_r, m10_i, a0_r, a0_i, m11_r, m11_i, a1_r, a1_i, out_r, out_i);
+            _mm512_store_ps(real + i1, out_r);
+            _mm512_store_ps(imag + i1, out_i);
+        }
+        return;
+    }
+
+    const auto coefficients = in_register_coefficients<float, lanes>(matrix, stride);
+    const __m512 c_r = _mm512_loadu_ps(coefficients[0].data());
+    const __m512 c_i = _mm512_loadu_ps(coefficients[1].data());
+    const __m512 d_r = _mm512_loadu_ps(coefficients[2].data());
+    const __m512 d_i = _mm512_loadu_ps(coefficients[3].data());
+
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) schedule(static)
+    for (uint64_t base = 0; base < size; base += lanes) {
+        const __m512 x_r = _mm512_load_ps(real + base);
+        const __m512 x_i = _mm512_load_ps(imag + base);
+        const __m512 y_r = swap_lanes_avx512_ps(x_r, stride);
+        const __m512 y_i = swap_lanes_avx512_ps(x_i, stride);
+
+        __m512 out_r;
+        __m512 out_i;
+        cmul_add_avx512_ps(c_r, c_i, x_r, x_i, d_r, d_i, y_r, y_i, out_r, out_i);
+        _mm512_store_ps(real + base, out_r);
+        _mm512_store_ps(imag + base, out_i);
+    }
+}
+#endif
+
+/**
+ * @brief Number of T values held by one register of the given instruction set.
+ */
+template <typename T> constexpr uint64_t lanes_of(const SimdLevel level) {
+    switch (level) {
+    case SimdLevel::scalar:
+        return 1;
+    case SimdLevel::sse2:
+        return 16 / sizeof(T);
+    case SimdLevel::avx2:
+        return 32 / sizeof(T);
+    case SimdLevel::avx512:
+        return 64 / sizeof(T);
+    }
+    return 1;
+}
+
+} // namespace
+
+SimdLevel simd::detect_level() {
+#ifdef SIMD_X86
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::avx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::sse2;
+    }
+#endif
+    return SimdLevel::scalar;
+}
+
+void simd::apply_1q(double* real, double* imag, const uint64_t size, const int target,
+                    const Matrix2& matrix, const int num_threads, SimdLevel level) {
+    // Too small to fill a single register
+    if (size < lanes_of<double>(level)) {
+        level = SimdLevel::scalar;
+    }
+
+    switch (level) {
+#ifdef SIMD_X86
+    case SimdLevel::avx512:
+        apply_1q_avx512_pd(real, imag, size, target, matrix, num_threads);
+        return;
+    case SimdLevel::avx2:
+        apply_1q_avx2_pd(real, imag, size, target, matrix, num_threads);
+        return;
+    case SimdLevel::sse2:
+        apply_1q_sse2_pd(real, imag, size, target, matrix, num_threads);
+        return;
+#endif
+    default:
+        apply_1q_scalar(real, imag, size, target, matrix, num_threads);
+    }
+}
+
+void simd::apply_1q(float* real, float* imag, const uint64_t size, const int target,
+                    const Matrix2& matrix, const int num_threads, SimdLevel level) {
+    if (size < lanes_of<float>(level)) {
+        level = SimdLevel::scalar;
+    }
+
+    switch (level) {
+#ifdef SIMD_X86
+    case SimdLevel::avx512:
+        apply_1q_avx512_ps(real, imag, size, target, matrix, num_threads);
+        return;
+    case SimdLevel::avx2:
+        apply_1q_avx2_ps(real, imag, size, target, matrix, num_threads);
+        return;
+    case SimdLevel::sse2:
+        apply_1q_sse2_ps(real, imag, size, target, matrix, num_threads);
+        return;
+#endif
+    default:
+        apply_1q_scalar(real, imag, size, target, matrix, num_threads);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef SIMD_KERNELS_HPP
+#define SIMD_KERNELS_HPP
+
+#include "qstate_vec.hpp"
+#include <cstdint>
+#include <string>
+
+enum class SimdLevel : std::uint8_t { scalar, sse2, avx2, avx512 };
+
+inline std::string to_string(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::scalar:
+        return "Scalar";
+    case SimdLevel::sse2:
+        return "SSE2";
+    case SimdLevel::avx2:
+        return "AVX2";
+    case SimdLevel::avx512:
+        return "AVX-512";
+    }
+    return "Unknown SIMD Level";
+}
+
+/**
+ * Hand-vectorized kernels over the split layout, where the real and imaginary parts live in two
+ * separate 64-byte aligned arrays.
+ * Targets whose pair stride spans at least one register stream both halves of the pair with
+ * aligned loads. Lower targets keep the pair inside one register: the partner amplitudes are
+ * brought in with a lane shuffle and combined with per-lane matrix coefficients.
+ */
+namespace simd {
+
+/**
+ * @brief Returns the widest instruction set supported by the running CPU.
+ */
+SimdLevel detect_level();
+
+/**
+ * @brief Applies the row-major 2x2 matrix to bit `target` of the split state vector.
+ *
+ * @param real Real parts, 64-byte aligned
+ * @param imag Imaginary parts, 64-byte aligned
+ * @param size Number of amplitudes, a power of two
+ * @param level Instruction set to use, must not exceed detect_level()
+ */
+void apply_1q(double* real, double* imag, uint64_t size, int target, const Matrix2& matrix,
+              int num_threads, SimdLevel level);
+
+void apply_1q(float* real, float* imag, uint64_t size, int target, const Matrix2& matrix,
+              int num_threads, SimdLevel level);
+
+} // namespace simd
+
+#endif
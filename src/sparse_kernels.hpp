@@ -0,0 +1,312 @@
+#ifndef SPARSE_KERNELS_HPP
+#define SPARSE_KERNELS_HPP
+
+#include "amplitude_map.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <array>
+#include <complex>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * Kernels over the sparse storage, with the same bit conventions as the kernels namespace.
+ * Only stored amplitudes are visited, so a gate costs O(entries) instead of O(2^n). Gates that
+ * mix amplitudes build a new map and drop entries that cancel out; permutations and phases keep
+ * the number of entries. They run serially: sparse states are expected to be small.
+ */
+namespace sparse {
+
+/**
+ * Above this fraction of non-zero amplitudes, dense storage is both smaller and faster.
+ */
+constexpr double DENSE_FILL_RATIO = 1.0 / 16;
+
+/**
+ * Below this fraction of non-zero amplitudes a dense state moves back to sparse storage.
+ * Lower than DENSE_FILL_RATIO so a state near the threshold does not switch back and forth.
+ */
+constexpr double SPARSE_FILL_RATIO = 1.0 / 64;
+
+/**
+ * Automatic storage never switches to dense above this many qubits, whatever the fill ratio.
+ */
+constexpr int MAX_AUTO_DENSE_QUBITS = 30;
+
+/**
+ * @brief Whether the amplitude is rounding noise left by a cancellation.
+ */
+template <typename T> bool is_zero(const std::complex<T>& amplitude) {
+    constexpr T epsilon = std::numeric_limits<T>::epsilon();
+    return std::norm(amplitude) < epsilon * epsilon;
+}
+
+template <typename T>
+void insert_nonzero(AmplitudeMap<T>& amps, const uint64_t index, const std::complex<T>& amplitude) {
+    if (!is_zero(amplitude)) {
+        amps[index] = amplitude;
+    }
+}
+
+/**
+ * @brief Multiplies the amplitudes with every bit of controls_mask set by diagonal[bit target].
+ */
+template <typename T>
+void apply_diagonal(AmplitudeMap<T>& amps, const uint64_t controls_mask, const int target,
+                    const std::array<std::complex<T>, 2>& diagonal) {
+    amps.for_each([&](const uint64_t index, std::complex<T>& amplitude) {
+        if ((index & controls_mask) == controls_mask) {
+            amplitude = kernels::mul(amplitude, diagonal[(index >> target) & 1]);
+        }
+    });
+}
+
+/**
+ * @brief Applies the row-major 2x2 matrix to bit `target` of the stored amplitudes with every
+ *  bit of controls_mask set. Each pair is computed once, from whichever member is stored first.
+ */
+template <typename T>
+void controlled_apply_1q(AmplitudeMap<T>& amps, const uint64_t controls_mask, const int target,
+                         const std::array<std::complex<T>, 4>& matrix) {
+    if (matrix[1] == std::complex<T>{} && matrix[2] == std::complex<T>{}) {
+        apply_diagonal<T>(amps, controls_mask, target, {matrix[0], matrix[3]});
+        return;
+    }
+
+    const uint64_t mask = 0x1ull << target;
+    const bool permutation = matrix[0] == std::complex<T>{} && matrix[3] == std::complex<T>{};
+    AmplitudeMap<T> result(permutation ? amps.size() : 2 * amps.size());
+    amps.for_each([&](const uint64_t index, const std::complex<T>& amplitude) {
+        if ((index & controls_mask) != controls_mask) {
+            result[index] = amplitude;
+            return;
+        }
+        // Anti-diagonal gates (X, Y) only move amplitudes to their partner
+        if (permutation) {
+            result[index ^ mask] = kernels::mul(amplitude, matrix[(index & mask) != 0 ? 1 : 2]);
+            return;
+        }
+        const uint64_t i0 = index & ~mask;
+        const uint64_t i1 = index | mask;
+        if (index == i1 && amps.contains(i0)) {
+            return;
+        }
+        const auto a0 = amps.get(i0);
+        const auto a1 = amps.get(i1);
+        insert_nonzero(result, i0, kernels::mul_add(matrix[0], a0, matrix[1], a1));
+        insert_nonzero(result, i1, kernels::mul_add(matrix[2], a0, matrix[3], a1));
+    });
+    amps = std::move(result);
+}
+
+/**
+ * @brief Applies a 2^k x 2^k matrix to the bits in targets, with the layout of
+ *  kernels::apply_nq. Each block is computed once, from its first stored member.
+ */
+template <typename T>
+void apply_nq(AmplitudeMap<T>& amps, const std::vector<int>& targets,
+              const std::vector<std::complex<T>>& matrix) {
+    const uint64_t dim = 0x1ull << targets.size();
+    std::vector<uint64_t> offsets(dim, 0);
+    for (uint64_t r = 0; r < dim; r++) {
+        for (size_t k = 0; k < targets.size(); k++) {
+            offsets[r] |= ((r >> k) & 1) << targets[k];
+        }
+    }
+    const uint64_t targets_mask = offsets[dim - 1];
+
+    AmplitudeMap<T> result(2 * amps.size());
+    std::vector<std::complex<T>> block(dim);
+    amps.for_each([&](const uint64_t index, const std::complex<T>& /*amplitude*/) {
+        const uint64_t base = index & ~targets_mask;
+        for (uint64_t c = 0; base + offsets[c] != index; c++) {
+            if (amps.contains(base + offsets[c])) {
+                return;
+            }
+        }
+
+        for (uint64_t c = 0; c < dim; c++) {
+            block[c] = amps.get(base + offsets[c]);
+        }
+        for (uint64_t r = 0; r < dim; r++) {
+            std::complex<T> sum = 0;
+            for (uint64_t c = 0; c < dim; c++) {
+                sum += kernels::mul(matrix[r * dim + c], block[c]);
+            }
+            insert_nonzero(result, base + offsets[r], sum);
+        }
+    });
+    amps = std::move(result);
+}
+
+/**
+ * @brief Sparse counterpart of kernels::marginal_probabilities.
+ */
+template <typename T>
+std::vector<T> marginal_probabilities(const AmplitudeMap<T>& amps, const int num_bits) {
+    std::vector<T> marginals(num_bits, 0);
+    amps.for_each([&](const uint64_t index, const std::complex<T>& amplitude) {
+        for (uint64_t bits = index; bits != 0; bits &= bits - 1) {
+            marginals[std::countr_zero(bits)] += std::norm(amplitude);
+        }
+    });
+    return marginals;
+}
+
+/**
+ * @brief Sparse counterpart of kernels::joint_probabilities.
+ */
+template <typename T>
+std::vector<T> joint_probabilities(const AmplitudeMap<T>& amps, std::span<const int> bits) {
+    std::vector<T> distribution(0x1ull << bits.size(), 0);
+    amps.for_each([&](const uint64_t index, const std::complex<T>& amplitude) {
+        uint64_t out = 0;
+        for (size_t k = 0; k < bits.size(); k++) {
+            out |= ((index >> bits[k]) & 1) << k;
+        }
+        distribution[out] += std::norm(amplitude);
+    });
+    return distribution;
+}
+
+/**
+ * @brief Sparse counterpart of kernels::pauli_expectations: each stored index with the top
+ *  flipped bit cleared looks up its partner, absent partners adding nothing.
+ */
+template <typename T>
+std::vector<double> pauli_expectations(const AmplitudeMap<T>& amps, const uint64_t flip_mask,
+                                       std::span<const uint64_t> z_masks) {
+    const uint64_t pair_mask = flip_mask == 0 ? 0 : std::bit_floor(flip_mask);
+    std::vector<double> sums(z_masks.size(), 0);
+    amps.for_each([&](const uint64_t index, const std::complex<T>& amplitude) {
+        if ((index & pair_mask) != 0) {
+            return;
+        }
+        const std::complex<double> overlap =
+            std::conj(std::complex<double>(amplitude)) *
+            std::complex<double>(amps.get(index ^ flip_mask));
+        for (size_t t = 0; t < z_masks.size(); t++) {
+            const auto weight = kernels::pauli_pair_weight(flip_mask, z_masks[t]);
+            const double value = weight.imaginary ? overlap.imag() : overlap.real();
+            sums[t] += (std::popcount(index & z_masks[t]) & 1) != 0 ? -value : value;
+        }
+    });
+
+    for (size_t t = 0; t < z_masks.size(); t++) {
+        sums[t] *= kernels::pauli_pair_weight(flip_mask, z_masks[t]).scale;
+    }
+    return sums;
+}
+
+/**
+ * @brief Sparse counterpart of kernels::sample_counts: the stored entries, sorted by index, form
+ *  the cumulative distribution merged with the sorted uniforms.
+ */
+template <typename T>
+std::vector<std::pair<uint64_t, uint64_t>> sample_counts(const AmplitudeMap<T>& amps,
+                                                         const uint64_t shots,
+                                                         const uint64_t seed) {
+    std::vector<std::pair<uint64_t, double>> entries;
+    entries.reserve(amps.size());
+    double total = 0;
+    amps.for_each([&](const uint64_t index, const std::complex<T>& amplitude) {
+        entries.emplace_back(index, std::norm(amplitude));
+    });
+    std::ranges::sort(entries);
+    for (const auto& entry : entries) {
+        total += entry.second;
+    }
+
+    std::mt19937_64 rng(seed);
+    const auto uniforms = kernels::sorted_uniforms(shots, total, rng);
+
+    std::vector<std::pair<uint64_t, uint64_t>> counts;
+    auto first = uniforms.begin();
+    double cumulative = 0;
+    for (size_t k = 0; k < entries.size() && first != uniforms.end(); k++) {
+        cumulative += entries[k].second;
+        // Uniforms left over by rounding go to the last entry
+        const auto drawn = k + 1 == entries.size()
+                               ? uniforms.end()
+                               : std::find_if(first, uniforms.end(),
+                                              [&](double u) { return u >= cumulative; });
+        if (drawn != first) {
+            counts.emplace_back(entries[k].first, drawn - first);
+            first = drawn;
+        }
+    }
+    return counts;
+}
+
+/**
+ * @brief Sparse counterpart of kernels::pair_probabilities.
+ */
+template <typename T>
+std::pair<double, double> pair_probabilities(const AmplitudeMap<T>& amps, const int target) {
+    double p0 = 0;
+    double p1 = 0;
+    amps.for_each([&](const uint64_t index, const std::complex<T>& amplitude) {
+        (((index >> target) & 1) != 0 ? p1 : p0) += std::norm(amplitude);
+    });
+    return {p0, p1};
+}
+
+/**
+ * @brief Sparse counterpart of kernels::collapse.
+ */
+template <typename T>
+void collapse(AmplitudeMap<T>& amps, const int target, const int outcome, const T scale,
+              const bool reset) {
+    const uint64_t mask = 0x1ull << target;
+    AmplitudeMap<T> result(amps.size());
+    amps.for_each([&](const uint64_t index, const std::complex<T>& amplitude) {
+        if (static_cast<int>((index >> target) & 1) == outcome) {
+            result[reset ? index & ~mask : index] = amplitude * scale;
+        }
+    });
+    amps = std::move(result);
+}
+
+/**
+ * @brief Writes the stored entries into a zeroed dense state vector of 2^num_bits amplitudes.
+ */
+template <typename T>
+void to_dense(const AmplitudeMap<T>& amps, std::span<std::complex<T>> dense) {
+    amps.for_each([&](const uint64_t index, const std::complex<T>& amplitude) {
+        dense[index] = amplitude;
+    });
+}
+
+/**
+ * @brief Returns the map holding the non-zero amplitudes of the dense state vector.
+ */
+template <typename T>
+AmplitudeMap<T> from_dense(std::span<const std::complex<T>> dense, const uint64_t num_nonzero) {
+    AmplitudeMap<T> amps(num_nonzero);
+    for (uint64_t i = 0; i < dense.size(); i++) {
+        insert_nonzero(amps, i, dense[i]);
+    }
+    return amps;
+}
+
+/**
+ * @brief Returns the number of amplitudes that would be stored by from_dense.
+ */
+template <typename T>
+uint64_t count_nonzero(std::span<const std::complex<T>> dense, const int num_threads) {
+    uint64_t count = 0;
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1) reduction(+ : count)       \
+    schedule(static)
+    for (uint64_t i = 0; i < dense.size(); i++) {
+        count += is_zero(dense[i]) ? 0 : 1;
+    }
+    return count;
+}
+
+} // namespace sparse
+
+#endif
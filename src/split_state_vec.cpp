@@ -0,0 +1,87 @@
+#include "split_state_vec.hpp"
+#include "gates.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+
+#define MASK(N) (0x1ull << (N))
+
+using namespace std;
+
+template <typename T>
+SplitStateVec<T>::SplitStateVec(const int num_qubits, const int num_threads) {
+    this->num_qubits = num_qubits;
+    this->num_threads = kernels::resolve_num_threads(num_qubits, num_threads);
+    this->simd_level = simd::detect_level();
+
+    this->real = AlignedBuffer<T>(MASK(num_qubits), 0.0);
+    this->imag = AlignedBuffer<T>(MASK(num_qubits), 0.0);
+    this->real[0] = 1.0;
+}
+
+template <typename T> SplitStateVec<T>::SplitStateVec(const QStateVec<T>& state) {
+    this->num_qubits = state.get_num_qubits();
+    this->num_threads = state.get_num_threads();
+    this->simd_level = simd::detect_level();
+
+    const auto& amps = state.get_state();
+    this->real = AlignedBuffer<T>(amps.size());
+    this->imag = AlignedBuffer<T>(amps.size());
+    for (size_t i = 0; i < amps.size(); i++) {
+        this->real[i] = amps[i].real();
+        this->imag[i] = amps[i].imag();
+    }
+}
+
+template <typename T>
+auto SplitStateVec<T>::apply_1q(const int target_qubit, const Matrix2& matrix)
+    -> expected<void, Error> {
+    if (target_qubit > this->num_qubits || target_qubit <= 0) {
+        return unexpected(Error::invalid_input);
+    }
+
+    simd::apply_1q(this->real.data(), this->imag.data(), this->real.size(), target_qubit - 1,
+                   matrix, this->num_threads, this->simd_level);
+    return {};
+}
+
+template <typename T>
+auto SplitStateVec<T>::pauli_x(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::pauli_x());
+}
+
+template <typename T>
+auto SplitStateVec<T>::pauli_y(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::pauli_y());
+}
+
+template <typename T>
+auto SplitStateVec<T>::hadamard(const int target_qubit) -> expected<void, Error> {
+    return this->apply_1q(target_qubit, gates::hadamard());
+}
+
+template <typename T> vector<T> SplitStateVec<T>::get_measured_qubits() const {
+    const T* real = this->real.data();
+    const T* imag = this->imag.data();
+    return kernels::marginal_probabilities<T>(
+        this->real.size(), this->num_qubits, this->num_threads,
+        [real, imag](const uint64_t i) { return real[i] * real[i] + imag[i] * imag[i]; });
+}
+
+template <typename T> StateVector<T> SplitStateVec<T>::to_state_vector() const {
+    StateVector<T> amps(this->real.size());
+    for (size_t i = 0; i < amps.size(); i++) {
+        amps[i] = {this->real[i], this->imag[i]};
+    }
+    return amps;
+}
+
+template <typename T> SimdLevel SplitStateVec<T>::get_simd_level() const {
+    return this->simd_level;
+}
+
+template <typename T> void SplitStateVec<T>::set_simd_level(const SimdLevel level) {
+    this->simd_level = min(level, simd::detect_level());
+}
+
+template class SplitStateVec<float>;
+template class SplitStateVec<double>;
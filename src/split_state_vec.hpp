@@ -0,0 +1,67 @@
+#ifndef SPLIT_STATE_VEC_HPP
+#define SPLIT_STATE_VEC_HPP
+
+#include "aligned_allocator.hpp"
+#include "qstate_vec.hpp"
+#include "simd_kernels.hpp"
+#include <expected>
+#include <vector>
+
+/**
+ * State vector stored as two 64-byte aligned arrays, one for the real parts and one for the
+ * imaginary parts. Gates run through the hand-vectorized kernels of the widest instruction set
+ * the CPU supports.
+ */
+template <typename T = double> class SplitStateVec {
+  private:
+    AlignedBuffer<T> real;
+    AlignedBuffer<T> imag;
+    int num_qubits;
+    int num_threads;
+    SimdLevel simd_level;
+
+  public:
+    /**
+     * @brief Construct a split state vector initialized to |0...0>.
+     *
+     * @param num_qubits
+     * @param num_threads Same meaning as in QStateVec
+     */
+    SplitStateVec(int num_qubits, int num_threads = 0);
+
+    /**
+     * @brief Construct a split state vector holding a copy of the amplitudes of state.
+     */
+    explicit SplitStateVec(const QStateVec<T>& state);
+
+    /**
+     * @brief Applies an arbitrary single qubit unitary to the target qubit.
+     *
+     * @param target_qubit
+     * @param matrix Row-major {m00, m01, m10, m11}
+     */
+    auto apply_1q(int target_qubit, const Matrix2& matrix) -> std::expected<void, Error>;
+
+    auto pauli_x(int target_qubit) -> std::expected<void, Error>;
+    auto pauli_y(int target_qubit) -> std::expected<void, Error>;
+    auto hadamard(int target_qubit) -> std::expected<void, Error>;
+
+    /**
+     * @brief Returns the result of the measured collapsed qubits
+     */
+    [[nodiscard]] std::vector<T> get_measured_qubits() const;
+
+    /**
+     * @brief Returns the amplitudes in the interleaved layout used by QStateVec.
+     */
+    [[nodiscard]] StateVector<T> to_state_vector() const;
+
+    [[nodiscard]] SimdLevel get_simd_level() const;
+
+    /**
+     * @brief Selects the instruction set used by the kernels, capped to what the CPU supports.
+     */
+    void set_simd_level(SimdLevel level);
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ * Items live in a ring of capacity slots (rounded up to a power of two); head and tail only ever
+ * grow, each owned by one side and published with release stores, on separate cache lines so
+ * the two threads do not contend for them. push and pop never block: a full or empty queue is
+ * reported to the caller, which can sleep in wait_not_full / wait_not_empty until the other side
+ * moves.
+ */
+template <typename Item> class SpscQueue {
+  private:
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    std::vector<Item> slots;
+    std::size_t mask;
+    alignas(CACHE_LINE) std::atomic<std::size_t> head = 0; // Next slot to pop
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail = 0; // Next slot to push
+
+  public:
+    explicit SpscQueue(const std::size_t capacity)
+        : slots(std::bit_ceil(std::max<std::size_t>(capacity, 2))), mask(slots.size() - 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Producer side: moves the item in and returns true, or returns false when full.
+     */
+    bool try_push(Item& item) {
+        const std::size_t position = this->tail.load(std::memory_order_relaxed);
+        if (position - this->head.load(std::memory_order_acquire) == this->slots.size()) {
+            return false;
+        }
+        this->slots[position & this->mask] = std::move(item);
+        this->tail.store(position + 1, std::memory_order_release);
+        this->tail.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Consumer side: moves the oldest item out and returns true, or returns false when
+     *  empty.
+     */
+    bool try_pop(Item& item) {
+        const std::size_t position = this->head.load(std::memory_order_relaxed);
+        if (position == this->tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(this->slots[position & this->mask]);
+        this->head.store(position + 1, std::memory_order_release);
+        this->head.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Producer side: sleeps while the queue is full.
+     */
+    void wait_not_full() const {
+        const std::size_t position = this->tail.load(std::memory_order_relaxed);
+        std::size_t consumed = this->head.load(std::memory_order_acquire);
+        while (position - consumed == this->slots.size()) {
+            this->head.wait(consumed, std::memory_order_acquire);
+            consumed = this->head.load(std::memory_order_acquire);
+        }
+    }
+
+    /**
+     * @brief Consumer side: sleeps while the queue is empty.
+     */
+    void wait_not_empty() const {
+        const std::size_t position = this->head.load(std::memory_order_relaxed);
+        std::size_t produced = this->tail.load(std::memory_order_acquire);
+        while (produced == position) {
+            this->tail.wait(produced, std::memory_order_acquire);
+            produced = this->tail.load(std::memory_order_acquire);
+        }
+    }
+};
+
+#endif
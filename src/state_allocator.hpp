@@ -0,0 +1,101 @@
+#ifndef STATE_ALLOCATOR_HPP
+#define STATE_ALLOCATOR_HPP
+
+#include "huge_pages.hpp"
+#include "mapped_storage.hpp"
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Allocator of state vector amplitudes: from memory by default, or from a memory-mapped file
+ * (see mapped_storage) so the state vector can outgrow RAM.
+ * Memory allocations are 64-byte aligned for the SIMD kernels, and from HUGE_PAGE_SIZE up they
+ * are huge page backed (see huge_pages) and left untouched, so the pages can be first touched in
+ * parallel by the threads that will work on them (kernels::first_touch).
+ * Every allocation starts out zero, so value-initializing elements is skipped: building a 2^n
+ * state vector writes nothing, and growing a vector again after shrinking it does not clear the
+ * regained elements. An allocator with a source file region maps that file copy-on-write
+ * instead, so the elements of a vector built with it hold the file contents without a copy;
+ * copies of such a vector get a plain mapped allocator.
+ */
+template <typename T> class StateAllocator {
+  private:
+    bool mapped = false;
+    std::shared_ptr<const mapped_storage::FileRegion> source;
+
+  public:
+    static constexpr std::size_t ALIGNMENT = 64;
+
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    StateAllocator() noexcept = default;
+
+    explicit StateAllocator(const bool mapped) noexcept : mapped(mapped) {}
+
+    explicit StateAllocator(std::shared_ptr<const mapped_storage::FileRegion> source) noexcept
+        : mapped(true), source(std::move(source)) {}
+
+    template <typename U>
+    StateAllocator(const StateAllocator<U>& other) noexcept
+        : mapped(other.is_mapped()), source(other.get_source()) {}
+
+    [[nodiscard]] StateAllocator select_on_container_copy_construction() const noexcept {
+        return StateAllocator(this->mapped);
+    }
+
+    T* allocate(const std::size_t count) {
+        if (this->source) {
+            return static_cast<T*>(mapped_storage::map_file(*this->source, count * sizeof(T)));
+        }
+        const std::size_t bytes = count * sizeof(T);
+        if (this->mapped) {
+            return static_cast<T*>(mapped_storage::map(bytes));
+        }
+        if (bytes >= huge_pages::HUGE_PAGE_SIZE) {
+            return static_cast<T*>(huge_pages::allocate(bytes));
+        }
+        void* ptr = ::operator new(bytes, std::align_val_t{ALIGNMENT});
+        std::memset(ptr, 0, bytes);
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, const std::size_t count) noexcept {
+        const std::size_t bytes = count * sizeof(T);
+        if (this->mapped) {
+            mapped_storage::unmap(ptr, bytes);
+        } else if (bytes >= huge_pages::HUGE_PAGE_SIZE) {
+            huge_pages::deallocate(ptr, bytes);
+        } else {
+            ::operator delete(ptr, std::align_val_t{ALIGNMENT});
+        }
+    }
+
+    // Zero bytes are a value-initialized amplitude already
+    template <typename U> void construct(U* /*ptr*/) {}
+
+    template <typename U, typename... Args> void construct(U* ptr, Args&&... args) {
+        ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+
+    [[nodiscard]] bool is_mapped() const noexcept {
+        return this->mapped;
+    }
+
+    [[nodiscard]] const std::shared_ptr<const mapped_storage::FileRegion>&
+    get_source() const noexcept {
+        return this->source;
+    }
+
+    friend bool operator==(const StateAllocator& lhs, const StateAllocator& rhs) noexcept {
+        return lhs.mapped == rhs.mapped && lhs.source == rhs.source;
+    }
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "dist_state_vec.hpp"
+#include "gates.hpp"
+#include "qstate_vec.hpp"
+#include <gtest/gtest.h>
+#include <mpi.h>
+
+namespace {
+
+/**
+ * Runs the same gates on a distributed state and on a single rank QStateVec, so every rank can
+ * check its slice against the reference.
+ */
+template <typename T> void run_circuit(auto& tst_sv) {
+    const int num_qubits = tst_sv.get_num_qubits();
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        tst_sv.hadamard(qubit);
+        tst_sv.rotation_z(qubit, 0.1 * qubit);
+    }
+    tst_sv.rotation_x(num_qubits, 0.7);
+    tst_sv.pauli_y(num_qubits - 1);
+    tst_sv.controlled_x(1, num_qubits);
+    tst_sv.controlled_x(num_qubits, 2);
+    tst_sv.controlled_z(num_qubits - 1, num_qubits);
+    tst_sv.toffoli(num_qubits, 3, num_qubits - 1);
+    tst_sv.controlled(0b101, num_qubits, gates::u3(0.3, -0.2, 0.9));
+    tst_sv.rotation_y(num_qubits, -1.1);
+    tst_sv.pauli_x(num_qubits);
+}
+
+template <typename T>
+void expect_matches_qstate_vec(const int num_qubits, const double tolerance,
+                               const uint64_t chunk_size = EXCHANGE_CHUNK_SIZE) {
+    DistQStateVec<T> dist_sv(num_qubits);
+    ASSERT_TRUE(dist_sv.set_exchange_chunk_size(chunk_size));
+    QStateVec<T> expected_sv(num_qubits, 1);
+    run_circuit<T>(dist_sv);
+    run_circuit<T>(expected_sv);
+
+    const auto& local = dist_sv.get_local_state();
+    const uint64_t offset = static_cast<uint64_t>(dist_sv.get_rank()) * local.size();
+    for (uint64_t i = 0; i < local.size(); i++) {
+        EXPECT_NEAR(abs(local[i] - expected_sv.get_state()[offset + i]), 0, tolerance);
+    }
+
+    const auto dist_marginals = dist_sv.get_measured_qubits();
+    const auto expected_marginals = expected_sv.get_measured_qubits();
+    for (int j = 0; j < num_qubits; j++) {
+        EXPECT_NEAR(dist_marginals[j], expected_marginals[j], tolerance);
+    }
+
+    const auto gathered = dist_sv.gather_state();
+    if (dist_sv.get_rank() == 0) {
+        ASSERT_EQ(gathered.size(), expected_sv.get_state().size());
+        for (uint64_t i = 0; i < gathered.size(); i++) {
+            EXPECT_NEAR(abs(gathered[i] - expected_sv.get_state()[i]), 0, tolerance);
+        }
+    } else {
+        EXPECT_TRUE(gathered.empty());
+    }
+}
+
+} // namespace
+
+TEST(DistQStateVec, Partition) {
+    DistQStateVec dist_sv(6);
+    int num_ranks = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &num_ranks);
+    EXPECT_EQ(dist_sv.get_num_ranks(), num_ranks);
+    EXPECT_EQ(dist_sv.get_local_state().size() * num_ranks, 64);
+    EXPECT_EQ(0x1 << dist_sv.get_num_local_qubits(), dist_sv.get_local_state().size());
+
+    EXPECT_FALSE(dist_sv.pauli_x(7));
+    EXPECT_FALSE(dist_sv.controlled_x(2, 2));
+    EXPECT_FALSE(dist_sv.controlled(0b1000000, 1, gates::pauli_x()));
+}
+
+TEST(DistQStateVec, MatchesQStateVec) {
+    expect_matches_qstate_vec<double>(8, 1e-12);
+    expect_matches_qstate_vec<float>(8, 1e-5);
+}
+
+TEST(DistQStateVec, ChunkedExchange) {
+    // Global gates exchanged in several chunks, including chunks of one amplitude
+    expect_matches_qstate_vec<double>(10, 1e-12, 8);
+    expect_matches_qstate_vec<double>(10, 1e-12, 1);
+    // Chunks larger than half the local state are clamped to it
+    expect_matches_qstate_vec<double>(10, 1e-12, 4096);
+
+    DistQStateVec dist_sv(10);
+    EXPECT_FALSE(dist_sv.set_exchange_chunk_size(0));
+    EXPECT_FALSE(dist_sv.set_exchange_chunk_size(3));
+    EXPECT_FALSE(dist_sv.set_exchange_chunk_size(uint64_t{1} << 40));
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    testing::InitGoogleTest(&argc, argv);
+
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank != 0) {
+        auto& listeners = testing::UnitTest::GetInstance()->listeners();
+        delete listeners.Release(listeners.default_result_printer());
+    }
+
+    const int result = RUN_ALL_TESTS();
+
+    // Fail on every rank if any rank failed
+    int any_failed = 0;
+    MPI_Allreduce(&result, &any_failed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Finalize();
+    return any_failed;
+}
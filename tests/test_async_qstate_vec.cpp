@@ -0,0 +1,168 @@
+#include "async_qstate_vec.hpp"
+#include "gates.hpp"
+#include "spsc_queue.hpp"
+#include <gtest/gtest.h>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+MatrixN swap_matrix() {
+    MatrixN matrix(16, 0.0);
+    matrix[0 * 4 + 0] = matrix[1 * 4 + 2] = matrix[2 * 4 + 1] = matrix[3 * 4 + 3] = 1.0;
+    return matrix;
+}
+
+// Random layers of every gate kind, on the async and the plain state vector
+template <typename T> void apply_layers(T& target, const int num_qubits, const int seed) {
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> angle(-3.0, 3.0);
+    for (int layer = 0; layer < 6; layer++) {
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            ASSERT_TRUE(target.hadamard(qubit));
+            ASSERT_TRUE(target.rotation_y(qubit, angle(rng)));
+            ASSERT_TRUE(target.u3(qubit, angle(rng), angle(rng), angle(rng)));
+            ASSERT_TRUE(target.t_gate(qubit));
+        }
+        for (int qubit = 1; qubit < num_qubits; qubit++) {
+            ASSERT_TRUE(target.controlled_x(qubit, qubit + 1));
+            ASSERT_TRUE(target.controlled_phase(qubit + 1, qubit, angle(rng)));
+        }
+        ASSERT_TRUE(target.toffoli(1, 2, num_qubits));
+        ASSERT_TRUE(target.apply_nq({2, 4}, swap_matrix()));
+    }
+}
+
+} // namespace
+
+TEST(SpscQueue, DeliversEveryItemInOrder) {
+    constexpr int NUM_ITEMS = 100000;
+    SpscQueue<int> queue(16);
+    thread producer([&] {
+        for (int i = 0; i < NUM_ITEMS; i++) {
+            int item = i;
+            while (!queue.try_push(item)) {
+                queue.wait_not_full();
+            }
+        }
+    });
+
+    for (int expected_item = 0; expected_item < NUM_ITEMS; expected_item++) {
+        int item = -1;
+        while (!queue.try_pop(item)) {
+            queue.wait_not_empty();
+        }
+        ASSERT_EQ(item, expected_item);
+    }
+    producer.join();
+
+    int item = 0;
+    EXPECT_FALSE(queue.try_pop(item));
+}
+
+TEST(AsyncQStateVec, MatchesQStateVec) {
+    const int num_qubits = 6;
+    // A small queue makes the caller block on a full queue as well
+    for (const size_t capacity : {size_t{2}, size_t{1024}}) {
+        AsyncQStateVec<double> async_sv(num_qubits, 0, StorageMode::dense, 0, 3, capacity);
+        QStateVec<double> expected_sv(num_qubits);
+        apply_layers(async_sv, num_qubits, 7);
+        apply_layers(expected_sv, num_qubits, 7);
+
+        const auto state = async_sv.get_state().get();
+        ASSERT_EQ(state.size(), expected_sv.get_state().size());
+        for (size_t i = 0; i < state.size(); i++) {
+            EXPECT_NEAR(abs(state[i] - expected_sv.get_state()[i]), 0.0, 1e-10);
+        }
+    }
+}
+
+TEST(AsyncQStateVec, RejectsInvalidGatesWithoutQueuing) {
+    AsyncQStateVec<double> async_sv(3);
+    EXPECT_FALSE(async_sv.hadamard(0));
+    EXPECT_FALSE(async_sv.pauli_x(4));
+    EXPECT_FALSE(async_sv.controlled_x(2, 2));
+    EXPECT_FALSE(async_sv.apply_nq({1, 1}, swap_matrix()));
+    EXPECT_FALSE(async_sv.append(Circuit(4)));
+
+    ASSERT_TRUE(async_sv.pauli_x(2));
+    const auto probabilities = async_sv.get_probabilities({1, 2, 3}).get();
+    ASSERT_TRUE(probabilities);
+    EXPECT_NEAR((*probabilities)[0b010], 1.0, 1e-12);
+}
+
+TEST(AsyncQStateVec, FuturesSeeTheGatesQueuedBeforeThem) {
+    AsyncQStateVec<double> async_sv(2);
+    auto before = async_sv.get_probabilities({1});
+    ASSERT_TRUE(async_sv.pauli_x(1));
+    auto after = async_sv.get_probabilities({1});
+    ASSERT_TRUE(async_sv.pauli_x(1));
+    auto flipped_back = async_sv.get_probabilities({1});
+
+    EXPECT_NEAR((*before.get())[0], 1.0, 1e-12);
+    EXPECT_NEAR((*after.get())[1], 1.0, 1e-12);
+    EXPECT_NEAR((*flipped_back.get())[0], 1.0, 1e-12);
+}
+
+TEST(AsyncQStateVec, MeasureCollapsesForLaterGates) {
+    AsyncQStateVec<double> async_sv(2, 0, StorageMode::dense, 11);
+    ASSERT_TRUE(async_sv.hadamard(1));
+    ASSERT_TRUE(async_sv.controlled_x(1, 2));
+    auto outcome = async_sv.measure(1);
+    // Undoes the entanglement on the collapsed state: both qubits end in |0>
+    ASSERT_TRUE(async_sv.controlled_x(1, 2));
+    auto measured = async_sv.get_measured_qubits();
+    auto energy = async_sv.expectation({*pauli_term("ZI"), *pauli_term("IZ")});
+
+    const auto result = outcome.get();
+    ASSERT_TRUE(result);
+    const auto measured_qubits = measured.get();
+    ASSERT_EQ(measured_qubits.size(), 2U);
+    EXPECT_NEAR(measured_qubits[0], *result, 1e-12);
+    EXPECT_NEAR(measured_qubits[1], 0.0, 1e-12);
+    EXPECT_NEAR(*energy.get(), *result == 0 ? 2.0 : 0.0, 1e-12);
+}
+
+TEST(AsyncQStateVec, SubmitRunsInOrderAndForwardsExceptions) {
+    AsyncQStateVec<float> async_sv(3, 0, StorageMode::sparse);
+    ASSERT_TRUE(async_sv.pauli_x(3));
+    auto amplitude = async_sv.submit([](QStateVec<float>& sv) { return sv.get_amplitude(4); });
+    auto failing = async_sv.submit([](QStateVec<float>&) -> int { throw runtime_error("boom"); });
+    ASSERT_TRUE(async_sv.pauli_x(3));
+    async_sv.synchronize();
+
+    EXPECT_NEAR(abs(amplitude.get() - complex<float>(1.0F)), 0.0F, 1e-6F);
+    EXPECT_THROW(failing.get(), runtime_error);
+    const auto state = async_sv.get_state().get();
+    EXPECT_NEAR(abs(state[0] - complex<float>(1.0F)), 0.0F, 1e-6F);
+}
+
+TEST(AsyncQStateVec, AppendCompiledCircuit) {
+    const int num_qubits = 6;
+    Circuit circuit(num_qubits);
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        ASSERT_TRUE(circuit.hadamard(qubit));
+    }
+    for (int target = 1; target <= num_qubits; target++) {
+        for (int control = target + 1; control <= num_qubits; control++) {
+            ASSERT_TRUE(circuit.controlled_phase(control, target, 0.3 * (control - target)));
+        }
+    }
+    ASSERT_TRUE(circuit.t_gate(2));
+    ASSERT_TRUE(circuit.rotation_x(3, 0.7));
+
+    // The executor compiles the queued batch again, diagonal batches included
+    AsyncQStateVec<double> async_sv(num_qubits, 0, StorageMode::dense, 0, 6);
+    ASSERT_TRUE(async_sv.append(circuit.compile()));
+    ASSERT_TRUE(async_sv.hadamard(1));
+    QStateVec<double> expected_sv(num_qubits);
+    ASSERT_TRUE(circuit.run(expected_sv));
+    ASSERT_TRUE(expected_sv.hadamard(1));
+
+    const auto state = async_sv.get_state().get();
+    for (size_t i = 0; i < state.size(); i++) {
+        EXPECT_NEAR(abs(state[i] - expected_sv.get_state()[i]), 0.0, 1e-10);
+    }
+}
@@ -0,0 +1,205 @@
+#include "circuit.hpp"
+#include "gates.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+using namespace std;
+
+// Test that a run of single qubit gates on one qubit fuses into a single operation
+TEST(Circuit, FuseSingleQubitRun) {
+    Circuit circuit(1);
+    circuit.hadamard(1);
+    circuit.rotation_z(1, 0.3);
+    circuit.hadamard(1);
+    circuit.t_gate(1);
+
+    auto compiled = circuit.compile();
+    EXPECT_EQ(compiled.get_operations().size(), 1);
+
+    QStateVec expected_sv(1);
+    QStateVec compiled_sv(1);
+    ASSERT_TRUE(circuit.run(expected_sv));
+    ASSERT_TRUE(compiled.run(compiled_sv));
+    expect_same_state(expected_sv, compiled_sv, 1e-12);
+}
+
+// Test that a layered circuit fuses into dense blocks and keeps its result
+TEST(Circuit, FuseBlocks) {
+    const int num_qubits = 5;
+    Circuit circuit(num_qubits);
+    const MatrixN cnot = {1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0};
+    for (int layer = 0; layer < 4; layer++) {
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            circuit.rotation_x(qubit, 0.1 * (layer + qubit));
+            circuit.rotation_z(qubit, 0.2 * (layer - qubit));
+        }
+        for (int qubit = 1; qubit < num_qubits; qubit++) {
+            circuit.add_gate({qubit, qubit + 1}, cnot);
+        }
+    }
+
+    auto compiled = circuit.compile(3);
+    EXPECT_LT(compiled.get_operations().size(), circuit.get_operations().size() / 5);
+    for (const auto& op : compiled.get_operations()) {
+        EXPECT_LE(op.qubits.size(), 3);
+    }
+
+    QStateVec expected_sv(num_qubits);
+    QStateVec compiled_sv(num_qubits);
+    ASSERT_TRUE(circuit.run(expected_sv));
+    ASSERT_TRUE(compiled.run(compiled_sv));
+    expect_same_state(expected_sv, compiled_sv, 1e-12);
+}
+
+// Test that controlled gates keep the subspace kernel alone and fuse into blocks with neighbours
+TEST(Circuit, ControlledGates) {
+    Circuit circuit(4);
+    circuit.hadamard(1);
+    circuit.hadamard(2);
+    circuit.toffoli(1, 2, 4);
+    circuit.controlled_x(4, 3);
+    circuit.controlled_z(3, 1);
+    circuit.controlled(0b0011, 3, gates::rotation_y(0.3));
+
+    auto compiled = circuit.compile(2);
+    EXPECT_EQ(compiled.get_operations()[1].controls, 0b0011);
+    EXPECT_LT(compiled.get_operations().size(), circuit.get_operations().size());
+
+    QStateVec expected_sv(4);
+    QStateVec compiled_sv(4);
+    ASSERT_TRUE(circuit.run(expected_sv));
+    ASSERT_TRUE(compiled.run(compiled_sv));
+    expect_same_state(expected_sv, compiled_sv, 1e-12);
+
+    EXPECT_FALSE(circuit.toffoli(1, 1, 2));
+    EXPECT_FALSE(circuit.controlled_x(1, 1));
+}
+
+// Test bad gates are rejected when recorded
+TEST(Circuit, BadGates) {
+    Circuit circuit(2);
+    EXPECT_FALSE(circuit.pauli_x(0));
+    EXPECT_FALSE(circuit.hadamard(3));
+    EXPECT_FALSE(circuit.add_gate({1, 1}, MatrixN(16)));
+    EXPECT_FALSE(circuit.add_gate({1, 2}, MatrixN(4)));
+    EXPECT_TRUE(circuit.get_operations().empty());
+
+    QStateVec small_sv(1);
+    EXPECT_FALSE(circuit.run(small_sv));
+}
+
+// Test that the same circuit runs in single precision
+TEST(Circuit, SinglePrecision) {
+    Circuit circuit(3);
+    circuit.hadamard(1);
+    circuit.rotation_y(2, 0.4);
+    circuit.add_gate({1, 3}, {1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0});
+
+    QStateVec<float> expected_sv(3);
+    QStateVec<float> compiled_sv(3);
+    ASSERT_TRUE(circuit.run(expected_sv));
+    ASSERT_TRUE(circuit.compile().run(compiled_sv));
+    expect_same_state(expected_sv, compiled_sv, 1e-5);
+}
+
+TEST(Circuit, BatchDiagonals) {
+    // The phase ladder of a quantum Fourier transform: every gate is diagonal
+    const int num_qubits = 6;
+    Circuit circuit(num_qubits);
+    for (int target = 1; target <= num_qubits; target++) {
+        for (int control = target + 1; control <= num_qubits; control++) {
+            circuit.controlled_phase(control, target, M_PI / (1 << (control - target)));
+        }
+        circuit.t_gate(target);
+    }
+    circuit.controlled_z(1, 6);
+
+    auto compiled = circuit.compile();
+    ASSERT_EQ(compiled.get_operations().size(), 1);
+    EXPECT_EQ(compiled.get_operations()[0].diagonals.size(), 22);
+
+    QStateVec expected_sv(num_qubits);
+    QStateVec compiled_sv(num_qubits);
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        expected_sv.hadamard(qubit);
+        compiled_sv.hadamard(qubit);
+    }
+    ASSERT_TRUE(circuit.run(expected_sv));
+    ASSERT_TRUE(compiled.run(compiled_sv));
+    expect_same_state(expected_sv, compiled_sv, 1e-12);
+
+    EXPECT_FALSE(circuit.controlled_phase(7, 1, 0.1));
+}
+
+// Test that a compiled circuit, diagonal batches included, compiles again at a wider width
+TEST(Circuit, RecompileCompiled) {
+    const int num_qubits = 6;
+    Circuit circuit(num_qubits);
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        circuit.hadamard(qubit);
+    }
+    for (int target = 1; target <= num_qubits; target++) {
+        for (int control = target + 1; control <= num_qubits; control++) {
+            circuit.controlled_phase(control, target, M_PI / (1 << (control - target)));
+        }
+    }
+    circuit.t_gate(2);
+    circuit.rotation_x(3, 0.7);
+    circuit.controlled_phase(1, 2, 0.4);
+    circuit.t_gate(1);
+
+    const auto compiled = circuit.compile();
+    ASSERT_TRUE(ranges::any_of(compiled.get_operations(),
+                               [](const Operation& op) { return !op.diagonals.empty(); }));
+
+    QStateVec expected_sv(num_qubits);
+    ASSERT_TRUE(circuit.run(expected_sv));
+    for (const int width : {1, 2, 3, 6}) {
+        QStateVec recompiled_sv(num_qubits);
+        ASSERT_TRUE(compiled.compile(width).run(recompiled_sv));
+        expect_same_state(expected_sv, recompiled_sv, 1e-12);
+    }
+}
+
+TEST(Circuit, RunBlocked) {
+    const int num_qubits = 12;
+    Circuit circuit(num_qubits);
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        circuit.hadamard(qubit);
+        circuit.rotation_y(qubit, 0.1 * qubit);
+    }
+    circuit.controlled_x(12, 1);
+    circuit.controlled_x(2, 11);
+    circuit.toffoli(1, 10, 9);
+    circuit.controlled_phase(12, 3, 0.6);
+    circuit.add_gate({8, 12}, {0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0});
+    circuit.rotation_x(7, 0.3);
+    circuit.u3(10, 0.4, 0.5, 0.6);
+    circuit.controlled(0b100000000001, 8, gates::sqrt_pauli_y());
+    circuit.t_gate(12);
+
+    for (const auto& tst_circuit : {circuit, circuit.compile()}) {
+        // 6 qubit chunks force swaps, 20 qubit chunks hold the whole state
+        for (const int block_qubits : {6, 8, 20}) {
+            QStateVec expected_sv(num_qubits);
+            QStateVec blocked_sv(num_qubits);
+            ASSERT_TRUE(tst_circuit.run(expected_sv));
+            ASSERT_TRUE(tst_circuit.run_blocked(blocked_sv, block_qubits));
+            expect_same_state(expected_sv, blocked_sv, 1e-12);
+        }
+    }
+
+    QStateVec<float> expected_sv(num_qubits);
+    QStateVec<float> blocked_sv(num_qubits);
+    ASSERT_TRUE(circuit.run(expected_sv));
+    ASSERT_TRUE(circuit.run_blocked(blocked_sv, 6));
+    expect_same_state(expected_sv, blocked_sv, 1e-5);
+
+    // Streamed through a mapped file chunk by chunk
+    QStateVec<float> mapped_sv(num_qubits, 0, StorageMode::mapped);
+    ASSERT_TRUE(circuit.run_blocked(mapped_sv, 6));
+    expect_same_state(expected_sv, mapped_sv, 1e-5);
+
+    QStateVec small_sv(num_qubits - 1);
+    EXPECT_FALSE(circuit.run_blocked(small_sv));
+}
@@ -0,0 +1,69 @@
+#ifndef TEST_HELPERS_HPP
+#define TEST_HELPERS_HPP
+
+#include "qstate_vec.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <string>
+
+/**
+ * @brief Expects both amplitude vectors to have the same size and every real and imaginary part
+ *  to match within tolerance.
+ */
+template <typename T>
+void expect_same_state(const StateVector<T>& lhs, const StateVector<T>& rhs,
+                       const double tolerance) {
+    ASSERT_EQ(lhs.size(), rhs.size());
+    for (size_t i = 0; i < lhs.size(); i++) {
+        EXPECT_NEAR(lhs[i].real(), rhs[i].real(), tolerance);
+        EXPECT_NEAR(lhs[i].imag(), rhs[i].imag(), tolerance);
+    }
+}
+
+/**
+ * @brief Same as above for two state vectors, whatever their storage.
+ */
+template <typename T>
+void expect_same_state(const QStateVec<T>& lhs, const QStateVec<T>& rhs, const double tolerance) {
+    ASSERT_EQ(lhs.get_num_qubits(), rhs.get_num_qubits());
+    for (uint64_t i = 0; i < (0x1ull << lhs.get_num_qubits()); i++) {
+        EXPECT_NEAR(lhs.get_amplitude(i).real(), rhs.get_amplitude(i).real(), tolerance);
+        EXPECT_NEAR(lhs.get_amplitude(i).imag(), rhs.get_amplitude(i).imag(), tolerance);
+    }
+}
+
+/**
+ * A new directory under ::testing::TempDir(), removed with everything in it when the object goes
+ * out of scope, including when a failed ASSERT returns from the test early.
+ */
+class ScopedTempDir {
+  private:
+    std::string path;
+
+  public:
+    ScopedTempDir() {
+        std::string pattern = ::testing::TempDir();
+        if (!pattern.empty() && pattern.back() != '/') {
+            pattern += '/';
+        }
+        pattern += "qsim-test-XXXXXX";
+        EXPECT_NE(mkdtemp(pattern.data()), nullptr) << "cannot create " << pattern;
+        this->path = pattern;
+    }
+
+    ~ScopedTempDir() {
+        std::error_code error;
+        std::filesystem::remove_all(this->path, error);
+    }
+
+    ScopedTempDir(const ScopedTempDir&) = delete;
+    ScopedTempDir& operator=(const ScopedTempDir&) = delete;
+
+    [[nodiscard]] const std::string& get_path() const {
+        return this->path;
+    }
+};
+
+#endif
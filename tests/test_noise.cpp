@@ -0,0 +1,117 @@
+#include "noise.hpp"
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t NUM_TRAJECTORIES = 4000;
+
+// Fraction of the counts with the given outcome
+double fraction(const vector<pair<uint64_t, uint64_t>>& counts, const uint64_t outcome) {
+    uint64_t total = 0;
+    uint64_t matching = 0;
+    for (const auto& [value, count] : counts) {
+        total += count;
+        matching += value == outcome ? count : 0;
+    }
+    return static_cast<double>(matching) / static_cast<double>(total);
+}
+
+Circuit ghz(const int num_qubits) {
+    Circuit circuit(num_qubits);
+    (void)circuit.hadamard(1);
+    for (int qubit = 1; qubit < num_qubits; qubit++) {
+        (void)circuit.controlled_x(qubit, qubit + 1);
+    }
+    return circuit;
+}
+
+Circuit flip_first(const int num_qubits) {
+    Circuit circuit(num_qubits);
+    (void)circuit.pauli_x(1);
+    return circuit;
+}
+
+} // namespace
+
+TEST(TrajectorySimulator, NoiselessMatchesIdealDistribution) {
+    TrajectorySimulator<double> simulator(3, NoiseModel{});
+    const auto counts = simulator.run(ghz(3), NUM_TRAJECTORIES, 1, 3);
+    ASSERT_TRUE(counts);
+    ASSERT_EQ(counts->size(), 2U);
+    EXPECT_EQ((*counts)[0].first, 0U);
+    EXPECT_EQ((*counts)[1].first, 0b111U);
+    EXPECT_EQ((*counts)[0].second + (*counts)[1].second, 3 * NUM_TRAJECTORIES);
+    EXPECT_NEAR(fraction(*counts, 0), 0.5, 0.03);
+}
+
+TEST(TrajectorySimulator, CountsDoNotDependOnThreads) {
+    const NoiseModel noise{0.05, 0.1, 0.05, 0.02};
+    TrajectorySimulator<double> serial(4, noise, 1);
+    TrajectorySimulator<double> parallel(4, noise, 3);
+    ASSERT_EQ(parallel.get_num_threads(), 3);
+
+    const auto serial_counts = serial.run(ghz(4), 500, 42);
+    // The pooled states are reset between runs as well as between trajectories
+    ASSERT_TRUE(parallel.run(flip_first(4), 100, 1));
+    const auto parallel_counts = parallel.run(ghz(4), 500, 42);
+    ASSERT_TRUE(serial_counts);
+    ASSERT_TRUE(parallel_counts);
+    EXPECT_EQ(*serial_counts, *parallel_counts);
+}
+
+TEST(TrajectorySimulator, Depolarizing) {
+    // X or Y, two of the three Paulis, undo the flip
+    TrajectorySimulator<double> simulator(2, NoiseModel{.depolarizing = 0.3}, 2);
+    const auto counts = simulator.run(flip_first(2), NUM_TRAJECTORIES, 3);
+    ASSERT_TRUE(counts);
+    EXPECT_NEAR(fraction(*counts, 0b01), 0.8, 0.03);
+
+    // Twelve of the fifteen Pauli pairs flip at least one qubit of |00>
+    Circuit identity(2);
+    ASSERT_TRUE(identity.controlled_x(1, 2));
+    TrajectorySimulator<double> two_qubit(2, NoiseModel{.depolarizing_2q = 0.5}, 2);
+    const auto pair_counts = two_qubit.run(identity, NUM_TRAJECTORIES, 4);
+    ASSERT_TRUE(pair_counts);
+    EXPECT_NEAR(fraction(*pair_counts, 0), 1.0 - 0.5 * 12.0 / 15.0, 0.03);
+}
+
+TEST(TrajectorySimulator, AmplitudeDamping) {
+    TrajectorySimulator<float> full_decay(2, NoiseModel{.amplitude_damping = 1.0});
+    const auto decayed = full_decay.run(flip_first(2), 100, 5);
+    ASSERT_TRUE(decayed);
+    EXPECT_EQ(fraction(*decayed, 0), 1.0);
+
+    // Decay of |+>: P(1) = (1 - gamma) / 2, and the kept state is no longer |+>
+    TrajectorySimulator<double> simulator(1, NoiseModel{.amplitude_damping = 0.4}, 2);
+    Circuit plus(1);
+    ASSERT_TRUE(plus.hadamard(1));
+    const auto counts = simulator.run(plus, NUM_TRAJECTORIES, 6);
+    ASSERT_TRUE(counts);
+    EXPECT_NEAR(fraction(*counts, 1), 0.3, 0.03);
+}
+
+TEST(TrajectorySimulator, ReadoutError) {
+    TrajectorySimulator<double> always_flipped(2, NoiseModel{.readout_error = 1.0});
+    const auto flipped = always_flipped.run(flip_first(2), 10, 7, 5);
+    ASSERT_TRUE(flipped);
+    ASSERT_EQ(flipped->size(), 1U);
+    EXPECT_EQ((*flipped)[0], make_pair(uint64_t{0b10}, uint64_t{50}));
+
+    TrajectorySimulator<double> simulator(2, NoiseModel{.readout_error = 0.1});
+    const auto counts = simulator.run(Circuit(2), 1000, 8, 4);
+    ASSERT_TRUE(counts);
+    EXPECT_NEAR(fraction(*counts, 0), 0.81, 0.03);
+}
+
+TEST(TrajectorySimulator, InvalidInput) {
+    TrajectorySimulator<double> simulator(2, NoiseModel{.depolarizing = 1.5});
+    EXPECT_FALSE(simulator.run(Circuit(2), 10, 0));
+
+    TrajectorySimulator<double> noiseless(2, NoiseModel{});
+    EXPECT_FALSE(noiseless.run(Circuit(3), 10, 0));
+    const auto empty = noiseless.run(Circuit(2), 0, 0);
+    ASSERT_TRUE(empty);
+    EXPECT_TRUE(empty->empty());
+}
@@ -0,0 +1,138 @@
+#include "circuit.hpp"
+#include "profiler.hpp"
+#include "qstate_vec.hpp"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+
+namespace {
+
+const profiler::GateStats* find_stats(const std::vector<profiler::GateStats>& stats,
+                                      const std::string& name, const int target_qubit) {
+    const auto it = std::ranges::find_if(stats, [&](const profiler::GateStats& entry) {
+        return entry.name == name && entry.target_qubit == target_qubit;
+    });
+    return it == stats.end() ? nullptr : &*it;
+}
+
+} // namespace
+
+TEST(Profiler, GateTotals) {
+    if (!profiler::ENABLED) {
+        GTEST_SKIP() << "built without ENABLE_PROFILING";
+    }
+    profiler::reset();
+
+    const int num_qubits = 6;
+    const uint64_t state_bytes = sizeof(std::complex<double>) << num_qubits;
+    QStateVec<double> state(num_qubits, 1, StorageMode::dense);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(state.hadamard(2));
+    }
+    ASSERT_TRUE(state.hadamard(5));
+    ASSERT_TRUE(state.toffoli(1, 2, 3));
+    ASSERT_FALSE(state.hadamard(num_qubits + 1));
+    (void)state.get_measured_qubits();
+
+    const auto stats = profiler::get_stats();
+    // hadamard goes through apply_1q, which is not counted separately, and invalid calls are
+    // not counted at all
+    EXPECT_EQ(find_stats(stats, "apply_1q", 2), nullptr);
+    const auto* hadamard = find_stats(stats, "hadamard", 2);
+    ASSERT_NE(hadamard, nullptr);
+    EXPECT_EQ(hadamard->calls, 3);
+    EXPECT_EQ(hadamard->bytes_read, 3 * state_bytes);
+    EXPECT_EQ(hadamard->bytes_written, 3 * state_bytes);
+    EXPECT_GE(hadamard->bandwidth(), 0.0);
+    ASSERT_NE(find_stats(stats, "hadamard", 5), nullptr);
+    EXPECT_EQ(find_stats(stats, "hadamard", 5)->calls, 1);
+
+    const auto* toffoli = find_stats(stats, "toffoli", 3);
+    ASSERT_NE(toffoli, nullptr);
+    EXPECT_EQ(toffoli->bytes_written, state_bytes / 4);
+
+    const auto* marginals = find_stats(stats, "get_measured_qubits", 0);
+    ASSERT_NE(marginals, nullptr);
+    EXPECT_EQ(marginals->bytes_read, state_bytes);
+    EXPECT_EQ(marginals->bytes_written, 0);
+
+    EXPECT_TRUE(std::ranges::is_sorted(stats, std::greater{}, &profiler::GateStats::seconds));
+
+    profiler::reset();
+    EXPECT_TRUE(profiler::get_stats().empty());
+}
+
+TEST(Profiler, RejectedGatesRecordNothing) {
+    if (!profiler::ENABLED) {
+        GTEST_SKIP() << "built without ENABLE_PROFILING";
+    }
+    profiler::reset();
+
+    QStateVec<double> state(4, 1, StorageMode::dense);
+    EXPECT_FALSE(state.hadamard(9));
+    EXPECT_FALSE(state.pauli_z(0));
+    EXPECT_FALSE(state.sqrt_pauli_x(5));
+    EXPECT_FALSE(state.sqrt_pauli_y(-1));
+    EXPECT_FALSE(state.s_gate(5));
+    EXPECT_FALSE(state.t_gate(0));
+    EXPECT_FALSE(state.rotation_x(5, 0.1));
+    EXPECT_FALSE(state.rotation_y(0, 0.1));
+    EXPECT_FALSE(state.rotation_z(5, 0.1));
+    EXPECT_FALSE(state.u3(0, 0.1, 0.2, 0.3));
+    EXPECT_FALSE(state.controlled_z(1, 0));
+    EXPECT_FALSE(state.controlled_z(2, 2));
+    EXPECT_FALSE(state.controlled_phase(1, 5, 0.1));
+    EXPECT_TRUE(profiler::get_stats().empty());
+}
+
+TEST(Profiler, MeasurementAndBlockedPasses) {
+    if (!profiler::ENABLED) {
+        GTEST_SKIP() << "built without ENABLE_PROFILING";
+    }
+    profiler::reset();
+
+    const int num_qubits = 8;
+    Circuit circuit(num_qubits);
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        ASSERT_TRUE(circuit.hadamard(qubit));
+    }
+    QStateVec<double> state(num_qubits, 1, StorageMode::dense);
+    ASSERT_TRUE(circuit.compile(1).run_blocked(state, 4));
+
+    std::mt19937_64 rng(7);
+    ASSERT_TRUE(state.measure(1, rng));
+    ASSERT_TRUE(state.reset(2, rng));
+
+    const auto stats = profiler::get_stats();
+    EXPECT_NE(find_stats(stats, "swap_bits", 0), nullptr);
+    EXPECT_NE(find_stats(stats, "blocked_batch", 0), nullptr);
+    // Blocked runs apply gates inside chunks, not through the QStateVec entry points
+    EXPECT_EQ(find_stats(stats, "apply_1q", 1), nullptr);
+    ASSERT_NE(find_stats(stats, "measure", 1), nullptr);
+    ASSERT_NE(find_stats(stats, "reset", 2), nullptr);
+    EXPECT_EQ(find_stats(stats, "reset", 2)->calls, 1);
+}
+
+TEST(Profiler, Output) {
+    if (!profiler::ENABLED) {
+        GTEST_SKIP() << "built without ENABLE_PROFILING";
+    }
+    profiler::reset();
+
+    QStateVec<float> state(4, 1, StorageMode::dense);
+    ASSERT_TRUE(state.pauli_x(3));
+    ASSERT_TRUE(state.pauli_x(3));
+
+    std::stringstream json;
+    profiler::dump_json(json);
+    EXPECT_NE(json.str().find(R"({"name": "pauli_x", "target_qubit": 3, "calls": 2)"),
+              std::string::npos);
+
+    std::stringstream trace;
+    profiler::dump_chrome_trace(trace);
+    const std::string text = trace.str();
+    EXPECT_EQ(text.rfind(R"({"traceEvents": [)", 0), 0);
+    EXPECT_NE(text.find(R"("ph": "X")"), std::string::npos);
+    EXPECT_NE(text.find(R"("args": {"target_qubit": 3, "bytes": 256})"), std::string::npos);
+}
@@ -0,0 +1,115 @@
+#include "gates.hpp"
+#include "qasm_parser.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+#include <numbers>
+
+using namespace std;
+
+namespace {
+
+QStateVec<double> run_program(const QasmProgram& program) {
+    QStateVec<double> state(program.circuit.get_num_qubits());
+    EXPECT_TRUE(program.circuit.run(state));
+    return state;
+}
+
+int error_line(const string_view source) {
+    const auto program = parse_qasm(source);
+    EXPECT_FALSE(program);
+    return program ? -1 : program.error().line;
+}
+
+} // namespace
+
+TEST(QasmParser, BuiltinGates) {
+    const auto program = parse_qasm(R"(OPENQASM 2.0;
+include "qelib1.inc";
+// Registers are numbered one after the other
+qreg a[2];
+qreg b[2];
+creg c[3];
+h a[0];
+cx a[0], b[1];
+rz(pi / 4) a[1];
+u3(0.1, -0.2, 2e-1) b[0];
+ccx a[0], b[1], a[1];
+cu1(-pi/2) b[0], a[0];
+swap a[1], b[0];
+sdg b[1];
+barrier a, b;
+measure a[0] -> c[1];
+)");
+    ASSERT_TRUE(program) << program.error();
+    EXPECT_EQ(program->circuit.get_num_qubits(), 4);
+    EXPECT_EQ(program->num_clbits, 3);
+    ASSERT_EQ(program->measurements.size(), 1);
+    EXPECT_EQ(program->measurements[0].qubit, 1);
+    EXPECT_EQ(program->measurements[0].clbit, 1);
+
+    QStateVec expected_sv(4);
+    expected_sv.hadamard(1);
+    expected_sv.controlled_x(1, 4);
+    expected_sv.rotation_z(2, numbers::pi / 4);
+    expected_sv.u3(3, 0.1, -0.2, 0.2);
+    expected_sv.toffoli(1, 4, 2);
+    expected_sv.controlled_phase(3, 1, -numbers::pi / 2);
+    expected_sv.apply_nq({2, 3}, {1, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 1});
+    expected_sv.controlled(0, 4, {1.0, 0.0, 0.0, complex<double>{0.0, -1.0}});
+    expect_same_state(expected_sv, run_program(*program), 1e-12);
+}
+
+TEST(QasmParser, GateDefinitionsAndBroadcast) {
+    const auto program = parse_qasm(R"(OPENQASM 2.0;
+qreg q[3];
+qreg r[3];
+creg m[3];
+gate rot(theta, phi) a { U(theta / 2, -phi, 2 * sin(phi) ^ 2) a; }
+gate entangle(theta) a, b { rot(theta, pi / 3) a; CX a, b; rot(-theta, 0.5) b; }
+h q;
+entangle(1.5) q, r;
+entangle(0.25) r[0], q[2];
+measure r -> m;
+)");
+    ASSERT_TRUE(program) << program.error();
+    ASSERT_EQ(program->measurements.size(), 3);
+    EXPECT_EQ(program->measurements[2].qubit, 6);
+    EXPECT_EQ(program->measurements[2].clbit, 2);
+
+    QStateVec expected_sv(6);
+    auto entangle = [&](const double theta, const int a, const int b) {
+        const double phi = numbers::pi / 3;
+        expected_sv.u3(a, theta / 2, -phi, 2 * pow(sin(phi), 2));
+        expected_sv.controlled_x(a, b);
+        expected_sv.u3(b, -theta / 2, -0.5, 2 * pow(sin(0.5), 2));
+    };
+    for (int qubit = 1; qubit <= 3; qubit++) {
+        expected_sv.hadamard(qubit);
+    }
+    for (int qubit = 1; qubit <= 3; qubit++) {
+        entangle(1.5, qubit, qubit + 3);
+    }
+    entangle(0.25, 4, 3);
+    expect_same_state(expected_sv, run_program(*program), 1e-12);
+}
+
+TEST(QasmParser, Errors) {
+    EXPECT_EQ(error_line("qreg q[2];\nh q[2];"), 2);
+    EXPECT_EQ(error_line("qreg q[2];\n\nfoo q[0];"), 3);
+    EXPECT_EQ(error_line("qreg q[2];\ncx q[0];"), 2);
+    EXPECT_EQ(error_line("qreg q[2];\ncx q[1], q[1];"), 2);
+    EXPECT_EQ(error_line("qreg q[2];\nrx q[0];"), 2);
+    EXPECT_EQ(error_line("qreg q[2];\nqreg r[3];\ncx q, r;"), 3);
+    EXPECT_EQ(error_line("qreg q[2];\nh q[0]\nh q[1];"), 3);
+    EXPECT_EQ(error_line("qreg q[2];\nh q[0];\nqreg r[1];"), 3);
+    EXPECT_EQ(error_line("qreg q[1];\ncreg c[1];\nmeasure q -> c;\nx q[0];"), 4);
+    EXPECT_EQ(error_line("qreg q[1];\nreset q[0];"), 2);
+    EXPECT_EQ(error_line("gate g a { h b; }"), 1);
+    EXPECT_EQ(error_line("OPENQASM 3.0;"), 1);
+    // Register sizes summing past the int range are rejected before they overflow
+    EXPECT_EQ(error_line("qreg a[2147483647];\nqreg b[2];\nh a[0];"), 1);
+    EXPECT_EQ(error_line("qreg a[2147483647];\nqreg b[2147483647];\nqreg c[3];\nh a[0];"), 1);
+    EXPECT_EQ(error_line("qreg a[60];\nqreg b[2147483647];\nqreg c[3];\nh a[0];"), 2);
+    EXPECT_EQ(error_line("qreg q[1];\ncreg a[40];\ncreg b[30];"), 3);
+    EXPECT_FALSE(parse_qasm_file("/nonexistent/circuit.qasm"));
+}
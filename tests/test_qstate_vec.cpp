@@ -1,5 +1,13 @@
+#include "checkpoint.hpp"
+#include "gates.hpp"
+#include "kernels.hpp"
 #include "qstate_vec.hpp"
+#include "test_helpers.hpp"
+#include <algorithm>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <iterator>
+#include <unistd.h>
 
 using namespace std;
 
@@ -84,3 +92,694 @@ TEST(QStateVec, StateVecCreation) {
     EXPECT_EQ(results[1], 0);
     EXPECT_EQ(results.size(), 2);
 }
+
+// Test that the state vector holds exactly 2^n amplitudes and gates update it in place
+TEST(QStateVec, InPlaceStateVector) {
+    QStateVec tst_sv(3);
+    const auto& state = tst_sv.get_state();
+    ASSERT_EQ(state.size(), 8);
+
+    tst_sv.pauli_x(2);
+    EXPECT_EQ(state[2], complex<double>(1, 0));
+
+    tst_sv.pauli_y(3);
+    EXPECT_EQ(state[6], complex<double>(0, 1));
+
+    tst_sv.pauli_y(3);
+    tst_sv.pauli_x(2);
+    EXPECT_EQ(state[0], complex<double>(1, 0));
+    EXPECT_EQ(norm(state[6]), 0);
+}
+
+// Test that set_zero_state returns to |0...0> in place, with either storage
+TEST(QStateVec, SetZeroState) {
+    QStateVec tst_sv(3);
+    const auto* data = tst_sv.get_state().data();
+    tst_sv.hadamard(1);
+    tst_sv.controlled_x(1, 3);
+    tst_sv.set_zero_state();
+    EXPECT_EQ(tst_sv.get_state().data(), data);
+    for (uint64_t i = 0; i < 8; i++) {
+        EXPECT_EQ(tst_sv.get_amplitude(i), complex<double>(i == 0 ? 1.0 : 0.0, 0.0));
+    }
+
+    for (const auto mode : {StorageMode::sparse, StorageMode::automatic}) {
+        QStateVec sparse_sv(3, 0, mode);
+        for (int qubit = 1; qubit <= 3; qubit++) {
+            sparse_sv.hadamard(qubit);
+        }
+        sparse_sv.set_zero_state();
+        EXPECT_TRUE(sparse_sv.is_sparse());
+        for (uint64_t i = 0; i < 8; i++) {
+            EXPECT_EQ(sparse_sv.get_amplitude(i), complex<double>(i == 0 ? 1.0 : 0.0, 0.0));
+        }
+    }
+}
+
+// Test the generic single qubit unitary entry point and its bad inputs
+TEST(QStateVec, Apply1Q) {
+    QStateVec tst_sv(2);
+    const Matrix2 pauli_x = {complex<double>{0, 0}, complex<double>{1, 0},
+                             complex<double>{1, 0}, complex<double>{0, 0}};
+    auto res = tst_sv.apply_1q(2, pauli_x);
+    ASSERT_TRUE(res);
+    EXPECT_EQ(tst_sv.get_state()[2], complex<double>(1, 0));
+
+    res = tst_sv.apply_1q(3, pauli_x);
+    ASSERT_FALSE(res);
+    EXPECT_EQ("Invalid Input", to_string(res.error()));
+}
+
+// Test the single qubit gates built on top of apply_1q
+TEST(QStateVec, SingleQubitGates) {
+    QStateVec tst_sv(3);
+    tst_sv.hadamard(1);
+    auto results = tst_sv.get_measured_qubits();
+    EXPECT_NEAR(results[0], 0.5, 1e-12);
+
+    // H Z H = X
+    tst_sv.pauli_z(1);
+    tst_sv.hadamard(1);
+    EXPECT_NEAR(norm(tst_sv.get_state()[1]), 1, 1e-12);
+
+    // sqrt(X)^2 = X, sqrt(Y)^2 = Y
+    tst_sv.sqrt_pauli_x(2);
+    tst_sv.sqrt_pauli_x(2);
+    tst_sv.sqrt_pauli_y(3);
+    tst_sv.sqrt_pauli_y(3);
+    EXPECT_NEAR(norm(tst_sv.get_state()[7]), 1, 1e-12);
+
+    // T^2 = S, S^2 = Z on |1>: T T S = -1
+    QStateVec phase_sv(1);
+    phase_sv.pauli_x(1);
+    phase_sv.t_gate(1);
+    phase_sv.t_gate(1);
+    phase_sv.s_gate(1);
+    EXPECT_NEAR(phase_sv.get_state()[1].real(), -1, 1e-12);
+    EXPECT_NEAR(phase_sv.get_state()[1].imag(), 0, 1e-12);
+}
+
+// Test the rotation gates
+TEST(QStateVec, RotationGates) {
+    QStateVec tst_sv(3);
+    tst_sv.rotation_x(1, M_PI);
+    tst_sv.rotation_y(2, M_PI / 2);
+    tst_sv.u3(3, M_PI, 0, M_PI);
+    auto results = tst_sv.get_measured_qubits();
+    EXPECT_NEAR(results[0], 1, 1e-12);
+    EXPECT_NEAR(results[1], 0.5, 1e-12);
+    EXPECT_NEAR(results[2], 1, 1e-12);
+
+    // RZ only changes the relative phase: RX(pi) |0> = -i|1> -> RZ(pi) -> -i * i = 1
+    QStateVec phase_sv(1);
+    phase_sv.rotation_x(1, M_PI);
+    phase_sv.rotation_z(1, M_PI);
+    EXPECT_NEAR(phase_sv.get_state()[1].real(), 1, 1e-12);
+    EXPECT_NEAR(phase_sv.get_state()[1].imag(), 0, 1e-12);
+}
+
+// Test a dense two qubit unitary (CNOT, control on qubit 1) and its bad inputs
+TEST(QStateVec, ApplyNQ) {
+    QStateVec tst_sv(3);
+    const MatrixN cnot = {1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0};
+    tst_sv.pauli_x(1);
+    ASSERT_TRUE(tst_sv.apply_nq({1, 3}, cnot));
+    EXPECT_EQ(tst_sv.get_state()[5], complex<double>(1, 0));
+
+    EXPECT_FALSE(tst_sv.apply_nq({1, 1}, cnot));
+    EXPECT_FALSE(tst_sv.apply_nq({1, 4}, cnot));
+    EXPECT_FALSE(tst_sv.apply_nq({1, 2}, MatrixN(4)));
+}
+
+// Test the pair loops compiled per low target and the generic one against the k-qubit kernel,
+// serial and threaded
+TEST(QStateVec, SpecializedTargets) {
+    const int num_qubits = kernels::PARALLEL_QUBIT_THRESHOLD;
+    for (const int num_threads : {1, 3}) {
+        QStateVec tst_sv(num_qubits, num_threads);
+        QStateVec expected_sv(num_qubits, 1);
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            const vector<Matrix2> matrices = {gates::u3(0.3 * qubit, 0.1 * qubit, -0.5),
+                                              gates::pauli_x(), gates::pauli_y(),
+                                              gates::hadamard()};
+            for (const auto& matrix : matrices) {
+                ASSERT_TRUE(expected_sv.apply_nq({qubit}, MatrixN(matrix.begin(), matrix.end())));
+            }
+            ASSERT_TRUE(tst_sv.u3(qubit, 0.3 * qubit, 0.1 * qubit, -0.5));
+            ASSERT_TRUE(tst_sv.pauli_x(qubit));
+            ASSERT_TRUE(tst_sv.pauli_y(qubit));
+            ASSERT_TRUE(tst_sv.hadamard(qubit));
+        }
+        for (size_t i = 0; i < tst_sv.get_state().size(); i++) {
+            EXPECT_NEAR(abs(tst_sv.get_state()[i] - expected_sv.get_state()[i]), 0, 1e-12);
+        }
+    }
+}
+
+// Test the thread count resolution and that threaded kernels match the serial ones
+TEST(QStateVec, Multithreaded) {
+    const int num_qubits = 16;
+    QStateVec serial_sv(num_qubits, 1);
+    QStateVec parallel_sv(num_qubits, 4);
+    EXPECT_EQ(serial_sv.get_num_threads(), 1);
+    EXPECT_EQ(parallel_sv.get_num_threads(), 4);
+    EXPECT_EQ(QStateVec(2, 4).get_num_threads(), 1);
+
+    setenv("QSIM_NUM_THREADS", "3", 1);
+    EXPECT_EQ(QStateVec(num_qubits).get_num_threads(), 3);
+    unsetenv("QSIM_NUM_THREADS");
+
+    for (auto* tst_sv : {&serial_sv, &parallel_sv}) {
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            tst_sv->hadamard(qubit);
+            tst_sv->rotation_z(qubit, 0.1 * qubit);
+        }
+        tst_sv->pauli_x(3);
+        tst_sv->pauli_y(num_qubits);
+        tst_sv->apply_nq({2, 9}, {1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0});
+        tst_sv->rotation_x(5, 0.7);
+    }
+
+    EXPECT_EQ(serial_sv.get_state(), parallel_sv.get_state());
+    auto serial_results = serial_sv.get_measured_qubits();
+    auto parallel_results = parallel_sv.get_measured_qubits();
+    for (int j = 0; j < num_qubits; j++) {
+        EXPECT_NEAR(serial_results[j], parallel_results[j], 1e-12);
+    }
+}
+
+// Test single precision state vectors alongside double precision ones
+TEST(QStateVec, SinglePrecision) {
+    QStateVec<float> float_sv(3);
+    QStateVec<double> double_sv(3);
+    for (int qubit = 1; qubit <= 3; qubit++) {
+        float_sv.rotation_y(qubit, 0.5 * qubit);
+        double_sv.rotation_y(qubit, 0.5 * qubit);
+    }
+    float_sv.pauli_y(2);
+    double_sv.pauli_y(2);
+
+    auto float_results = float_sv.get_measured_qubits();
+    auto double_results = double_sv.get_measured_qubits();
+    for (int j = 0; j < 3; j++) {
+        EXPECT_NEAR(float_results[j], double_results[j], 1e-6);
+    }
+    EXPECT_EQ(sizeof(float_sv.get_state()[0]), 2 * sizeof(float));
+}
+
+// Test CNOT, CZ and Toffoli on the control subspace
+TEST(QStateVec, ControlledGates) {
+    QStateVec tst_sv(3);
+    tst_sv.controlled_x(1, 2);
+    EXPECT_EQ(tst_sv.get_state()[0], complex<double>(1, 0));
+
+    tst_sv.pauli_x(1);
+    tst_sv.controlled_x(1, 2);
+    EXPECT_EQ(tst_sv.get_state()[3], complex<double>(1, 0));
+
+    tst_sv.toffoli(1, 2, 3);
+    EXPECT_EQ(tst_sv.get_state()[7], complex<double>(1, 0));
+
+    tst_sv.controlled_z(3, 1);
+    EXPECT_EQ(tst_sv.get_state()[7], complex<double>(-1, 0));
+
+    // Multi-controlled Y with controls on qubits 1 and 3
+    tst_sv.controlled(0b101, 2, gates::pauli_y());
+    EXPECT_EQ(tst_sv.get_state()[5], complex<double>(0, 1));
+
+    EXPECT_FALSE(tst_sv.controlled_x(1, 1));
+    EXPECT_FALSE(tst_sv.toffoli(1, 4, 2));
+    EXPECT_FALSE(tst_sv.controlled(0b1000, 1, gates::pauli_x()));
+    EXPECT_FALSE(tst_sv.controlled(0b001, 1, gates::pauli_x()));
+}
+
+// Test the controlled kernel against the equivalent dense unitary
+TEST(QStateVec, ControlledMatchesDense) {
+    const int num_qubits = 5;
+    QStateVec controlled_sv(num_qubits);
+    QStateVec dense_sv(num_qubits);
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        controlled_sv.hadamard(qubit);
+        dense_sv.hadamard(qubit);
+    }
+
+    const auto matrix = gates::u3(0.4, 1.1, -0.3);
+    // Controls on qubits 2 and 5, target on qubit 4
+    MatrixN dense(64, 0);
+    for (uint64_t i = 0; i < 8; i++) {
+        dense[i * 8 + i] = 1;
+    }
+    dense[3 * 8 + 3] = matrix[0];
+    dense[3 * 8 + 7] = matrix[1];
+    dense[7 * 8 + 3] = matrix[2];
+    dense[7 * 8 + 7] = matrix[3];
+
+    ASSERT_TRUE(controlled_sv.controlled(0b10010, 4, matrix));
+    ASSERT_TRUE(dense_sv.apply_nq({2, 5, 4}, dense));
+    for (size_t i = 0; i < dense_sv.get_state().size(); i++) {
+        EXPECT_NEAR(abs(controlled_sv.get_state()[i] - dense_sv.get_state()[i]), 0, 1e-12);
+    }
+}
+
+TEST(QStateVec, DiagonalGates) {
+    // 11 qubits, so the batched phases span two lookup chunks and the controlled phases below
+    // cross the chunk boundary
+    const int num_qubits = 11;
+    QStateVec batched_sv(num_qubits);
+    QStateVec sequential_sv(num_qubits);
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        batched_sv.hadamard(qubit);
+        sequential_sv.hadamard(qubit);
+    }
+
+    const std::vector<DiagonalGate> diagonals = {
+        {0, 3, {1.0, std::polar(1.0, 0.7)}},
+        {0, 10, {std::polar(1.0, -0.2), std::polar(1.0, 0.2)}},
+        {0b10, 9, {1.0, std::polar(1.0, 1.3)}},
+        {0b10100000000, 2, {std::polar(1.0, 0.5), -1.0}},
+        {0b10000, 6, {1.0, std::polar(1.0, -0.9)}},
+    };
+    for (const auto& gate : diagonals) {
+        ASSERT_TRUE(sequential_sv.controlled(gate.controls_mask, gate.target_qubit,
+                                             {gate.phases[0], 0, 0, gate.phases[1]}));
+    }
+    ASSERT_TRUE(batched_sv.apply_diagonals(diagonals));
+    for (size_t i = 0; i < sequential_sv.get_state().size(); i++) {
+        EXPECT_NEAR(abs(batched_sv.get_state()[i] - sequential_sv.get_state()[i]), 0, 1e-12);
+    }
+
+    ASSERT_TRUE(batched_sv.controlled_phase(1, 7, 0.25));
+    ASSERT_TRUE(sequential_sv.controlled(0b1, 7, gates::u3(0, 0, 0.25)));
+    for (size_t i = 0; i < sequential_sv.get_state().size(); i++) {
+        EXPECT_NEAR(abs(batched_sv.get_state()[i] - sequential_sv.get_state()[i]), 0, 1e-12);
+    }
+
+    EXPECT_FALSE(batched_sv.apply_diagonals({{0, 12, {1.0, -1.0}}}));
+    EXPECT_FALSE(batched_sv.apply_diagonals({{0b100, 3, {1.0, -1.0}}}));
+    // Targets outside the state are rejected before their mask is built
+    EXPECT_FALSE(batched_sv.apply_diagonals({{0, 0, {1.0, -1.0}}}));
+    EXPECT_FALSE(batched_sv.apply_diagonals({{0, 65, {1.0, -1.0}}}));
+    EXPECT_FALSE(batched_sv.apply_diagonal(0, {1.0, -1.0}));
+    EXPECT_FALSE(batched_sv.controlled_phase(4, 4, 0.1));
+}
+
+TEST(QStateVec, Probabilities) {
+    // 13 qubits, so the index has a high part above the low block
+    const int num_qubits = 13;
+    for (const int num_threads : {1, 3}) {
+        QStateVec tst_sv(num_qubits, num_threads);
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            tst_sv.rotation_y(qubit, 0.2 * qubit);
+            tst_sv.rotation_z(qubit, 0.3);
+        }
+        tst_sv.controlled_x(2, 12);
+
+        const auto& state = tst_sv.get_state();
+        const auto marginals = tst_sv.get_measured_qubits();
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            double expected = 0;
+            for (uint64_t i = 0; i < state.size(); i++) {
+                expected += ((i >> (qubit - 1)) & 1) != 0 ? norm(state[i]) : 0;
+            }
+            EXPECT_NEAR(marginals[qubit - 1], expected, 1e-12);
+        }
+
+        const std::vector<int> qubits = {12, 2, 7};
+        const auto joint = tst_sv.get_probabilities(qubits);
+        ASSERT_TRUE(joint);
+        ASSERT_EQ(joint->size(), 8);
+        std::vector<double> expected(8, 0);
+        for (uint64_t i = 0; i < state.size(); i++) {
+            const uint64_t m = ((i >> 11) & 1) | (((i >> 1) & 1) << 1) | (((i >> 6) & 1) << 2);
+            expected[m] += norm(state[i]);
+        }
+        for (size_t m = 0; m < expected.size(); m++) {
+            EXPECT_NEAR((*joint)[m], expected[m], 1e-12);
+        }
+        EXPECT_NEAR((*joint)[0b001] + (*joint)[0b011] + (*joint)[0b101] + (*joint)[0b111],
+                    marginals[11], 1e-12);
+    }
+
+    QStateVec small_sv(3);
+    small_sv.hadamard(2);
+    const auto single = small_sv.get_probabilities({2});
+    ASSERT_EQ(single->size(), 2);
+    EXPECT_NEAR((*single)[0], 0.5, 1e-12);
+    EXPECT_NEAR((*single)[1], 0.5, 1e-12);
+    EXPECT_NEAR(small_sv.get_probabilities({})->at(0), 1.0, 1e-12);
+    EXPECT_FALSE(small_sv.get_probabilities({4}));
+    EXPECT_FALSE(small_sv.get_probabilities({1, 1}));
+}
+
+TEST(QStateVec, Sample) {
+    const int num_qubits = 12;
+    QStateVec serial_sv(num_qubits, 1);
+    QStateVec parallel_sv(num_qubits, 3);
+    for (auto* tst_sv : {&serial_sv, &parallel_sv}) {
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            tst_sv->rotation_y(qubit, 0.15 * qubit);
+        }
+        tst_sv->controlled_x(3, 11);
+    }
+
+    const uint64_t shots = 200000;
+    const auto counts = serial_sv.sample(shots, 42);
+    EXPECT_EQ(counts, parallel_sv.sample(shots, 42));
+    EXPECT_EQ(counts, serial_sv.sample(shots, 42));
+    EXPECT_NE(counts, serial_sv.sample(shots, 43));
+
+    // Counts are sorted, add up to shots and follow the marginals
+    uint64_t total = 0;
+    std::vector<double> frequencies(num_qubits, 0);
+    for (size_t k = 0; k < counts.size(); k++) {
+        EXPECT_TRUE(k == 0 || counts[k - 1].first < counts[k].first);
+        EXPECT_GT(counts[k].second, 0);
+        EXPECT_GT(norm(serial_sv.get_state()[counts[k].first]), 0);
+        total += counts[k].second;
+        for (int j = 0; j < num_qubits; j++) {
+            frequencies[j] += ((counts[k].first >> j) & 1) != 0 ? counts[k].second : 0;
+        }
+    }
+    EXPECT_EQ(total, shots);
+    const auto marginals = serial_sv.get_measured_qubits();
+    for (int j = 0; j < num_qubits; j++) {
+        EXPECT_NEAR(frequencies[j] / shots, marginals[j], 0.01);
+    }
+
+    // A basis state always gives the same bitstring
+    QStateVec basis_sv(3);
+    basis_sv.pauli_x(1);
+    basis_sv.pauli_x(3);
+    using Counts = std::vector<std::pair<uint64_t, uint64_t>>;
+    EXPECT_EQ(basis_sv.sample(10, 7), (Counts{{0b101, 10}}));
+    EXPECT_TRUE(basis_sv.sample(0, 7).empty());
+}
+
+// Test every Pauli string on 4 qubits against applying it to a copy, in dense, sparse and
+// single precision storage, and the grouped sum
+TEST(QStateVec, PauliExpectations) {
+    const int num_qubits = 4;
+    auto prepare = [&](auto& tst_sv) {
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            ASSERT_TRUE(tst_sv.u3(qubit, 0.4 * qubit, 0.3, -0.2 * qubit));
+        }
+        ASSERT_TRUE(tst_sv.controlled_x(1, 3));
+        ASSERT_TRUE(tst_sv.controlled_phase(4, 2, 0.9));
+    };
+    QStateVec dense_sv(num_qubits);
+    QStateVec sparse_sv(num_qubits, 1, StorageMode::sparse);
+    QStateVec<float> float_sv(num_qubits);
+    prepare(dense_sv);
+    prepare(sparse_sv);
+    prepare(float_sv);
+
+    vector<PauliTerm> terms;
+    vector<double> expected_values;
+    const string letters = "IXYZ";
+    for (int code = 0; code < 256; code++) {
+        string paulis;
+        QStateVec applied = dense_sv;
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            const char pauli = letters[(code >> (2 * qubit - 2)) & 3];
+            paulis += pauli;
+            if (pauli == 'X') {
+                ASSERT_TRUE(applied.pauli_x(qubit));
+            } else if (pauli == 'Y') {
+                ASSERT_TRUE(applied.pauli_y(qubit));
+            } else if (pauli == 'Z') {
+                ASSERT_TRUE(applied.pauli_z(qubit));
+            }
+        }
+        const auto term = pauli_term(paulis, 0.5 + code);
+        ASSERT_TRUE(term);
+        terms.push_back(*term);
+
+        complex<double> overlap = 0;
+        for (size_t i = 0; i < applied.get_state().size(); i++) {
+            overlap += conj(dense_sv.get_state()[i]) * applied.get_state()[i];
+        }
+        EXPECT_NEAR(overlap.imag(), 0, 1e-12);
+        expected_values.push_back(overlap.real());
+    }
+
+    const auto dense_values = dense_sv.expectation_values(terms);
+    const auto sparse_values = sparse_sv.expectation_values(terms);
+    const auto float_values = float_sv.expectation_values(terms);
+    ASSERT_TRUE(dense_values && sparse_values && float_values);
+    double expected_total = 0;
+    for (size_t t = 0; t < terms.size(); t++) {
+        EXPECT_NEAR((*dense_values)[t], expected_values[t], 1e-12);
+        EXPECT_NEAR((*sparse_values)[t], expected_values[t], 1e-12);
+        EXPECT_NEAR((*float_values)[t], expected_values[t], 1e-5);
+        expected_total += terms[t].coefficient * expected_values[t];
+    }
+    EXPECT_NEAR(*dense_sv.expectation(terms), expected_total, 1e-9);
+    EXPECT_NEAR((*dense_sv.expectation_values({terms[0]}))[0], 1.0, 1e-12);
+
+    EXPECT_FALSE(pauli_term("XA"));
+    EXPECT_FALSE(dense_sv.expectation_values({*pauli_term("IIIIX")}));
+    EXPECT_FALSE(dense_sv.expectation({{0, 0b10000, 1.0}}));
+}
+
+TEST(QStateVec, MeasureAndReset) {
+    std::mt19937_64 rng(5);
+
+    // Bell pair: both qubits always agree and the state stays normalized
+    for (int run = 0; run < 20; run++) {
+        QStateVec tst_sv(2);
+        tst_sv.hadamard(1);
+        tst_sv.controlled_x(1, 2);
+        const auto first = tst_sv.measure(1, rng);
+        ASSERT_TRUE(first);
+        const auto amp = tst_sv.get_state()[*first == 0 ? 0b00 : 0b11];
+        EXPECT_NEAR(abs(amp), 1.0, 1e-12);
+        EXPECT_EQ(tst_sv.measure(2, rng), *first);
+    }
+
+    // Outcome frequencies follow the probabilities
+    int ones = 0;
+    for (int run = 0; run < 2000; run++) {
+        QStateVec tst_sv(1);
+        tst_sv.rotation_y(1, 2 * std::asin(std::sqrt(0.3)));
+        ones += *tst_sv.measure(1, rng);
+    }
+    EXPECT_NEAR(ones / 2000.0, 0.3, 0.05);
+
+    // Reset keeps the other qubits' amplitudes, moved onto |0> of the target
+    QStateVec reset_sv(3);
+    reset_sv.pauli_x(2);
+    reset_sv.hadamard(3);
+    reset_sv.controlled_x(3, 1);
+    const auto outcome = reset_sv.reset(1, rng);
+    ASSERT_TRUE(outcome);
+    const auto& state = reset_sv.get_state();
+    const uint64_t expected_index = *outcome == 1 ? 0b110 : 0b010;
+    for (uint64_t i = 0; i < state.size(); i++) {
+        EXPECT_NEAR(abs(state[i]), i == expected_index ? 1.0 : 0.0, 1e-12);
+    }
+    EXPECT_NEAR(reset_sv.get_measured_qubits()[0], 0.0, 1e-12);
+
+    EXPECT_FALSE(reset_sv.measure(4, rng));
+    EXPECT_FALSE(reset_sv.reset(0, rng));
+}
+
+// Test both Kraus operators of amplitude damping, with either storage
+TEST(QStateVec, AmplitudeDamping) {
+    std::mt19937_64 rng(9);
+    for (const auto mode : {StorageMode::dense, StorageMode::sparse}) {
+        // Certain decay moves |1> onto |0>
+        QStateVec decayed(2, 0, mode);
+        decayed.pauli_x(2);
+        EXPECT_EQ(decayed.amplitude_damping(2, 1.0, rng), 1);
+        EXPECT_NEAR(abs(decayed.get_amplitude(0b00)), 1.0, 1e-12);
+
+        // Without a decay the |1> component shrinks by sqrt(1 - gamma) before renormalizing
+        const double gamma = 0.4;
+        int decays = 0;
+        for (int run = 0; run < 2000; run++) {
+            QStateVec plus(1, 0, mode);
+            plus.hadamard(1);
+            const auto jumped = plus.amplitude_damping(1, gamma, rng);
+            ASSERT_TRUE(jumped);
+            decays += *jumped;
+            const double norm_kept = sqrt(1.0 + (1.0 - gamma));
+            EXPECT_NEAR(abs(plus.get_amplitude(0)), *jumped == 1 ? 1.0 : 1.0 / norm_kept, 1e-12);
+            EXPECT_NEAR(abs(plus.get_amplitude(1)),
+                        *jumped == 1 ? 0.0 : sqrt(1.0 - gamma) / norm_kept, 1e-12);
+        }
+        EXPECT_NEAR(decays / 2000.0, gamma / 2, 0.05);
+
+        EXPECT_FALSE(decayed.amplitude_damping(3, 0.1, rng));
+        EXPECT_FALSE(decayed.amplitude_damping(1, 1.5, rng));
+    }
+
+    // Keeping |0> under certain decay drops the |1> half instead of storing zeros
+    for (int run = 0; run < 20; run++) {
+        QStateVec plus(3, 0, StorageMode::sparse);
+        plus.hadamard(1);
+        plus.hadamard(3);
+        const auto jumped = plus.amplitude_damping(1, 1.0, rng);
+        ASSERT_TRUE(jumped);
+        EXPECT_EQ(plus.get_num_stored(), 2);
+        EXPECT_NEAR(abs(plus.get_amplitude(0b000)), sqrt(0.5), 1e-12);
+        EXPECT_NEAR(abs(plus.get_amplitude(0b100)), sqrt(0.5), 1e-12);
+    }
+}
+
+// Test alignment and contents of small and huge page allocations under every page source
+TEST(QStateVec, HeapStorage) {
+    for (const char* pages : {"transparent", "explicit", "off"}) {
+        setenv("QSIM_HUGE_PAGES", pages, 1);
+        // 2 KiB and 4 MiB of amplitudes
+        for (const int num_qubits : {7, 18}) {
+            QStateVec tst_sv(num_qubits, 2);
+            const auto address = reinterpret_cast<uintptr_t>(tst_sv.get_state().data());
+            EXPECT_EQ(address % StateAllocator<complex<double>>::ALIGNMENT, 0);
+            if (num_qubits == 18) {
+                EXPECT_EQ(address % huge_pages::HUGE_PAGE_SIZE, 0);
+            }
+            EXPECT_EQ(tst_sv.get_state()[0], complex<double>(1.0, 0.0));
+            EXPECT_TRUE(ranges::all_of(tst_sv.get_state().begin() + 1, tst_sv.get_state().end(),
+                                       [](const complex<double>& amp) { return amp == 0.0; }));
+
+            tst_sv.hadamard(num_qubits);
+            const QStateVec copy = tst_sv;
+            EXPECT_NEAR(copy.get_measured_qubits()[num_qubits - 1], 0.5, 1e-12);
+        }
+    }
+    unsetenv("QSIM_HUGE_PAGES");
+}
+
+TEST(QStateVec, MappedStorage) {
+    const ScopedTempDir temp_dir;
+    const string& dir = temp_dir.get_path();
+    setenv("QSIM_MAPPED_DIR", dir.c_str(), 1);
+
+    const int num_qubits = 14;
+    QStateVec dense_sv(num_qubits);
+    QStateVec mapped_sv(num_qubits, 0, StorageMode::mapped);
+    EXPECT_EQ(mapped_sv.get_storage_mode(), StorageMode::mapped);
+    EXPECT_FALSE(mapped_sv.is_sparse());
+    EXPECT_TRUE(mapped_sv.get_state().get_allocator().is_mapped());
+
+    // The amplitudes live in an unlinked file of the requested directory
+    ifstream maps("/proc/self/maps");
+    const string mappings{istreambuf_iterator<char>(maps), istreambuf_iterator<char>()};
+    EXPECT_NE(mappings.find(dir + "/qsim-state-"), string::npos);
+
+    for (auto* tst_sv : {&dense_sv, &mapped_sv}) {
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            tst_sv->hadamard(qubit);
+            tst_sv->rotation_z(qubit, 0.2 * qubit);
+        }
+        tst_sv->controlled_x(num_qubits, 1);
+        tst_sv->toffoli(2, 3, num_qubits);
+    }
+    for (uint64_t i = 0; i < dense_sv.get_state().size(); i++) {
+        EXPECT_EQ(dense_sv.get_state()[i], mapped_sv.get_state()[i]);
+    }
+
+    unsetenv("QSIM_MAPPED_DIR");
+}
+
+TEST(QStateVec, Checkpoint) {
+    const ScopedTempDir temp_dir;
+    const string& dir = temp_dir.get_path();
+    const string path = dir + "/state.ckpt";
+
+    const int num_qubits = 10;
+    QStateVec saved_sv(num_qubits);
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        saved_sv.hadamard(qubit);
+        saved_sv.rotation_z(qubit, 0.3 * qubit);
+    }
+    ASSERT_TRUE(saved_sv.save(path));
+
+    auto loaded_sv = QStateVec<double>::load(path, 1);
+    ASSERT_TRUE(loaded_sv);
+    EXPECT_EQ(loaded_sv->get_num_qubits(), num_qubits);
+    EXPECT_EQ(loaded_sv->get_storage_mode(), StorageMode::mapped);
+    EXPECT_EQ(loaded_sv->get_state(), saved_sv.get_state());
+
+    // The loaded state resumes the circuit, and saving over its own file leaves it intact
+    saved_sv.controlled_x(1, num_qubits);
+    loaded_sv->controlled_x(1, num_qubits);
+    ASSERT_TRUE(loaded_sv->save(path));
+    EXPECT_EQ(loaded_sv->get_state(), saved_sv.get_state());
+    auto reloaded_sv = QStateVec<double>::load(path);
+    ASSERT_TRUE(reloaded_sv);
+    EXPECT_EQ(reloaded_sv->get_state(), saved_sv.get_state());
+
+    QStateVec sparse_sv(40, 0, StorageMode::sparse);
+    sparse_sv.hadamard(40);
+    sparse_sv.controlled_x(40, 7);
+    ASSERT_TRUE(sparse_sv.save(path));
+    auto loaded_sparse_sv = QStateVec<double>::load(path);
+    ASSERT_TRUE(loaded_sparse_sv);
+    EXPECT_TRUE(loaded_sparse_sv->is_sparse());
+    EXPECT_EQ(loaded_sparse_sv->get_num_stored(), 2);
+    EXPECT_EQ(loaded_sparse_sv->get_amplitude((0x1ull << 39) | 0b1000000),
+              sparse_sv.get_amplitude((0x1ull << 39) | 0b1000000));
+
+    // A state of no qubits holds a single amplitude
+    QStateVec empty_sv(0, 1);
+    ASSERT_TRUE(empty_sv.save(path));
+    auto loaded_empty_sv = QStateVec<double>::load(path);
+    ASSERT_TRUE(loaded_empty_sv);
+    EXPECT_EQ(loaded_empty_sv->get_num_qubits(), 0);
+    EXPECT_EQ(loaded_empty_sv->get_state(), empty_sv.get_state());
+
+    EXPECT_EQ(QStateVec<float>::load(path).error(), Error::invalid_input);
+    EXPECT_EQ(QStateVec<double>::load(dir + "/missing.ckpt").error(), Error::io_failure);
+    truncate(path.c_str(), 100);
+    EXPECT_EQ(QStateVec<double>::load(path).error(), Error::invalid_input);
+}
+
+// Test that checkpoints with a valid layout but corrupt contents are rejected
+TEST(QStateVec, CorruptCheckpoint) {
+    const ScopedTempDir temp_dir;
+    const string& dir = temp_dir.get_path();
+    const string path = dir + "/state.ckpt";
+    using Entry = AmplitudeMap<double>::Entry;
+
+    const int num_qubits = 4;
+    const auto write = [&](const checkpoint::Layout layout, const uint8_t mode,
+                           const span<const byte> payload, const uint64_t num_records) {
+        const checkpoint::Header header = {checkpoint::MAGIC,
+                                           checkpoint::VERSION,
+                                           num_qubits,
+                                           sizeof(double),
+                                           layout,
+                                           static_cast<StorageMode>(mode),
+                                           num_records};
+        ASSERT_TRUE(checkpoint::write(path, header, payload));
+    };
+    const auto write_sparse = [&](const vector<Entry>& entries, const StorageMode mode) {
+        write(checkpoint::Layout::sparse, static_cast<uint8_t>(mode), as_bytes(span(entries)),
+              entries.size());
+    };
+
+    write_sparse({{3, {1.0, 0.0}}}, StorageMode::sparse);
+    const auto valid_sv = QStateVec<double>::load(path);
+    ASSERT_TRUE(valid_sv);
+    EXPECT_EQ(valid_sv->get_amplitude(3), complex<double>(1.0, 0.0));
+
+    // Indices past 2^n, the map's empty key, and the same index twice
+    for (const auto& entries : vector<vector<Entry>>{{{16, {1.0, 0.0}}},
+                                                     {{AmplitudeMap<double>::EMPTY, {1.0, 0.0}}},
+                                                     {{3, {0.6, 0.0}}, {3, {0.8, 0.0}}}}) {
+        write_sparse(entries, StorageMode::sparse);
+        EXPECT_EQ(QStateVec<double>::load(path).error(), Error::invalid_input);
+    }
+
+    // More records than amplitudes, and a sparse payload under dense storage
+    write_sparse(vector<Entry>(17, {0, {0.0, 0.0}}), StorageMode::automatic);
+    EXPECT_EQ(QStateVec<double>::load(path).error(), Error::invalid_input);
+    write_sparse({{3, {1.0, 0.0}}}, StorageMode::dense);
+    EXPECT_EQ(QStateVec<double>::load(path).error(), Error::invalid_input);
+
+    // A storage mode outside the enum
+    const vector<complex<double>> amplitudes(0x1ull << num_qubits);
+    write(checkpoint::Layout::dense, 7, as_bytes(span(amplitudes)), amplitudes.size());
+    EXPECT_EQ(QStateVec<double>::load(path).error(), Error::invalid_input);
+}
@@ -0,0 +1,86 @@
+#include "gates.hpp"
+#include "qstate_vec_batch.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace {
+
+// A layer of per element rotations and shared entangling gates, run on the batch and on one
+// QStateVec per element
+template <typename T> void expect_matches_qstate_vec(const double tolerance) {
+    for (const int batch_size : {1, 3, 8, 17}) {
+        const int num_qubits = 5;
+        QStateVecBatch<T> batch(num_qubits, batch_size);
+        vector<QStateVec<T>> expected_svs(batch_size, QStateVec<T>(num_qubits));
+
+        for (int qubit = 1; qubit <= num_qubits; qubit++) {
+            vector<double> angles(batch_size);
+            vector<Matrix2> matrices(batch_size);
+            for (int b = 0; b < batch_size; b++) {
+                angles[b] = 0.1 * b + 0.3 * qubit;
+                matrices[b] = gates::u3(0.2 * b, -0.4 * qubit, 0.5);
+            }
+            ASSERT_TRUE(batch.hadamard(qubit));
+            ASSERT_TRUE(batch.rotation_y(qubit, angles));
+            ASSERT_TRUE(batch.apply_1q(qubit, matrices));
+            if (qubit > 1) {
+                ASSERT_TRUE(batch.controlled_x(qubit - 1, qubit));
+                ASSERT_TRUE(batch.controlled_phase(qubit, 1, angles));
+            }
+            for (int b = 0; b < batch_size; b++) {
+                ASSERT_TRUE(expected_svs[b].hadamard(qubit));
+                ASSERT_TRUE(expected_svs[b].rotation_y(qubit, angles[b]));
+                ASSERT_TRUE(expected_svs[b].apply_1q(qubit, matrices[b]));
+                if (qubit > 1) {
+                    ASSERT_TRUE(expected_svs[b].controlled_x(qubit - 1, qubit));
+                    ASSERT_TRUE(expected_svs[b].controlled_phase(qubit, 1, angles[b]));
+                }
+            }
+        }
+
+        for (int b = 0; b < batch_size; b++) {
+            const auto state = batch.get_state(b);
+            ASSERT_TRUE(state);
+            expect_same_state(expected_svs[b].get_state(), *state, tolerance);
+
+            const auto marginals = batch.get_measured_qubits(b);
+            ASSERT_TRUE(marginals);
+            const auto expected_marginals = expected_svs[b].get_measured_qubits();
+            for (int qubit = 0; qubit < num_qubits; qubit++) {
+                EXPECT_NEAR((*marginals)[qubit], expected_marginals[qubit], tolerance);
+            }
+        }
+    }
+}
+
+} // namespace
+
+TEST(QStateVecBatch, MatchesQStateVec) {
+    expect_matches_qstate_vec<double>(1e-12);
+    expect_matches_qstate_vec<float>(1e-5);
+}
+
+TEST(QStateVecBatch, BadInputs) {
+    QStateVecBatch batch(3, 4);
+    EXPECT_EQ(batch.get_batch_size(), 4);
+    EXPECT_EQ(batch.get_num_qubits(), 3);
+
+    EXPECT_FALSE(batch.hadamard(0));
+    EXPECT_FALSE(batch.pauli_x(4));
+    EXPECT_FALSE(batch.rotation_x(1, {0.1, 0.2}));
+    EXPECT_FALSE(batch.controlled_x(2, 2));
+    EXPECT_FALSE(batch.controlled(0b1000, 1, gates::pauli_x()));
+    EXPECT_FALSE(batch.get_state(4));
+    EXPECT_FALSE(batch.get_measured_qubits(-1));
+
+    // Failed calls leave every element in |000>
+    for (int b = 0; b < 4; b++) {
+        EXPECT_EQ((*batch.get_state(b))[0], complex<double>(1.0, 0.0));
+    }
+
+    EXPECT_THROW(QStateVecBatch(3, 0), invalid_argument);
+    EXPECT_THROW(QStateVecBatch(3, -2), invalid_argument);
+    EXPECT_THROW(QStateVecBatch(64, 1), invalid_argument);
+}
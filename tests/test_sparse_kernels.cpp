@@ -0,0 +1,169 @@
+#include "amplitude_map.hpp"
+#include "circuit.hpp"
+#include "gates.hpp"
+#include "qstate_vec.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+using namespace std::complex_literals;
+
+TEST(AmplitudeMap, InsertAndLookup) {
+    AmplitudeMap<double> amps;
+    EXPECT_EQ(amps.size(), 0);
+    EXPECT_FALSE(amps.contains(3));
+    EXPECT_EQ(amps.get(3), 0.0);
+
+    // Enough entries to grow the table several times
+    for (uint64_t i = 0; i < 1000; i++) {
+        amps[i * 0x10001] = {static_cast<double>(i), 1.0};
+    }
+    amps[0x10001] += 1.0i;
+    EXPECT_EQ(amps.size(), 1000);
+    EXPECT_EQ(amps.get(0x10001), (std::complex<double>{1.0, 2.0}));
+    EXPECT_EQ(amps.get(999 * 0x10001), (std::complex<double>{999.0, 1.0}));
+    EXPECT_FALSE(amps.contains(2));
+
+    uint64_t visited = 0;
+    amps.for_each([&](const uint64_t index, const std::complex<double>& amplitude) {
+        EXPECT_EQ(index % 0x10001, 0);
+        EXPECT_EQ(amplitude.real(), static_cast<double>(index / 0x10001));
+        visited++;
+    });
+    EXPECT_EQ(visited, 1000);
+}
+
+TEST(SparseStorage, MatchesDense) {
+    const int num_qubits = 6;
+    QStateVec dense_sv(num_qubits);
+    QStateVec sparse_sv(num_qubits, 0, StorageMode::sparse);
+    EXPECT_TRUE(sparse_sv.is_sparse());
+    EXPECT_EQ(sparse_sv.get_num_stored(), 1);
+
+    for (auto* tst_sv : {&dense_sv, &sparse_sv}) {
+        tst_sv->hadamard(2);
+        tst_sv->pauli_x(5);
+        tst_sv->pauli_y(1);
+        tst_sv->controlled_x(2, 4);
+        tst_sv->toffoli(2, 4, 6);
+        tst_sv->rotation_z(4, 0.3);
+        tst_sv->t_gate(6);
+        tst_sv->controlled_phase(5, 2, 0.7);
+        tst_sv->apply_diagonals({{0b10, 3, {1.0, -1.0}}, {0, 5, {1.0i, 1.0}}});
+        tst_sv->apply_nq({3, 1}, {1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0});
+        tst_sv->u3(3, 0.5, 0.2, -0.4);
+        tst_sv->controlled(0b100000, 1, gates::sqrt_pauli_x());
+    }
+    EXPECT_TRUE(sparse_sv.is_sparse());
+    expect_same_state(dense_sv, sparse_sv, 1e-12);
+
+    const auto dense_marginals = dense_sv.get_measured_qubits();
+    const auto sparse_marginals = sparse_sv.get_measured_qubits();
+    for (int j = 0; j < num_qubits; j++) {
+        EXPECT_NEAR(dense_marginals[j], sparse_marginals[j], 1e-12);
+    }
+    const auto dense_joint = dense_sv.get_probabilities({6, 3});
+    const auto sparse_joint = sparse_sv.get_probabilities({6, 3});
+    for (size_t m = 0; m < dense_joint->size(); m++) {
+        EXPECT_NEAR((*dense_joint)[m], (*sparse_joint)[m], 1e-12);
+    }
+
+    // Same support, so both draw the same shots
+    const auto sparse_counts = sparse_sv.sample(1000, 9);
+    uint64_t total = 0;
+    for (const auto& [bitstring, count] : sparse_counts) {
+        EXPECT_GT(norm(dense_sv.get_amplitude(bitstring)), 0);
+        total += count;
+    }
+    EXPECT_EQ(total, 1000);
+
+    std::mt19937_64 dense_rng(3);
+    std::mt19937_64 sparse_rng(3);
+    EXPECT_EQ(dense_sv.measure(3, dense_rng), sparse_sv.measure(3, sparse_rng));
+    EXPECT_EQ(dense_sv.reset(1, dense_rng), sparse_sv.reset(1, sparse_rng));
+    expect_same_state(dense_sv, sparse_sv, 1e-12);
+
+    // Interference removes cancelled entries
+    QStateVec cancel_sv(3, 0, StorageMode::sparse);
+    cancel_sv.hadamard(2);
+    EXPECT_EQ(cancel_sv.get_num_stored(), 2);
+    cancel_sv.hadamard(2);
+    EXPECT_EQ(cancel_sv.get_num_stored(), 1);
+}
+
+TEST(SparseStorage, PermutationsBeyondDenseMemory) {
+    // A ripple of Toffolis over 48 qubits on a superposition of 8 basis states
+    const int num_qubits = 48;
+    QStateVec tst_sv(num_qubits, 0, StorageMode::automatic);
+    for (int qubit = 1; qubit <= 3; qubit++) {
+        tst_sv.hadamard(qubit);
+    }
+    Circuit circuit(num_qubits);
+    for (int qubit = 1; qubit + 2 <= num_qubits; qubit++) {
+        circuit.toffoli(qubit, qubit + 1, qubit + 2);
+        circuit.controlled_x(qubit, qubit + 1);
+    }
+    ASSERT_TRUE(circuit.run(tst_sv));
+    EXPECT_TRUE(tst_sv.is_sparse());
+    EXPECT_EQ(tst_sv.get_num_stored(), 8);
+
+    double total = 0;
+    for (const auto& [bitstring, count] : tst_sv.sample(800, 1)) {
+        EXPECT_NEAR(norm(tst_sv.get_amplitude(bitstring)), 0.125, 1e-12);
+        total += count;
+    }
+    EXPECT_EQ(total, 800);
+}
+
+TEST(SparseStorage, AutomaticSwitching) {
+    const int num_qubits = 8;
+    QStateVec auto_sv(num_qubits, 0, StorageMode::automatic);
+    QStateVec dense_sv(num_qubits);
+    EXPECT_TRUE(auto_sv.is_sparse());
+
+    // 2^4 entries out of 2^8 is still sparse, 2^5 crosses the dense threshold
+    for (int qubit = 1; qubit <= 5; qubit++) {
+        auto_sv.hadamard(qubit);
+        dense_sv.hadamard(qubit);
+        EXPECT_EQ(auto_sv.is_sparse(), qubit < 5);
+    }
+    EXPECT_EQ(auto_sv.get_num_stored(), 256);
+    expect_same_state(dense_sv, auto_sv, 1e-12);
+
+    // Measuring enough qubits brings it back to sparse
+    std::mt19937_64 auto_rng(11);
+    std::mt19937_64 dense_rng(11);
+    for (int qubit = 1; qubit <= 5; qubit++) {
+        EXPECT_EQ(auto_sv.measure(qubit, auto_rng), dense_sv.measure(qubit, dense_rng));
+    }
+    EXPECT_TRUE(auto_sv.is_sparse());
+    EXPECT_EQ(auto_sv.get_num_stored(), 1);
+    expect_same_state(dense_sv, auto_sv, 1e-12);
+
+    QStateVec fixed_sv(num_qubits, 0, StorageMode::sparse);
+    for (int qubit = 1; qubit <= num_qubits; qubit++) {
+        fixed_sv.hadamard(qubit);
+    }
+    EXPECT_TRUE(fixed_sv.is_sparse());
+    EXPECT_EQ(fixed_sv.get_num_stored(), 256);
+}
+
+// Test that a sparse state hands out its dense amplitudes, and that its width is bounded
+TEST(SparseStorage, DenseView) {
+    QStateVec dense_sv(4);
+    QStateVec sparse_sv(4, 0, StorageMode::sparse);
+    for (auto* tst_sv : {&dense_sv, &sparse_sv}) {
+        tst_sv->hadamard(3);
+        tst_sv->controlled_x(3, 1);
+    }
+    ASSERT_TRUE(sparse_sv.is_sparse());
+    EXPECT_EQ(sparse_sv.get_state(), dense_sv.get_state());
+    sparse_sv.pauli_x(2);
+    dense_sv.pauli_x(2);
+    EXPECT_EQ(sparse_sv.get_state(), dense_sv.get_state());
+    EXPECT_TRUE(sparse_sv.is_sparse());
+
+    EXPECT_NO_THROW(QStateVec(63, 0, StorageMode::sparse));
+    EXPECT_THROW(QStateVec(64, 0, StorageMode::sparse), std::invalid_argument);
+    EXPECT_THROW(QStateVec(64, 0, StorageMode::automatic), std::invalid_argument);
+    EXPECT_THROW(QStateVec(-1), std::invalid_argument);
+}
@@ -0,0 +1,65 @@
+#include "gates.hpp"
+#include "split_state_vec.hpp"
+#include "test_helpers.hpp"
+#include <gtest/gtest.h>
+
+using namespace std;
+
+namespace {
+
+template <typename T> void expect_matches_qstate_vec(const double tolerance) {
+    const vector<SimdLevel> levels = {SimdLevel::scalar, SimdLevel::sse2, SimdLevel::avx2,
+                                      SimdLevel::avx512};
+    for (const int num_qubits : {1, 2, 3, 6}) {
+        for (const auto level : levels) {
+            if (level > simd::detect_level()) {
+                continue;
+            }
+            QStateVec<T> expected_sv(num_qubits);
+            SplitStateVec<T> tst_sv(num_qubits);
+            tst_sv.set_simd_level(level);
+            EXPECT_EQ(tst_sv.get_simd_level(), level);
+
+            for (int qubit = 1; qubit <= num_qubits; qubit++) {
+                const auto matrix = gates::u3(0.3 * qubit, 0.2, -0.7 * qubit);
+                ASSERT_TRUE(expected_sv.apply_1q(qubit, matrix));
+                ASSERT_TRUE(tst_sv.apply_1q(qubit, matrix));
+                expected_sv.pauli_y(qubit);
+                tst_sv.pauli_y(qubit);
+            }
+            expect_same_state(expected_sv.get_state(), tst_sv.to_state_vector(), tolerance);
+        }
+    }
+}
+
+} // namespace
+
+// Test every available instruction set against QStateVec, on low (shuffled) and high targets
+TEST(SplitStateVec, MatchesQStateVec) {
+    expect_matches_qstate_vec<double>(1e-12);
+    expect_matches_qstate_vec<float>(1e-5);
+}
+
+// Test conversion from the interleaved layout, measurement and bad inputs
+TEST(SplitStateVec, Conversion) {
+    QStateVec state(3);
+    state.hadamard(1);
+    state.pauli_x(3);
+
+    SplitStateVec tst_sv(state);
+    expect_same_state(state.get_state(), tst_sv.to_state_vector(), 1e-12);
+
+    auto results = tst_sv.get_measured_qubits();
+    EXPECT_NEAR(results[0], 0.5, 1e-12);
+    EXPECT_NEAR(results[1], 0, 1e-12);
+    EXPECT_NEAR(results[2], 1, 1e-12);
+
+    EXPECT_FALSE(tst_sv.hadamard(0));
+    EXPECT_FALSE(tst_sv.pauli_x(4));
+
+    // Sparse amplitudes are expanded on the way in
+    QStateVec sparse_state(3, 0, StorageMode::sparse);
+    sparse_state.hadamard(1);
+    sparse_state.pauli_x(3);
+    expect_same_state(state.get_state(), SplitStateVec(sparse_state).to_state_vector(), 1e-12);
+}